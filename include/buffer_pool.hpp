@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct gbm_device;
+
+// Capture dma-bufs, recycled across resizes, region changes and hotplug.
+// Allocations are rounded up to a size bucket (a buffer may be wrapped as any
+// wl_buffer no larger than itself, at its own stride), so a region of interest
+// that moves a little keeps hitting the same buffers. Released buffers stay
+// parked in their bucket and are evicted, oldest first, to keep the total
+// within the budget. Buffers in use are never taken away: the budget can be
+// exceeded by live buffers alone, which is logged and shown in the stats.
+
+// A linear dma-buf fd of at least w x h for `owner` (output name), or -1.
+// The fd belongs to the pool: hand it back with pool_release, don't close it.
+int  pool_acquire(gbm_device* gbm, int w, int h, uint32_t fourcc, const std::string& owner,
+                  uint32_t& stride);
+void pool_release(int fd);
+
+void   pool_set_budget(size_t bytes);
+size_t pool_budget();
+size_t pool_total();        // live + parked bytes
+
+// Free all parked buffers (shutdown).
+void pool_clear();
+
+// "total_mb=<n> live_mb=<n> parked_mb=<n> budget_mb=<n> hits=<n> misses=<n>
+//  evictions=<n> owners=<name>:<mb>,..."
+std::string pool_stats();
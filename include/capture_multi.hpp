@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <GL/gl.h>
@@ -7,14 +8,71 @@ struct CapturedOutput {
   // Wayland side
   void* wl_output = nullptr;     // opaque wl_output*
   // Image/GL
-  int width = 0, height = 0;
+  int width = 0, height = 0;     // full output size in pixels
   int x = 0, y = 0;
   GLuint texture = 0;            // GL texture bound to an EGLImage
+  int tex_w = 0, tex_h = 0;      // texture size in texels
+  // Texture rows changed by the last wlr_multi_next_frame, [dirty_y0, dirty_y1)
+  int dirty_y0 = 0, dirty_y1 = 0;
+  // Sub-rect of the output held in texture (output pixels); the whole output
+  // unless a region of interest is set with wlr_multi_set_region.
+  int src_x = 0, src_y = 0, src_w = 0, src_h = 0;
+  uint32_t fourcc = 0;           // DRM format of the captured dma-buf (0 on the wl_shm path)
+  // Pointer overlay, tracked separately from the (cursor-less) capture
+  bool cursor_visible = false;
+  int cursor_x = 0, cursor_y = 0;  // top-left of the cursor image, output pixels
+  GLuint cursor_tex = 0;           // premultiplied RGBA
+  int cursor_w = 0, cursor_h = 0;
   // Metadata (optional)
-  std::string name;              // wl_output.name if available
+  std::string name;              // wl_output.name if available, else "output-<i>"
+};
+
+// Last known capture size/format of an output, by name.
+struct CaptureHint {
+  std::string name;
+  int width = 0, height = 0;
+  uint32_t fourcc = 0;
 };
 
+// Optional, before init: outputs matching a hint skip the serial probe.
+void wlr_multi_set_hints(const std::vector<CaptureHint>& hints);
+
 void wlr_multi_capture_init(std::vector<CapturedOutput>& outs, int* totalW, int* totalH);     // discover outputs, create textures
 void wlr_multi_next_frame(std::vector<CapturedOutput>& outs); // update all textures
+// Capture only this rect of output `index` (output pixels) from the next frame on.
+// w/h <= 0 goes back to whole-output capture.
+void wlr_multi_set_region(size_t index, int x, int y, int w, int h);
+// Capture output `index` only every n-th frame (1 = every frame, 0 = paused);
+// its texture keeps the last frame in between.
+void wlr_multi_set_interval(size_t index, int n);
+// dma-buf path: longest wlr_multi_next_frame waits for copies, in microseconds
+// (< 0: wait for all, the default). Copies that miss it land in a later frame,
+// so a busy compositor cannot hold up the render loop.
+void wlr_multi_set_wait_budget(int us);
+long wlr_multi_last_wait_us();   // time the last wlr_multi_next_frame spent waiting
+// Apply output hotplug seen since the last call (new wl_output globals are
+// probed and appended, removed ones dropped, resized ones re-exported).
+// Returns true if `outs` changed; indices after a removed output shift down.
+bool wlr_multi_update_outputs(std::vector<CapturedOutput>& outs);
+
+// Window sources (ext-image-copy-capture on ext-foreign-toplevel-list handles,
+// where the compositor has them). A captured window is exported like an output
+// named "window:<app_id>", with its own buffer ring and damage tracking, so the
+// copy costs scale with the window rather than the monitor.
+struct CaptureWindow {
+  std::string id, app_id, title;
+};
+bool wlr_multi_windows_supported();
+std::vector<CaptureWindow> wlr_multi_windows();
+// Start capturing the window whose identifier or app_id equals `match` (else
+// whose title contains it). It is appended to `outs` by wlr_multi_update_outputs
+// once its first frame arrived. Returns the exported name, "" if nothing matched.
+std::string wlr_multi_add_window(const std::string& match);
+bool wlr_multi_remove_window(const std::string& name);   // by exported name
 void wlr_multi_shutdown();   // free resources
 
+
+// Format helpers for CapturedOutput::fourcc
+const char* capture_format_name(uint32_t fourcc);
+bool capture_format_is_float(uint32_t fourcc);   // half-float (HDR/scRGB) formats
+int capture_format_precision(uint32_t fourcc);  // bits per color channel (8 if unknown)
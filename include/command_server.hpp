@@ -1,22 +1,65 @@
 #pragma once
+#include <functional>
+#include <string>
+#include <vector>
 
-// Minimal SEQPACKET command server designed for systemd user socket activation.
+// SEQPACKET command server designed for systemd user socket activation.
 // If LISTEN_FDS/LISTEN_PID are present, adopts fd=3. Otherwise, binds %t/viture.sock.
-// Messages are single tokens like: "align", "zoom-in", etc.
+//
+// Connections are persistent; a client may send any number of packets. Each
+// packet holds one or more commands separated by '\n' or ';':
+//   [#id] <name> [args...]          e.g. "#7 zoom-in 0.2; fov 45"
+// Every command gets one reply line, and all replies for a packet go back as one packet:
+//   [#id] ok [value]  |  [#id] err <reason>
+// Built-ins: "get <key>" (registered queries), "subscribe"/"unsubscribe"
+// (event stream of "event <key> <value>" packets sent via cmdsrv_publish).
+//
+// cmdsrv_poll only does socket I/O and argument parsing. Commands and queries
+// are queued and run, in order, by cmdsrv_dispatch, which the app calls on the
+// render thread at a fixed point of the frame; replies are sent from there.
+
+// Declared argument of a command: a number (with range) or a string token.
+struct CmdArgSpec {
+  enum Type { Number, String };
+  Type   type     = Number;
+  bool   optional = false;
+  double def      = 0.0;       // value used when an optional number is absent
+  double min      = -1e300;
+  double max      = 1e300;
+};
+inline CmdArgSpec cmd_num(double min, double max) {
+  CmdArgSpec s; s.min = min; s.max = max; return s;
+}
+inline CmdArgSpec cmd_opt_num(double def, double min, double max) {
+  CmdArgSpec s; s.optional = true; s.def = def; s.min = min; s.max = max; return s;
+}
+inline CmdArgSpec cmd_str() {
+  CmdArgSpec s; s.type = CmdArgSpec::String; return s;
+}
+inline CmdArgSpec cmd_opt_str() {   // absent: empty string
+  CmdArgSpec s; s.type = CmdArgSpec::String; s.optional = true; return s;
+}
+
+// Parsed arguments, one slot per declared CmdArgSpec (defaults filled in).
+struct CmdArgs {
+  std::vector<double>      nums;
+  std::vector<std::string> strs;
+
+  double num(size_t i) const { return i < nums.size() ? nums[i] : 0.0; }
+  const std::string& str(size_t i) const { return strs[i]; }
+};
+
+using CmdHandler = std::function<void(const CmdArgs&)>;
+using CmdQuery   = std::function<std::string()>;
+
+// Register before cmdsrv_poll is first called.
+void cmdsrv_register(const std::string& name, std::vector<CmdArgSpec> args, CmdHandler fn);
+void cmdsrv_register_query(const std::string& key, CmdQuery fn);
 
 bool cmdsrv_init();
-void cmdsrv_poll();     // nonblocking: accept and process all pending messages
+void cmdsrv_poll();      // nonblocking: accept, read and parse all pending messages
+void cmdsrv_dispatch();  // run queued commands and send their replies (render thread)
 void cmdsrv_shutdown();
 
-// Hooks to be set by your app:
-extern void (*cmd_on_align)();
-extern void (*cmd_on_push)();
-extern void (*cmd_on_pop)();
-extern void (*cmd_on_zoom_in_fov)();
-extern void (*cmd_on_zoom_out_fov)();
-extern void (*cmd_on_zoom_in)();
-extern void (*cmd_on_zoom_out)();
-extern void (*cmd_on_shift_left)();
-extern void (*cmd_on_shift_right)();
-extern void (*cmd_on_toggle_center_dot)();
-
+bool cmdsrv_has_subscribers();
+void cmdsrv_publish(const std::string& key, const std::string& value);
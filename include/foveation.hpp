@@ -0,0 +1,26 @@
+#pragma once
+
+// Foveated rendering. The view center (where the center dot and the gaze ray
+// point) is drawn at full resolution; the rest of the frame is drawn into a
+// reduced-resolution target with cheap panel sampling and upscaled under it.
+// Usage per frame, with a current GL context:
+//
+//   if (fovea_begin_periphery(w, h)) { draw(cheap); fovea_begin_center(); }
+//   draw(full);
+//   fovea_end();
+
+void  fovea_set_enabled(bool on);
+bool  fovea_enabled();
+void  fovea_set_size(float frac);    // center region, fraction of each framebuffer dimension
+float fovea_size();
+void  fovea_set_scale(float s);      // periphery resolution scale, 0.25 .. 1
+float fovea_scale();
+
+// Bind the periphery target (viewport set, cleared, center masked out by depth).
+// False when foveation is off or unavailable: draw once at full resolution.
+bool fovea_begin_periphery(int w, int h);
+// Upscale the periphery into the previous framebuffer and scissor to the center.
+void fovea_begin_center();
+void fovea_end();
+
+void fovea_shutdown();
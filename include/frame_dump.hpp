@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Lossless frame recording for bug reports and regression diffs. Each frame is
+// read back from the window framebuffer through a PBO ring (the map happens
+// frames later, once its fence has signalled, so the render thread never waits
+// on the GPU) and zlib-compressed on a worker thread. When the worker falls
+// behind, frames are dropped and counted rather than queued without bound.
+//
+// File layout, little endian:
+//   header  "VDMP" u32 version u32 format               (format 1: RGBA8, rows bottom-up)
+//   frame   "VFRM" u32 w u32 h u64 t_us u32 raw_len u32 z_len <z_len bytes zlib>
+//   index   "VIDX" u32 count, count x u64 file offset of each "VFRM"
+//   trailer u64 offset of "VIDX", "VEND"
+// Index and trailer are written on stop; a file cut short has neither but its
+// frames can still be read in order. Extract with tools/vdump2png.
+
+constexpr uint32_t VDUMP_VERSION     = 1;
+constexpr uint32_t VDUMP_FORMAT_RGBA = 1;
+constexpr size_t   VDUMP_HEADER_LEN  = 12;   // magic, version, format
+constexpr size_t   VDUMP_FRAME_LEN   = 28;   // frame header before the zlib data
+constexpr size_t   VDUMP_TRAILER_LEN = 12;
+
+// Start recording to `path` ("" = <state dir>/dumps/dump-<time>.vdmp).
+// Throws std::runtime_error when the file cannot be created.
+void frame_dump_start(const std::string& path);
+void frame_dump_stop();          // flush pending frames, write the index
+bool frame_dump_active();
+const std::string& frame_dump_path();
+
+// After the frame is drawn, before the swap, with the window framebuffer bound.
+void frame_dump_capture(int w, int h);
+
+std::string frame_dump_stats();
+// Frames written and dropped in the current (or last) recording.
+long frame_dump_written();
+long frame_dump_dropped();
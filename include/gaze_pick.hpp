@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+
+// Gaze picking: ray vs. oriented panel quads through a small BVH. The index
+// is rebuilt only when the layout changes; a pick is a few box tests plus
+// one plane test per candidate quad.
+
+struct PickQuad {
+  int   id;          // caller's panel index, returned in PickHit
+  float model[16];   // column-major panel -> scene transform
+  float w, h;        // quad is w x h, centered at the origin of its z=0 plane
+};
+
+struct PickHit {
+  int   id = -1;     // -1: nothing hit
+  float t  = 0;      // distance along the (unit) ray
+  float u  = 0, v = 0;   // hit point on the quad, [0,1], v down like texture rows
+};
+
+void gaze_pick_build(const std::vector<PickQuad>& quads);
+
+// Nearest quad hit by origin + t*dir (t > 0). Back faces count: panels are
+// visible from both sides.
+bool gaze_pick(const float origin[3], const float dir[3], PickHit& hit);
@@ -0,0 +1,22 @@
+#pragma once
+
+// Dwell-time gaze selection on timestamps. Fed one sample per IMU report with
+// the target under the gaze (-1 for none); a target is selected once the gaze
+// has rested on it for the dwell time. Hysteresis: leaving the candidate for
+// less than the release time pauses the dwell instead of resetting it, and a
+// selected target must be left before it can fire again.
+
+void   gaze_select_set_dwell(double seconds);
+double gaze_select_dwell();
+void   gaze_select_set_release(double seconds);
+double gaze_select_release();
+
+// t: steady clock seconds, non-decreasing. Returns the target that just
+// completed its dwell, else -1.
+int gaze_select_feed(double t, int target);
+
+// Current candidate and its dwell progress in [0, 1].
+int   gaze_select_candidate();
+float gaze_select_progress();
+
+void gaze_select_reset();
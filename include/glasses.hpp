@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GL/gl.h>
+#include <chrono>
 #include <cstdio>
 #include <math.h>
 #include <stdbool.h>
@@ -9,6 +10,7 @@
 #include <string.h>
 #include <sys/select.h>
 #include <unistd.h>
+#include <mutex>
 
 #include "viture.h"
 
@@ -39,10 +41,40 @@ static float makeFloat(uint8_t *data) {
   return value;
 }
 
+// Recent IMU reports, stamped with the host steady clock on arrival, for
+// stages that run at the IMU rate rather than the frame rate.
+struct ImuSample {
+  double t;                 // steady clock seconds
+  float roll, pitch, yaw;   // raw, without the alignment offsets
+};
+static const int IMU_RING = 64;
+static ImuSample imu_ring[IMU_RING];
+static uint64_t imu_written = 0;
+static std::mutex imu_mutex;
+
+static double imu_clock() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Copy the samples after `cursor` (oldest first, at most IMU_RING) and advance it.
+static size_t imu_drain(uint64_t &cursor, ImuSample *out) {
+  std::lock_guard<std::mutex> lk(imu_mutex);
+  if (imu_written - cursor > (uint64_t)IMU_RING) cursor = imu_written - IMU_RING;
+  size_t n = 0;
+  for (; cursor < imu_written; ++cursor) out[n++] = imu_ring[cursor % IMU_RING];
+  return n;
+}
+
 static void imuCallback(uint8_t *data, uint16_t len, uint32_t ts) {
   glasses.roll  = makeFloat(data);
   glasses.pitch = makeFloat(data + 4);
   glasses.yaw   = makeFloat(data + 8);
+  {
+    std::lock_guard<std::mutex> lk(imu_mutex);
+    imu_ring[imu_written % IMU_RING] = ImuSample{imu_clock(), glasses.roll, glasses.pitch, glasses.yaw};
+    ++imu_written;
+  }
 
   if (len >= 36) {
     glasses.qw = makeFloat(data + 20);
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+// Closed-loop quality governor. Fed the work time of every frame (without the
+// pacing sleep or the capture wait), it steps quality down one level when the
+// frame budget has been missed for a while and back up once there is steady
+// headroom again. Levels are cumulative, in the order load is shed:
+enum GovLevel {
+  GOV_FULL = 0,
+  GOV_BACKGROUND,   // outputs not in the foreground captured at a reduced rate
+  GOV_THUMBNAILS,   // outputs shown only as thumbnails no longer refreshed
+  GOV_SAMPLING,     // no sharpen, no anisotropic filtering
+  GOV_RESOLUTION,   // render scale lowered (render_scale.hpp)
+  GOV_LEVELS
+};
+
+void   governor_set_budget(double budget_us);
+double governor_budget();
+
+// Disabled: level stays GOV_FULL.
+void governor_set_enabled(bool on);
+bool governor_enabled();
+
+// Returns true when the level changed; the decision is logged.
+bool governor_feed(double work_us);
+
+int         governor_level();
+const char* governor_level_name(int level);
+
+// "level=<name> avg_us=<n> budget_us=<n> changes=<n> last=<decision>"
+std::string governor_stats();
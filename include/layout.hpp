@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Workspace layout. Declared in $XDG_CONFIG_HOME/viture/layout
+// (~/.config/viture/layout), same "[section]" / "key=value" syntax as the
+// session state file:
+//
+//   [layout]
+//   mode=ring          # ring (focus stack + thumbnails) | grid | wall | free
+//   width=3.0          # default panel width, height follows the output aspect
+//   distance=4.0       # from the scene center; ring: 0 = fit the arc
+//   arc=40             # ring: degrees between panels
+//   columns=3          # grid / wall
+//   spacing=0.1        # grid / wall gap
+//   thumbnails=1       # thumbnail row for gaze focus (ring: default on)
+//
+//   [panel DP-1]       # output name or index; repeat to cut several views
+//   width=2.5
+//   src=0,0,1920,1080  # source sub-rect in output pixels
+//   split=3            # cut the source into 3 columns (or "cols,rows") views
+//   tilt=5             # degrees about the panel's horizontal axis
+//   roll=0
+//   yaw=-30            # free: direction from the scene center, degrees
+//   pitch=10
+//   distance=3.5
+//   offset=0,0.2,0     # free: extra translation
+//   hidden=1
+//
+// Each output, or each slice of it, is a view: its own panel sampling a UV
+// sub-rect of the output's single shared texture (no extra capture or copy).
+// The views are compiled once per change into a flat list of panel transforms.
+
+enum class LayoutMode { Ring, Grid, Wall, Free };
+
+struct PanelSpec {
+  std::string match;           // output name or index
+  float width = 0;             // 0 = layout default
+  int   src[4] = {0, 0, 0, 0}; // x, y, w, h; w = 0: whole output
+  int   split_cols = 1, split_rows = 1;
+  float tilt = 0, roll = 0;
+  float yaw = 0, pitch = 0, distance = 0;
+  float offset[3] = {0, 0, 0};
+  bool  hidden = false;
+};
+
+struct LayoutConfig {
+  LayoutMode mode = LayoutMode::Ring;
+  float width = 3.0f;
+  float distance = 0;          // 0 = mode default
+  float arc = 40.0f;
+  int   columns = 3;
+  float spacing = 0.1f;
+  int   thumbnails = -1;       // -1 = mode default
+  std::vector<PanelSpec> panels;
+};
+
+enum class PanelKind { Ring, Foreground, Thumbnail, Placed };
+
+struct PanelPlacement {
+  PanelKind kind;
+  int   view;                  // index into the views
+  int   output;                // index into the capture outputs
+  float w, h;
+  float u0, v0, u1, v1;        // part of the output shown
+  float model[16];             // column-major panel -> scene
+};
+
+struct LayoutOutput {
+  std::string name;
+  int width = 0, height = 0;
+};
+
+// A virtual screen: a sub-rect of one output
+struct LayoutView {
+  int output;
+  int src[4];                  // x, y, w, h in output pixels
+  int out_w, out_h;            // output size
+  std::string name;            // output name, "<name>#<k>" for slices
+  int spec;                    // index into LayoutConfig::panels, -1 = none
+};
+
+// Runtime inputs of the ring layout
+struct RingState {
+  std::vector<int> focus;      // focused view stack, front first, -1 = empty slot
+  float arc = 40.0f;           // degrees between ring panels
+  float offset = 0;            // ring rotation, degrees
+};
+
+std::string layout_config_path();
+// Parse the config file; false (and defaults) if it is missing or unreadable.
+bool layout_config_load(LayoutConfig& cfg);
+
+// Start watching the config file (inotify); poll returns true once per change.
+bool layout_watch_init();
+bool layout_watch_poll();
+void layout_watch_shutdown();
+
+// Distance of the ring panels from the scene center.
+float layout_ring_radius(const LayoutConfig& cfg, float arc);
+
+// Views of the outputs, in output order. Hidden panels have none.
+void layout_views(const LayoutConfig& cfg, const std::vector<LayoutOutput>& outs,
+                  std::vector<LayoutView>& views);
+
+void layout_compile(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                    const RingState& ring, std::vector<PanelPlacement>& panels);
@@ -0,0 +1,46 @@
+#pragma once
+#include <cmath>
+
+// Column-major 4x4 matrices in the glMultMatrixf/glRotatef convention.
+
+static inline void mat4_identity(float m[16]) {
+  for (int i = 0; i < 16; ++i) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+// out = a * b (out may alias a or b)
+static inline void mat4_mul(const float a[16], const float b[16], float out[16]) {
+  float r[16];
+  for (int c = 0; c < 4; ++c)
+    for (int row = 0; row < 4; ++row)
+      r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] +
+                       a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+  for (int i = 0; i < 16; ++i) out[i] = r[i];
+}
+
+// m = m * T(x, y, z), like glTranslatef
+static inline void mat4_translate(float m[16], float x, float y, float z) {
+  float t[16];
+  mat4_identity(t);
+  t[12] = x; t[13] = y; t[14] = z;
+  mat4_mul(m, t, m);
+}
+
+// m = m * R(deg, axis), like glRotatef (axis must be unit length)
+static inline void mat4_rotate(float m[16], float deg, float x, float y, float z) {
+  const float a = deg * float(M_PI) / 180.0f, c = std::cos(a), s = std::sin(a), k = 1 - c;
+  const float r[16] = {
+    x * x * k + c,     y * x * k + z * s, x * z * k - y * s, 0,
+    x * y * k - z * s, y * y * k + c,     y * z * k + x * s, 0,
+    x * z * k + y * s, y * z * k - x * s, z * z * k + c,     0,
+    0,                 0,                 0,                 1,
+  };
+  mat4_mul(m, r, m);
+}
+
+// Transform a point / direction
+static inline void mat4_point(const float m[16], const float p[3], float out[3]) {
+  for (int i = 0; i < 3; ++i) out[i] = m[i] * p[0] + m[4 + i] * p[1] + m[8 + i] * p[2] + m[12 + i];
+}
+static inline void mat4_dir(const float m[16], const float d[3], float out[3]) {
+  for (int i = 0; i < 3; ++i) out[i] = m[i] * d[0] + m[4 + i] * d[1] + m[8 + i] * d[2];
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <GL/gl.h>
+
+// Colour (RGBA8) + depth (24-bit) renderbuffer target, shared by the render
+// scale, the foveation periphery and the headless backends. Needs a current
+// GL context for every call.
+struct OffscreenTarget {
+  GLuint fbo = 0, color_rb = 0, depth_rb = 0;
+  int    w = 0, h = 0;
+  GLint  prev_fbo = 0;   // draw framebuffer bound before target_bind
+};
+
+// (Re)allocate for w x h unless it already is that size. False (target freed)
+// beyond the renderbuffer size limit or if the framebuffer is incomplete.
+// Leaves the current framebuffer binding alone.
+bool target_ensure(OffscreenTarget& t, int w, int h);
+// Remember the bound draw framebuffer, bind the target and set the viewport.
+void target_bind(OffscreenTarget& t);
+// Linear blit into the framebuffer bound before target_bind, which is bound
+// again with a w x h viewport.
+void target_blit_to_prev(OffscreenTarget& t, int w, int h);
+void target_free(OffscreenTarget& t);
@@ -0,0 +1,47 @@
+#pragma once
+#include "capture_multi.hpp"
+
+#include <vector>
+
+// Fragment program used to draw output panels. Magnified and ~1:1 panels are
+// sampled bilinearly with a contrast-adaptive sharpen; minified panels blend
+// into a half-size mip chain kept per capture texture (trilinear, optionally
+// anisotropic), which is refreshed only over the rows damaged by the last
+// capture. Half-float (scRGB) captures are linear with 1.0 = SDR white; they
+// are tone-mapped (extended Reinhard) and sRGB-encoded here.
+// Needs a current GL context; without GLSL panels fall back to fixed function.
+
+bool panel_shader_init();        // compile; false leaves fixed function in use
+void panel_shader_shutdown();
+
+// Refresh mip chains after wlr_multi_next_frame.
+void panel_shader_update(const std::vector<CapturedOutput>& outs);
+
+// Bind the program and textures for `o` (its texture already bound to unit 0)
+// before drawing its quad; end unbinds.
+void panel_shader_begin(const CapturedOutput& o);
+void panel_shader_end();
+
+// Linear scale applied before tone mapping (1.0 = as captured).
+void  panel_shader_set_exposure(float e);
+float panel_shader_exposure();
+
+// Sharpen strength, 0 (off) .. 1.
+void  panel_shader_set_sharpness(float s);
+float panel_shader_sharpness();
+
+// Max anisotropy for minified panels, 1 = trilinear only. Clamped to the driver limit.
+void  panel_shader_set_anisotropy(float a);
+float panel_shader_anisotropy();
+
+// Mip-based minification on/off (off: plain bilinear, no mip updates).
+void panel_shader_set_mips(bool on);
+bool panel_shader_mips();
+
+// Cheap sampling (no sharpen) for panels drawn at reduced resolution.
+void panel_shader_set_cheap(bool on);
+
+// Reduced quality under load: no sharpen and no anisotropic filtering, whatever
+// the settings above (which are kept for when it is switched off).
+void panel_shader_set_reduced(bool on);
+bool panel_shader_reduced();
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+// Row converters for the wl_shm capture path. Every supported shm layout is
+// converted to BGRA8 (GL_BGRA / GL_UNSIGNED_BYTE, alpha forced opaque), the
+// upload format drivers take without a CPU-side repack. Picks AVX2, SSE2,
+// NEON or scalar code once at runtime.
+
+enum class PixelLayout {
+  XRGB8888,      // also ARGB8888
+  XBGR8888,      // also ABGR8888
+  XRGB2101010,   // also ARGB2101010
+  XBGR2101010,   // also ABGR2101010
+};
+
+// Map a wl_shm format code to a layout we can convert. False if unsupported.
+bool pixel_layout_from_shm(uint32_t shm_format, PixelLayout& out);
+
+// Convert `width` pixels of one row.
+void pixel_convert_row(PixelLayout layout, const uint32_t* src, uint32_t* dst, int width);
+
+// Name of the implementation in use ("avx2", "sse2", "neon", "scalar").
+const char* pixel_convert_impl();
@@ -1,7 +1,24 @@
 #pragma once
+#include <EGL/egl.h>
+
+// Window/display. The backend is picked at init from $VITURE_PLATFORM:
+//   glfw (default)       window on the desktop, composited by the compositor
+//   kms                  DRM lease of the glasses connector (wp_drm_lease_v1)
+//   kms:/dev/dri/cardN   that device directly (DRM master, e.g. vkms or a VT)
+//   surfaceless          headless, EGL_MESA_platform_surfaceless (llvmpipe works)
+//   gbm[:/dev/dri/renderDN]  headless on that GPU
+// The kms backends take $VITURE_KMS_CONNECTOR (e.g. "DP-2") to pick a connector.
+// Headless backends draw into an offscreen framebuffer of the requested size
+// and stop after $VITURE_HEADLESS_FRAMES frames (unset: on SIGINT/SIGTERM).
 void init_window_and_gl(int width, int height, const char* title);
+const char* platform_name();
+// Display of the GL context, for EGLImage imports
+EGLDisplay platform_egl_display();
 bool window_should_close();
 void window_poll();
 void window_swap();
 void window_get_framebuffer_size(int* w, int* h);
+// Refresh rate window_swap() paces the loop to (kms: the scanout mode),
+// 0 when it returns without waiting for vblank
+int platform_refresh_hz();
 void shutdown_window();
@@ -0,0 +1,24 @@
+#pragma once
+#include <EGL/egl.h>
+
+// One window/display backend behind platform.hpp. init() leaves a GL 3.3
+// compatibility context current on the calling thread, created through EGL
+// (capture imports dma-bufs on egl_display()).
+struct PlatformBackend {
+  const char* name;
+  // `arg` is the part of VITURE_PLATFORM after "name:" ("" if none)
+  void (*init)(int width, int height, const char* title, const char* arg);
+  bool (*should_close)();
+  void (*poll)();
+  void (*swap)();
+  void (*framebuffer_size)(int* w, int* h);
+  void (*shutdown)();
+  EGLDisplay (*egl_display)();
+  // Refresh rate swap() waits for (vblank), 0 if it does not block
+  int (*refresh_hz)();
+};
+
+const PlatformBackend* platform_glfw();
+const PlatformBackend* platform_kms();
+const PlatformBackend* platform_surfaceless();
+const PlatformBackend* platform_gbm();
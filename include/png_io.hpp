@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal PNG I/O on zlib: 8-bit RGBA, non-interlaced. Enough for frame dumps
+// and golden images, which are all written by png_write_rgba.
+
+// `px` is w*h*4 bytes; `bottom_up` for glReadPixels row order.
+bool png_write_rgba(const std::string& path, const uint8_t* px, int w, int h, bool bottom_up);
+// Rows top-down. False on I/O errors and on any other PNG flavour.
+bool png_read_rgba(const std::string& path, std::vector<uint8_t>& px, int& w, int& h);
@@ -0,0 +1,39 @@
+#pragma once
+#include "capture_multi.hpp"
+
+#include <string>
+#include <vector>
+
+// Render regression check, run instead of the app when $VITURE_RENDER_CHECK
+// names a directory (see main.cpp): fixed scenarios over synthetic outputs
+// with the built-in layout, compared with golden images and frame time
+// baselines kept in that directory. Meant for the surfaceless backend on
+// llvmpipe, whose output does not depend on the machine's GPU:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 VITURE_RENDER_CHECK=goldens viture_ar_desktop_wayland_dmabuf
+//
+// The llvmpipe goldens live in tests/render_check (ctest runs them). A missing
+// golden fails the check; $VITURE_RENDER_CHECK_UPDATE=1 records or rewrites
+// all goldens and baselines. Frame times only fail the check with
+// $VITURE_RENDER_CHECK_TIMING=gate, which ctest does not set: they depend on
+// the runner even as ratios.
+
+// `n` outputs of w x h, each with its own test pattern, converted and uploaded
+// like wl_shm captures. Returns the time the import took, in ms.
+double rcheck_make_outputs(int n, int w, int h, std::vector<CapturedOutput>& outs);
+void   rcheck_free_outputs(std::vector<CapturedOutput>& outs);
+
+// Compare the bound framebuffer (w x h) with <dir>/<name>.png. A pixel with a
+// channel more than a few levels off is bad; a handful of bad pixels (panel
+// edges rasterised differently) still pass. A failing frame, or one without a
+// golden, is kept as <dir>/<name>.actual.png.
+bool rcheck_compare(const std::string& dir, const std::string& name, int w, int h,
+                    bool update, std::string& msg);
+
+// Scenario render time (median, us) relative to ref_us, the reference
+// scenario's time from the same run, against the ratio kept in <dir>/timings.
+// With `gate` a ratio beyond 1.5x its baseline, or no baseline, fails;
+// without, the timing is only reported. rcheck_finish writes new baselines.
+bool rcheck_time(const std::string& dir, const std::string& name, double us, double ref_us,
+                 bool gate, bool update, std::string& msg);
+void rcheck_finish(const std::string& dir);
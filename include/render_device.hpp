@@ -0,0 +1,22 @@
+#pragma once
+#include <sys/types.h>
+
+struct gbm_device;
+
+// The GPU capture buffers are allocated on: one render node and GBM device
+// shared by every capture source. Picked, first match wins, from
+//   $VITURE_RENDER_NODE
+//   the compositor's main device (linux-dmabuf v4 default feedback)
+//   the render node of the platform EGL display (EGL_EXT_device_query)
+//   the first render node on the system
+// On hybrid laptops the compositor's device is the one that keeps its copy
+// into our buffers zero-copy; a mismatch with the GL device is logged.
+
+// Compositor's main device; call before the first render_device_acquire().
+void render_device_set_main(dev_t dev);
+
+// Open on first use (reference counted); nullptr with a log line if none.
+gbm_device* render_device_acquire();
+void        render_device_release();
+
+const char* render_device_path();   // "" while closed
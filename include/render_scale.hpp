@@ -0,0 +1,25 @@
+#pragma once
+
+// Render scale. The scene is drawn into an offscreen target of scale x the
+// window size and resolved into the window: bilinear upscale below 1 (headroom
+// on weak GPUs), box-filtered downsample above 1 (supersampled text). At 1 it
+// draws straight into the window. Usage per frame, with a current GL context:
+//
+//   int sw, sh;
+//   rscale_begin(w, h, sw, sh);   // draw the scene at sw x sh
+//   ...
+//   rscale_end();
+
+void  rscale_set(float s);            // user setting, 0.5 .. 2
+float rscale();
+// Multiplies the setting (quality governor); the product is kept >= 0.5.
+void  rscale_set_load_factor(float f);
+float rscale_effective();
+
+// Bind the scene target sized for a w x h window and set the viewport;
+// `sw` x `sh` is the size to draw at. False when drawing straight to the window.
+bool rscale_begin(int w, int h, int& sw, int& sh);
+// Resolve into the window framebuffer and restore its viewport.
+void rscale_end();
+
+void rscale_shutdown();
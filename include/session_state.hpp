@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Persistent session state in $XDG_STATE_HOME/viture/state (~/.local/state/viture/state).
+// One "[layout <names>]" section per set of connected outputs, plus one
+// "[output <name>]" section per output caching its capture size/format so the
+// next start can skip the screencopy probe. Writes are atomic (tmp + rename).
+
+struct SessionState {
+  double fov          = 40.0;
+  float  zoom         = 1.0f;
+  float  angle_offset = 0.0f;
+  bool   center_dot   = true;
+  bool   roi          = false;
+  float  oroll = 0.0f, opitch = 0.0f, oyaw = 0.0f;
+  std::vector<std::string> focus;   // focused monitor stack by output name, "-" = empty slot
+};
+
+struct OutputCache {
+  std::string name;
+  int         width  = 0;
+  int         height = 0;
+  uint32_t    fourcc = 0;
+};
+
+// Key for a set of outputs (order-insensitive).
+std::string session_layout_key(std::vector<std::string> output_names);
+
+bool session_load(const std::string& layout_key, SessionState& st);
+bool session_save(const std::string& layout_key, const SessionState& st);
+
+std::vector<OutputCache> session_load_outputs();
+bool session_save_outputs(const std::vector<OutputCache>& outs);
+
+// $XDG_STATE_HOME/viture/<sub> (or ~/.local/state/...), created if missing;
+// empty when there is no usable state directory.
+std::string session_state_subdir(const std::string& sub);
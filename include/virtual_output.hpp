@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Headless outputs that exist only in the glasses. Created and removed through
+// sway IPC ($SWAYSOCK: "create_output", "output <name> mode --custom ...",
+// "output <name> unplug"); the capture then picks them up as ordinary
+// wl_outputs (see wlr_multi_update_outputs). Calls block on the IPC socket.
+
+bool vout_available();   // $SWAYSOCK set
+
+// Create a w x h @ refresh_hz output. Returns its name, or "" with `err` set.
+std::string vout_create(int w, int h, int refresh_hz, std::string& err);
+
+// Remove an output created by vout_create.
+bool vout_destroy(const std::string& name, std::string& err);
+void vout_destroy_all();
+
+const std::vector<std::string>& vout_list();
+
+// Output size whose pixels map 1:1 onto the glasses when shown as a panel
+// `panel_w` wide, `distance` from the eye, straight ahead: the glasses render
+// `fb_h` rows over a vertical fov of `vfov_deg`. `aspect` is height / width.
+// Rounded to 8 pixels.
+void vout_match_density(float panel_w, float distance, double vfov_deg, int fb_h,
+                        float aspect, int& w, int& h);
@@ -0,0 +1,148 @@
+#include "buffer_pool.hpp"
+
+#include <gbm.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+struct PoolBuf {
+  int         fd = -1;
+  uint32_t    stride = 0;
+  int         bw = 0, bh = 0;     // allocated (bucket) size
+  uint32_t    fourcc = 0;
+  size_t      bytes = 0;
+  std::string owner;              // "" while parked
+  uint64_t    parked_at = 0;
+};
+
+static std::vector<PoolBuf> bufs;
+static size_t   budget = size_t(512) << 20;
+static uint64_t tick = 0;
+static long     hits = 0, misses = 0, evictions = 0;
+static bool     over_warned = false;
+
+// Bucket edges: coarse enough that a drifting region reuses its buffer, fine
+// enough that the slack stays a few percent of a full output.
+static const int BUCKET_W = 256;
+static const int BUCKET_H = 128;
+
+static int round_up(int v, int m) { return (v + m - 1) / m * m; }
+
+static void free_buf(size_t i) {
+  close(bufs[i].fd);
+  bufs.erase(bufs.begin() + i);
+}
+
+size_t pool_total() {
+  size_t t = 0;
+  for (const PoolBuf& b : bufs) t += b.bytes;
+  return t;
+}
+
+// Evict parked buffers, oldest first, until the total is at most `limit`
+static void evict_to(size_t limit) {
+  while (pool_total() > limit) {
+    size_t oldest = bufs.size();
+    for (size_t i = 0; i < bufs.size(); ++i)
+      if (bufs[i].owner.empty() && (oldest == bufs.size() || bufs[i].parked_at < bufs[oldest].parked_at))
+        oldest = i;
+    if (oldest == bufs.size()) return;
+    free_buf(oldest);
+    ++evictions;
+  }
+}
+
+static void check_budget() {
+  const bool over = pool_total() > budget;
+  if (over && !over_warned)
+    fprintf(stderr, "[pool] live capture buffers use %zu MB, over the %zu MB budget\n",
+            pool_total() >> 20, budget >> 20);
+  over_warned = over;
+}
+
+int pool_acquire(gbm_device* gbm, int w, int h, uint32_t fourcc, const std::string& owner,
+                 uint32_t& stride) {
+  const int bw = round_up(w, BUCKET_W), bh = round_up(h, BUCKET_H);
+  for (PoolBuf& b : bufs) {
+    if (!b.owner.empty() || b.fourcc != fourcc || b.bw != bw || b.bh != bh) continue;
+    b.owner = owner;
+    stride = b.stride;
+    ++hits;
+    return b.fd;
+  }
+  ++misses;
+
+  gbm_bo* bo = gbm_bo_create(gbm, bw, bh, fourcc, GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
+  if (!bo) {
+    // Out of memory is the likely cause: drop everything parked and retry
+    evict_to(0);
+    bo = gbm_bo_create(gbm, bw, bh, fourcc, GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
+    if (!bo) return -1;
+  }
+  PoolBuf nb;
+  nb.fd = gbm_bo_get_fd(bo);
+  nb.stride = gbm_bo_get_stride(bo);
+  gbm_bo_destroy(bo); // the fd keeps the memory; we don't keep the bo
+  if (nb.fd < 0) return -1;
+  nb.bw = bw; nb.bh = bh;
+  nb.fourcc = fourcc;
+  nb.bytes = size_t(nb.stride) * bh;
+  nb.owner = owner;
+
+  evict_to(budget > nb.bytes ? budget - nb.bytes : 0);
+  bufs.push_back(nb);
+  check_budget();
+  stride = nb.stride;
+  return nb.fd;
+}
+
+void pool_release(int fd) {
+  if (fd < 0) return;
+  for (PoolBuf& b : bufs) {
+    if (b.fd != fd) continue;
+    b.owner.clear();
+    b.parked_at = ++tick;
+    evict_to(budget);
+    check_budget();
+    return;
+  }
+  close(fd);   // not ours
+}
+
+void pool_set_budget(size_t bytes) {
+  budget = bytes;
+  evict_to(budget);
+  check_budget();
+}
+size_t pool_budget() { return budget; }
+
+void pool_clear() {
+  for (size_t i = bufs.size(); i-- > 0;)
+    if (bufs[i].owner.empty()) free_buf(i);
+}
+
+std::string pool_stats() {
+  size_t live = 0, parked = 0;
+  std::map<std::string, size_t> owners;
+  for (const PoolBuf& b : bufs) {
+    if (b.owner.empty()) { parked += b.bytes; continue; }
+    live += b.bytes;
+    owners[b.owner] += b.bytes;
+  }
+  std::string per;
+  for (const auto& kv : owners) {
+    char o[96];
+    snprintf(o, sizeof(o), "%s%s:%.1f", per.empty() ? "" : ",", kv.first.c_str(), kv.second / 1048576.0);
+    per += o;
+  }
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "total_mb=%.1f live_mb=%.1f parked_mb=%.1f budget_mb=%zu hits=%ld misses=%ld "
+           "evictions=%ld owners=",
+           (live + parked) / 1048576.0, live / 1048576.0, parked / 1048576.0, budget >> 20, hits,
+           misses, evictions);
+  return buf + (per.empty() ? std::string("-") : per);
+}
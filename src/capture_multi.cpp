@@ -1,6 +1,10 @@
 // src/capture_multi.cpp
 #include "capture_multi.hpp" // assumes this declares CapturedOutput{int x,y,width,height; GLuint texture;}
                              // and functions: wlr_multi_capture_init, wlr_multi_next_frame, wlr_multi_shutdown
+#include "buffer_pool.hpp"
+#include "pixel_convert.hpp"
+#include "platform.hpp"
+#include "render_device.hpp"
 
 #include <wayland-client.h>
 #include <EGL/egl.h>
@@ -8,19 +12,30 @@
 #include <GL/gl.h>
 
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <gbm.h>
 #include <xf86drm.h>
 #include <drm_fourcc.h>
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
+#include <string>
 #include <stdexcept>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 
 // Generated by wayland-scanner
 #include "wlr-screencopy-unstable-v1-client-protocol.h"
 #include "linux-dmabuf-unstable-v1-client-protocol.h"
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+#include "ext-foreign-toplevel-list-v1-client-protocol.h"
+#include "ext-image-capture-source-v1-client-protocol.h"
+#include "ext-image-copy-capture-v1-client-protocol.h"
+#endif
 
 // ---- GL/EGL function pointers (loaded at runtime) ----
 static PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_ = nullptr;
@@ -29,14 +44,44 @@ static PFNEGLDESTROYIMAGEKHRPROC  p_eglDestroyImageKHR  = nullptr;
 static PFNEGLCREATEIMAGEPROC      p_eglCreateImage      = nullptr;
 static PFNEGLDESTROYIMAGEPROC     p_eglDestroyImage     = nullptr;
 
+// wl_shm fallback: buffers per output in the memfd pool ring
+static const int SHM_RING = 2;
+
+struct CursorCtx;
+
 struct OutputCtx {
   // Wayland output + per-frame state
   wl_output*   wlo         = nullptr;
+  uint32_t     global      = 0;       // registry name, for global_remove
+  bool         removed     = false;   // global gone, released by wlr_multi_update_outputs
+  int          probe_tries = 0;       // failed probes of a hotplugged output
   int          width       = 0;
   int          height      = 0;
-  uint32_t     fourcc      = DRM_FORMAT_XRGB8888;
+  uint32_t     fourcc      = DRM_FORMAT_XRGB8888;   // negotiated dma-buf format
+  uint32_t     buf_fourcc  = 0;                     // format our buffer was allocated with
+  int          buf_w = 0, buf_h = 0;                // and its size
+  std::vector<uint32_t> dmabuf_offers;              // linux_dmabuf offers of the current frame
   bool         got_dmabuf_announce = false;
   bool         frame_ready = false;
+  bool         frame_failed = false;
+  bool         buffer_done = false;   // all buffer offers for the frame received
+
+  // wl_shm offer from the buffer event
+  uint32_t     shm_format  = 0;
+  uint32_t     shm_stride  = 0;
+
+  // wl_output metadata
+  std::string  name;
+  int          scale       = 1;
+  int          out_w       = 0;   // full output size in buffer pixels (from probe)
+  int          out_h       = 0;
+  bool         resized     = false;   // out_w/out_h changed, reported by wlr_multi_update_outputs
+
+  // Region of interest (output pixels). roi_w/roi_h == 0 -> whole output.
+  int          roi_x = 0, roi_y = 0, roi_w = 0, roi_h = 0;
+  // Sub-rect currently held in the buffer, and the requested size it was allocated for
+  int          src_x = 0, src_y = 0, src_w = 0, src_h = 0;
+  int          alloc_req_w = 0, alloc_req_h = 0;
 
   // Our dma-buf and wl_buffer wrapping it
   int          dmabuf_fd   = -1;
@@ -44,6 +89,36 @@ struct OutputCtx {
   uint32_t     offset      = 0;
   wl_buffer*   wlbuf       = nullptr;
 
+  // wl_shm fallback: one memfd pool holding SHM_RING buffers. The compositor
+  // copies into one slot while we convert the previous one into a PBO.
+  int          shm_fd      = -1;
+  uint8_t*     shm_map     = nullptr;
+  size_t       shm_size    = 0;
+  wl_shm_pool* shm_pool    = nullptr;
+  wl_buffer*   shm_bufs[SHM_RING] = {};
+  int          shm_cur     = 0;       // slot the next/current copy targets
+  int          shm_w = 0, shm_h = 0;  // size the ring was allocated for
+  uint32_t     shm_ring_format = 0, shm_ring_stride = 0;   // and its buffers' format
+  PixelLayout  shm_layout  = PixelLayout::XRGB8888;
+  zwlr_screencopy_frame_v1* shm_inflight = nullptr;
+  GLuint       pbo[SHM_RING] = {};
+  int          pbo_cur     = 0;
+  bool         tex_alloc   = false;   // texture storage matches shm_w x shm_h
+
+  // dma-buf copy still running from an earlier wlr_multi_next_frame, and the
+  // rect it was asked for (becomes src_* when it lands)
+  zwlr_screencopy_frame_v1* dma_inflight = nullptr;
+  int          pend_x = 0, pend_y = 0, pend_w = 0, pend_h = 0;
+  bool         dma_awaiting = false;   // copy not issued yet: waits for the buffer offer
+  // Capture every `interval`-th frame (0 = paused); `idle` counts frames since the last
+  int          interval = 1;
+  int          idle     = 0;
+
+  // Damaged rows reported for the current copy, [dmg_y0, dmg_y1)
+  int          dmg_y0 = 0, dmg_y1 = 0;
+  // Texture rows changed by the last wlr_multi_next_frame, [upd_y0, upd_y1)
+  int          upd_y0 = 0, upd_y1 = 0;
+
   // GL/EGL resources
   EGLImageKHR  egl_img     = EGL_NO_IMAGE_KHR;
   GLuint       texture     = 0;
@@ -51,7 +126,77 @@ struct OutputCtx {
   // Placement (no xdg-output; we synthesize a layout)
   int          x = 0;
   int          y = 0;
+
+  // dma-buf path: the compositor copies into `spare` while the texture shows
+  // the buffer above; a finished copy swaps the two (swap_dma_slot), so a copy
+  // still running never shows in the texture. Same fields as the shown buffer.
+  struct DmaSlot {
+    int         fd     = -1;
+    uint32_t    stride = 0;
+    wl_buffer*  buf    = nullptr;
+    EGLImageKHR img    = EGL_NO_IMAGE_KHR;
+    uint32_t    fourcc = 0;
+    int         w = 0, h = 0, req_w = 0, req_h = 0;
+  } spare;
+
+  // Window source (ext-image-copy-capture session on a toplevel, no wl_output).
+  // It keeps one capture in flight and never blocks the frame; on the shm path
+  // the SHM_RING slots play the role of `spare`.
+  bool         window = false;
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  ext_image_capture_source_v1*       win_source  = nullptr;
+  ext_image_copy_capture_session_v1* win_session = nullptr;
+  ext_image_copy_capture_frame_v1*   win_frame   = nullptr;
+#endif
+  int          sess_w = 0, sess_h = 0;            // session buffer constraints
+  bool         shm_format_set = false;            // usable shm format offered this round
+  int          prev_dmg_y0 = 0, prev_dmg_y1 = 0;  // damage of the last finished frame
+  int          fresh_slots = 0;                   // slots whose content is unknown
+
+  // Pointer on this output, tracked outside the screencopy (outputs only)
+  CursorCtx*   cursor = nullptr;
+};
+
+// Pointer overlay for one output: an ext-image-copy-capture cursor session
+// reports position and hotspot as the pointer moves, and a capture of the
+// cursor image completes only when the image changes. Outputs are captured
+// without the cursor, so pointer motion never forces an output copy.
+struct CursorCtx {
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  ext_image_capture_source_v1*              source  = nullptr;
+  ext_image_copy_capture_cursor_session_v1* session = nullptr;
+  ext_image_copy_capture_session_v1*        image   = nullptr;
+  ext_image_copy_capture_frame_v1*          frame   = nullptr;
+#endif
+  bool         inside = false;
+  int          x = 0, y = 0;           // pointer position, output buffer pixels
+  int          hot_x = 0, hot_y = 0;   // hotspot within the image
+
+  // Image constraints and our single shm buffer (cursor images are tiny)
+  int          sess_w = 0, sess_h = 0;
+  uint32_t     shm_format = 0;
+  bool         format_set = false;
+  bool         constraints = false;
+  bool         ready = false, failed = false, stopped = false;
+  int          fd = -1;
+  uint8_t*     map = nullptr;
+  size_t       size = 0;
+  wl_shm_pool* pool = nullptr;
+  wl_buffer*   buf = nullptr;
+  int          buf_w = 0, buf_h = 0;
+
+  GLuint       tex = 0;
+  int          tex_w = 0, tex_h = 0;
+};
+
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+// Toplevel from ext_foreign_toplevel_list_v1
+struct Toplevel {
+  ext_foreign_toplevel_handle_v1* handle = nullptr;
+  std::string id, title, app_id;
+  bool        closed = false;
 };
+#endif
 
 struct MultiCtx {
   // Wayland core
@@ -60,17 +205,47 @@ struct MultiCtx {
 
   // Protocols
   zwlr_screencopy_manager_v1* screencopy   = nullptr;
+  uint32_t                    screencopy_ver = 0;
   zwp_linux_dmabuf_v1*        linux_dmabuf = nullptr;
+  uint32_t                    linux_dmabuf_ver = 0;
+  wl_shm*                     shm          = nullptr;
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  ext_foreign_toplevel_list_v1*                          toplevel_list = nullptr;
+  ext_foreign_toplevel_image_capture_source_manager_v1*  toplevel_sources = nullptr;
+  ext_image_copy_capture_manager_v1*                     copy_capture = nullptr;
+  ext_output_image_capture_source_manager_v1*            output_sources = nullptr;
+  std::vector<Toplevel*>                                 toplevels;
+#endif
+  // Pointer of the first seat, for cursor sessions
+  wl_seat*    seat    = nullptr;
+  wl_pointer* pointer = nullptr;
+  bool        cursor_warned = false;
+
+  // Capture through wl_shm + CPU upload instead of dma-buf (no dmabuf/GBM)
+  bool        use_shm = false;
 
-  // DRM/GBM shared
-  int         drm_fd = -1;
+  // GBM device (render_device.hpp, shared with other capture sources)
   gbm_device* gbm    = nullptr;
 
   // EGL
   EGLDisplay  egl_dpy = EGL_NO_DISPLAY;
+  std::vector<uint32_t> egl_formats;   // dma-buf formats EGL can import (empty: unknown)
+  bool        egl_formats_loaded = false;
+
+  // Longest wait for dma-buf copies per frame (us, < 0 = all), and the last wait
+  long        wait_budget_us = -1;
+  long        last_wait_us   = 0;
 
   // Outputs we found
   std::vector<OutputCtx*> outs;
+  // Outputs announced after init, probed by wlr_multi_update_outputs
+  std::vector<OutputCtx*> added;
+  // Window sources waiting for their first frame
+  std::vector<OutputCtx*> added_windows;
+  bool        ready = false;   // initial probe done
+
+  // Cached size/format per output name (fast start, see wlr_multi_set_hints)
+  std::vector<CaptureHint> hints;
 } static M;
 
 // --------- Logging (optional) ----------
@@ -95,16 +270,119 @@ static void ensure_egl_image_fns() {
   if (!p_eglCreateImageKHR && !p_eglCreateImage)
     throw std::runtime_error("No eglCreateImage(KHR) function available from EGL");
 }
-static int open_render_node() {
-  const char* cands[] = {
-    "/dev/dri/renderD128", "/dev/dri/renderD129", "/dev/dri/renderD130"
-  };
-  for (const char* p : cands) {
-    int fd = open(p, O_RDWR | O_CLOEXEC);
-    if (fd >= 0) return fd;
+// Compositor's main device from the default dma-buf feedback (v4), so our
+// buffers live on the GPU it copies with
+static void fb_done(void* data, zwp_linux_dmabuf_feedback_v1*) { *static_cast<bool*>(data) = true; }
+static void fb_format_table(void*, zwp_linux_dmabuf_feedback_v1*, int32_t fd, uint32_t) { close(fd); }
+static void fb_main_device(void*, zwp_linux_dmabuf_feedback_v1*, wl_array* dev) {
+  dev_t d;
+  if (dev->size != sizeof(d)) return;
+  memcpy(&d, dev->data, sizeof(d));
+  render_device_set_main(d);
+}
+static void fb_tranche_done(void*, zwp_linux_dmabuf_feedback_v1*) {}
+static void fb_tranche_target_device(void*, zwp_linux_dmabuf_feedback_v1*, wl_array*) {}
+static void fb_tranche_formats(void*, zwp_linux_dmabuf_feedback_v1*, wl_array*) {}
+static void fb_tranche_flags(void*, zwp_linux_dmabuf_feedback_v1*, uint32_t) {}
+static const zwp_linux_dmabuf_feedback_v1_listener FEEDBACK_LST = {
+  fb_done, fb_format_table, fb_main_device, fb_tranche_done, fb_tranche_target_device,
+  fb_tranche_formats, fb_tranche_flags
+};
+
+static void query_main_device() {
+  if (!M.linux_dmabuf || M.linux_dmabuf_ver < 4) return;
+  bool done = false;
+  zwp_linux_dmabuf_feedback_v1* fb = zwp_linux_dmabuf_v1_get_default_feedback(M.linux_dmabuf);
+  zwp_linux_dmabuf_feedback_v1_add_listener(fb, &FEEDBACK_LST, &done);
+  while (!done)
+    if (wl_display_roundtrip(M.display) < 0) break;
+  zwp_linux_dmabuf_feedback_v1_destroy(fb);
+}
+
+// Takes the shared GBM device once. False (with a log line) if unusable.
+static bool init_gbm() {
+  if (M.gbm) return true;
+  query_main_device();
+  M.gbm = render_device_acquire();
+  return M.gbm != nullptr;
+}
+
+// --------- wl_output listener (name + scale for region capture) ----------
+static void out_geometry(void*, wl_output*, int32_t, int32_t, int32_t, int32_t, int32_t,
+                         const char*, const char*, int32_t) {}
+static void out_mode(void*, wl_output*, uint32_t, int32_t, int32_t, int32_t) {}
+static void out_done(void*, wl_output*) {}
+static void out_scale(void* data, wl_output*, int32_t factor) {
+  auto* C = static_cast<OutputCtx*>(data);
+  C->scale = factor > 0 ? factor : 1;
+}
+static void out_name(void* data, wl_output*, const char* name) {
+  auto* C = static_cast<OutputCtx*>(data);
+  C->name = name ? name : "";
+}
+static void out_description(void*, wl_output*, const char*) {}
+static const wl_output_listener OUT_LST = {
+  out_geometry, out_mode, out_done, out_scale, out_name, out_description
+};
+
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+// --------- Foreign toplevel list (windows we can capture) ----------
+static void tl_closed(void* data, ext_foreign_toplevel_handle_v1*) {
+  static_cast<Toplevel*>(data)->closed = true;
+}
+static void tl_done(void*, ext_foreign_toplevel_handle_v1*) {}
+static void tl_title(void* data, ext_foreign_toplevel_handle_v1*, const char* title) {
+  static_cast<Toplevel*>(data)->title = title ? title : "";
+}
+static void tl_app_id(void* data, ext_foreign_toplevel_handle_v1*, const char* app_id) {
+  static_cast<Toplevel*>(data)->app_id = app_id ? app_id : "";
+}
+static void tl_identifier(void* data, ext_foreign_toplevel_handle_v1*, const char* id) {
+  static_cast<Toplevel*>(data)->id = id ? id : "";
+}
+static const ext_foreign_toplevel_handle_v1_listener TOPLEVEL_LST = {
+  tl_closed, tl_done, tl_title, tl_app_id, tl_identifier
+};
+
+static void tll_toplevel(void*, ext_foreign_toplevel_list_v1*, ext_foreign_toplevel_handle_v1* h) {
+  auto* T = new Toplevel();
+  T->handle = h;
+  ext_foreign_toplevel_handle_v1_add_listener(h, &TOPLEVEL_LST, T);
+  M.toplevels.push_back(T);
+}
+static void tll_finished(void*, ext_foreign_toplevel_list_v1*) {}
+static const ext_foreign_toplevel_list_v1_listener TOPLEVEL_LIST_LST = { tll_toplevel, tll_finished };
+
+// --------- Seat (pointer for cursor sessions) ----------
+static void cursor_destroy(CursorCtx* K);
+
+static void seat_capabilities(void*, wl_seat* seat, uint32_t caps) {
+  const bool has = caps & WL_SEAT_CAPABILITY_POINTER;
+  if (has && !M.pointer) {
+    M.pointer = wl_seat_get_pointer(seat);
+  } else if (!has && M.pointer) {
+    // Cursor sessions follow the pointer they were created for: drop them
+    // first; update_cursors starts new ones if a pointer comes back
+    for (auto* C : M.outs)
+      if (C->cursor) { cursor_destroy(C->cursor); C->cursor = nullptr; }
+    if (wl_pointer_get_version(M.pointer) >= WL_POINTER_RELEASE_SINCE_VERSION) wl_pointer_release(M.pointer);
+    else wl_pointer_destroy(M.pointer);
+    M.pointer = nullptr;
+  }
+}
+static void seat_name(void*, wl_seat*, const char*) {}
+static const wl_seat_listener SEAT_LST = { seat_capabilities, seat_name };
+
+static void purge_toplevels() {
+  for (size_t i = 0; i < M.toplevels.size();) {
+    Toplevel* T = M.toplevels[i];
+    if (!T->closed) { ++i; continue; }
+    ext_foreign_toplevel_handle_v1_destroy(T->handle);
+    delete T;
+    M.toplevels.erase(M.toplevels.begin() + i);
   }
-  throw std::runtime_error("Failed to open DRM render node (/dev/dri/renderD12x)");
 }
+#endif
 
 // --------- Wayland registry ----------
 static void reg_global(void*, wl_registry* reg, uint32_t name, const char* iface, uint32_t ver) {
@@ -113,26 +391,146 @@ static void reg_global(void*, wl_registry* reg, uint32_t name, const char* iface
     wl_output* out = (wl_output*)wl_registry_bind(reg, name, &wl_output_interface, v);
     auto* ctx = new OutputCtx();
     ctx->wlo = out;
-    M.outs.push_back(ctx);
+    ctx->global = name;
+    wl_output_add_listener(out, &OUT_LST, ctx);
+    if (M.ready) M.added.push_back(ctx);
+    else         M.outs.push_back(ctx);
   } else if (strcmp(iface, zwlr_screencopy_manager_v1_interface.name) == 0) {
     uint32_t v = ver >= 3 ? 3 : ver;
+    M.screencopy_ver = v;
     M.screencopy = (zwlr_screencopy_manager_v1*)
       wl_registry_bind(reg, name, &zwlr_screencopy_manager_v1_interface, v);
   } else if (strcmp(iface, zwp_linux_dmabuf_v1_interface.name) == 0) {
     uint32_t v = ver >= 4 ? 4 : ver;
+    M.linux_dmabuf_ver = v;
     M.linux_dmabuf = (zwp_linux_dmabuf_v1*)
       wl_registry_bind(reg, name, &zwp_linux_dmabuf_v1_interface, v);
+  } else if (strcmp(iface, wl_shm_interface.name) == 0) {
+    M.shm = (wl_shm*)wl_registry_bind(reg, name, &wl_shm_interface, 1);
+  }
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  else if (strcmp(iface, ext_foreign_toplevel_list_v1_interface.name) == 0) {
+    M.toplevel_list = (ext_foreign_toplevel_list_v1*)
+      wl_registry_bind(reg, name, &ext_foreign_toplevel_list_v1_interface, 1);
+    ext_foreign_toplevel_list_v1_add_listener(M.toplevel_list, &TOPLEVEL_LIST_LST, nullptr);
+  } else if (strcmp(iface, ext_foreign_toplevel_image_capture_source_manager_v1_interface.name) == 0) {
+    M.toplevel_sources = (ext_foreign_toplevel_image_capture_source_manager_v1*)
+      wl_registry_bind(reg, name, &ext_foreign_toplevel_image_capture_source_manager_v1_interface, 1);
+  } else if (strcmp(iface, ext_image_copy_capture_manager_v1_interface.name) == 0) {
+    M.copy_capture = (ext_image_copy_capture_manager_v1*)
+      wl_registry_bind(reg, name, &ext_image_copy_capture_manager_v1_interface, 1);
+  } else if (strcmp(iface, ext_output_image_capture_source_manager_v1_interface.name) == 0) {
+    M.output_sources = (ext_output_image_capture_source_manager_v1*)
+      wl_registry_bind(reg, name, &ext_output_image_capture_source_manager_v1_interface, 1);
+  } else if (strcmp(iface, wl_seat_interface.name) == 0 && !M.seat) {
+    uint32_t v = ver >= 5 ? 5 : ver;
+    M.seat = (wl_seat*)wl_registry_bind(reg, name, &wl_seat_interface, v);
+    wl_seat_add_listener(M.seat, &SEAT_LST, nullptr);
   }
+#endif
+}
+static void reg_remove(void*, wl_registry*, uint32_t name) {
+  for (auto* C : M.outs)  if (C->global == name) C->removed = true;
+  for (auto* C : M.added) if (C->global == name) C->removed = true;
 }
-static void reg_remove(void*, wl_registry*, uint32_t) {}
 static const wl_registry_listener REG_LST = { reg_global, reg_remove };
 
+// --------- Format negotiation ----------
+struct FormatInfo {
+  uint32_t    fourcc;
+  int         bytes;      // per pixel
+  int         precision;  // bits per color channel, 16 = half float
+  bool        is_float;
+  const char* name;
+};
+// Opaque variants first: same cost as the alpha ones and nothing to blend
+static const FormatInfo FORMATS[] = {
+  { DRM_FORMAT_XRGB8888,      4,  8, false, "XRGB8888" },
+  { DRM_FORMAT_XBGR8888,      4,  8, false, "XBGR8888" },
+  { DRM_FORMAT_ARGB8888,      4,  8, false, "ARGB8888" },
+  { DRM_FORMAT_ABGR8888,      4,  8, false, "ABGR8888" },
+  { DRM_FORMAT_XRGB2101010,   4, 10, false, "XRGB2101010" },
+  { DRM_FORMAT_XBGR2101010,   4, 10, false, "XBGR2101010" },
+  { DRM_FORMAT_ARGB2101010,   4, 10, false, "ARGB2101010" },
+  { DRM_FORMAT_ABGR2101010,   4, 10, false, "ABGR2101010" },
+  { DRM_FORMAT_XBGR16161616F, 8, 16, true,  "XBGR16161616F" },
+  { DRM_FORMAT_XRGB16161616F, 8, 16, true,  "XRGB16161616F" },
+  { DRM_FORMAT_ABGR16161616F, 8, 16, true,  "ABGR16161616F" },
+  { DRM_FORMAT_ARGB16161616F, 8, 16, true,  "ARGB16161616F" },
+};
+
+static const FormatInfo* format_info(uint32_t fourcc) {
+  for (const auto& f : FORMATS)
+    if (f.fourcc == fourcc) return &f;
+  return nullptr;
+}
+
+const char* capture_format_name(uint32_t fourcc) {
+  const FormatInfo* f = format_info(fourcc);
+  return f ? f->name : "unknown";
+}
+
+bool capture_format_is_float(uint32_t fourcc) {
+  const FormatInfo* f = format_info(fourcc);
+  return f && f->is_float;
+}
+
+int capture_format_precision(uint32_t fourcc) {
+  const FormatInfo* f = format_info(fourcc);
+  return f ? f->precision : 8;
+}
+
+// dma-buf formats the render EGL display can import (queried once)
+static void load_egl_formats() {
+  if (M.egl_formats_loaded) return;
+  M.egl_formats_loaded = true;
+  EGLDisplay dpy = platform_egl_display();
+  auto query = (PFNEGLQUERYDMABUFFORMATSEXTPROC)eglGetProcAddress("eglQueryDmaBufFormatsEXT");
+  if (dpy == EGL_NO_DISPLAY || !query) return;
+  EGLint n = 0;
+  if (!query(dpy, 0, nullptr, &n) || n <= 0) return;
+  std::vector<EGLint> fmts(n);
+  if (!query(dpy, n, fmts.data(), &n)) return;
+  for (EGLint i = 0; i < n; ++i) M.egl_formats.push_back((uint32_t)fmts[i]);
+}
+
+static bool format_usable(uint32_t fourcc) {
+  load_egl_formats();
+  if (!M.egl_formats.empty()) {
+    bool found = false;
+    for (uint32_t f : M.egl_formats) found |= f == fourcc;
+    if (!found) return false;
+  }
+  return !M.gbm || gbm_device_is_format_supported(M.gbm, fourcc, GBM_BO_USE_RENDERING);
+}
+
+// Pick the cheapest offered format that keeps the precision of the best
+// offer (the output's native depth) and that GBM + EGL can handle, so the
+// import stays zero-copy. Falls back to the compositor's first offer.
+static uint32_t negotiate_format(const std::vector<uint32_t>& offers) {
+  int need = 0;
+  for (uint32_t o : offers) {
+    const FormatInfo* f = format_info(o);
+    if (f && f->precision > need) need = f->precision;
+  }
+  const FormatInfo* best = nullptr;
+  for (const auto& f : FORMATS) {   // table order breaks ties
+    bool offered = false;
+    for (uint32_t o : offers) offered |= o == f.fourcc;
+    if (!offered || f.precision < need || !format_usable(f.fourcc)) continue;
+    if (!best || f.bytes < best->bytes) best = &f;
+  }
+  return best ? best->fourcc : offers.front();
+}
+
 // --------- Screencopy v3 listener (correct signatures) ----------
 static void sc_buffer(void* data,
                       zwlr_screencopy_frame_v1*,
-                      uint32_t fmt, uint32_t w, uint32_t h, uint32_t /*stride*/) {
+                      uint32_t fmt, uint32_t w, uint32_t h, uint32_t stride) {
+  // wl_shm offer: fmt is a wl_shm format, not a DRM fourcc
   auto* C = static_cast<OutputCtx*>(data);
-  C->fourcc = fmt;
+  C->shm_format = fmt;
+  C->shm_stride = stride;
   C->width  = (int)w;
   C->height = (int)h;
 }
@@ -145,21 +543,40 @@ static void sc_ready(void* data,
 }
 static void sc_failed(void* data, zwlr_screencopy_frame_v1*) {
   auto* C = static_cast<OutputCtx*>(data);
-  (void)C;
-  // We treat as non-fatal for one output; you can throw if you prefer
+  C->frame_failed = true;
+  // We treat as non-fatal for one output; the texture keeps its last contents
   fprintf(stderr, "screencopy frame_failed on one output\n");
 }
-static void sc_damage(void*, zwlr_screencopy_frame_v1*, uint32_t, uint32_t, uint32_t, uint32_t) {}
+// Only rows matter: the shm upload converts whole damaged rows
+static void add_damage_rows(OutputCtx* C, int y0, int y1) {
+  if (C->dmg_y1 <= C->dmg_y0) { C->dmg_y0 = y0; C->dmg_y1 = y1; return; }
+  if (y0 < C->dmg_y0) C->dmg_y0 = y0;
+  if (y1 > C->dmg_y1) C->dmg_y1 = y1;
+}
+static void sc_damage(void* data, zwlr_screencopy_frame_v1*,
+                      uint32_t /*x*/, uint32_t y, uint32_t /*w*/, uint32_t h) {
+  add_damage_rows(static_cast<OutputCtx*>(data), (int)y, (int)(y + h));
+}
 static void sc_linux_dmabuf(void* data,
                             zwlr_screencopy_frame_v1*,
                             uint32_t fmt, uint32_t w, uint32_t h) {
   auto* C = static_cast<OutputCtx*>(data);
-  C->fourcc = fmt;
+  C->dmabuf_offers.push_back(fmt);
   C->width  = (int)w;
   C->height = (int)h;
   C->got_dmabuf_announce = true;
 }
-static void sc_buffer_done(void*, zwlr_screencopy_frame_v1*) {}
+static void sc_buffer_done(void* data, zwlr_screencopy_frame_v1*) {
+  auto* C = static_cast<OutputCtx*>(data);
+  C->buffer_done = true;
+  if (!C->dmabuf_offers.empty()) {
+    uint32_t f = negotiate_format(C->dmabuf_offers);
+    if (f != C->fourcc)
+      fprintf(stdout, "[capture] %s: dma-buf format %s\n", C->name.c_str(), capture_format_name(f));
+    C->fourcc = f;
+    C->dmabuf_offers.clear();
+  }
+}
 
 static const zwlr_screencopy_frame_v1_listener FRAME_LST = {
   /* .buffer       = */ sc_buffer,
@@ -173,23 +590,16 @@ static const zwlr_screencopy_frame_v1_listener FRAME_LST = {
 
 // --------- Allocate per-output GBM + wl_buffer ----------
 static void alloc_dmabuf_and_wlbuf(OutputCtx* C) {
-  if (M.drm_fd < 0) M.drm_fd = open_render_node();
-  if (!M.gbm) {
-    M.gbm = gbm_create_device(M.drm_fd);
-    if (!M.gbm) throw std::runtime_error("gbm_create_device failed");
-  }
+  if (!init_gbm()) throw std::runtime_error("no usable GBM device");
 
   const uint32_t fmt = C->fourcc ? C->fourcc : DRM_FORMAT_XRGB8888;
-  gbm_bo* bo = gbm_bo_create(M.gbm, C->width, C->height, fmt,
-                             GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
-  if (!bo) throw std::runtime_error("gbm_bo_create failed");
-
-  C->dmabuf_fd = gbm_bo_get_fd(bo);
-  C->stride    = gbm_bo_get_stride(bo);
+  C->buf_fourcc = fmt;
+  C->buf_w = C->width;
+  C->buf_h = C->height;
+  // From the pool: possibly larger than width x height, wrapped at its stride
+  C->dmabuf_fd = pool_acquire(M.gbm, C->width, C->height, fmt, C->name, C->stride);
   C->offset    = 0;
-  gbm_bo_destroy(bo); // fd/stride are duplicated out; we don't keep the bo.
-
-  if (C->dmabuf_fd < 0) throw std::runtime_error("gbm_bo_get_fd failed");
+  if (C->dmabuf_fd < 0) throw std::runtime_error("gbm_bo_create failed");
   if (!M.linux_dmabuf)  throw std::runtime_error("zwp_linux_dmabuf_v1 not bound");
 
   zwp_linux_buffer_params_v1* params = zwp_linux_dmabuf_v1_create_params(M.linux_dmabuf);
@@ -204,13 +614,117 @@ static void alloc_dmabuf_and_wlbuf(OutputCtx* C) {
   if (!C->wlbuf) throw std::runtime_error("zwp_linux_buffer_params_v1_create_immed returned null wl_buffer");
 }
 
+// Drop the dma-buf, wl_buffer and EGLImage (keeps the GL texture name)
+static void free_dmabuf_and_wlbuf(OutputCtx* C) {
+  if (C->egl_img != EGL_NO_IMAGE_KHR) {
+    if (p_eglDestroyImage)     p_eglDestroyImage(M.egl_dpy, C->egl_img);
+    else if (p_eglDestroyImageKHR) p_eglDestroyImageKHR(M.egl_dpy, C->egl_img);
+    C->egl_img = EGL_NO_IMAGE_KHR;
+  }
+  if (C->wlbuf)   { wl_buffer_destroy(C->wlbuf); C->wlbuf = nullptr; }
+  if (C->dmabuf_fd >= 0) { pool_release(C->dmabuf_fd); C->dmabuf_fd = -1; }
+}
+
+// The compositor writes the spare dma-buf; swapping makes it the shown one.
+static void swap_dma_slot(OutputCtx* C) {
+  std::swap(C->dmabuf_fd,   C->spare.fd);
+  std::swap(C->stride,      C->spare.stride);
+  std::swap(C->wlbuf,       C->spare.buf);
+  std::swap(C->egl_img,     C->spare.img);
+  std::swap(C->buf_fourcc,  C->spare.fourcc);
+  std::swap(C->buf_w,       C->spare.w);
+  std::swap(C->buf_h,       C->spare.h);
+  std::swap(C->alloc_req_w, C->spare.req_w);
+  std::swap(C->alloc_req_h, C->spare.req_h);
+}
+
+// --------- wl_shm fallback: memfd pool ring + PBO upload ----------
+static void alloc_shm_ring(OutputCtx* C) {
+  if (!M.shm) throw std::runtime_error("wl_shm not bound");
+  if (!pixel_layout_from_shm(C->shm_format, C->shm_layout))
+    throw std::runtime_error("unsupported wl_shm format from screencopy");
+  if (C->shm_stride < (uint32_t)C->width * 4)
+    throw std::runtime_error("invalid wl_shm stride from screencopy");
+
+  const size_t slot = (size_t)C->shm_stride * C->height;
+  C->shm_size = slot * SHM_RING;
+  C->shm_fd = memfd_create("viture-shm", MFD_CLOEXEC);
+  if (C->shm_fd < 0 || ftruncate(C->shm_fd, (off_t)C->shm_size) < 0)
+    throw std::runtime_error("memfd for wl_shm pool failed");
+  void* map = mmap(nullptr, C->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, C->shm_fd, 0);
+  if (map == MAP_FAILED) throw std::runtime_error("mmap of wl_shm pool failed");
+  C->shm_map = (uint8_t*)map;
+
+  C->shm_pool = wl_shm_create_pool(M.shm, C->shm_fd, (int32_t)C->shm_size);
+  for (int i = 0; i < SHM_RING; ++i)
+    C->shm_bufs[i] = wl_shm_pool_create_buffer(C->shm_pool, (int32_t)(slot * i), C->width,
+                                               C->height, (int32_t)C->shm_stride, C->shm_format);
+  C->shm_w = C->width;
+  C->shm_h = C->height;
+  C->shm_ring_format = C->shm_format;
+  C->shm_ring_stride = C->shm_stride;
+  C->shm_cur = 0;
+  C->wlbuf = C->shm_bufs[0];
+  C->tex_alloc = false;
+}
+
+static void free_shm_ring(OutputCtx* C) {
+  for (auto& b : C->shm_bufs)
+    if (b) { wl_buffer_destroy(b); b = nullptr; }
+  if (C->shm_pool) { wl_shm_pool_destroy(C->shm_pool); C->shm_pool = nullptr; }
+  if (C->shm_map)  { munmap(C->shm_map, C->shm_size); C->shm_map = nullptr; }
+  if (C->shm_fd >= 0) { close(C->shm_fd); C->shm_fd = -1; }
+  C->wlbuf = nullptr;
+}
+
+// Convert rows [y0, y1) of ring `slot` into a PBO and upload them. The PBO is
+// orphaned and the ring rotated so the driver never stalls on a previous upload.
+static void upload_shm(OutputCtx* C, int slot, int y0, int y1) {
+  const int w = C->shm_w, h = C->shm_h;
+  if (y0 < 0) y0 = 0;
+  if (y1 > h) y1 = h;
+  if (y1 <= y0) return;
+
+  if (!C->texture) glGenTextures(1, &C->texture);
+  glBindTexture(GL_TEXTURE_2D, C->texture);
+  if (!C->tex_alloc) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    C->tex_alloc = true;
+    y0 = 0; y1 = h;  // fresh storage: everything is "damaged"
+  }
+  if (!C->pbo[0]) glGenBuffers(SHM_RING, C->pbo);
+
+  const size_t pitch = (size_t)w * 4;
+  const size_t bytes = pitch * (size_t)(y1 - y0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, C->pbo[C->pbo_cur]);
+  C->pbo_cur = (C->pbo_cur + 1) % SHM_RING;
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_DRAW);
+  auto* dst = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (dst) {
+    const uint8_t* src = C->shm_map + (size_t)slot * C->shm_stride * h;
+    for (int y = y0; y < y1; ++y)
+      pixel_convert_row(C->shm_layout, (const uint32_t*)(src + (size_t)y * C->shm_stride),
+                        (uint32_t*)(dst + pitch * (size_t)(y - y0)), w);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, y1 - y0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    C->upd_y0 = y0;
+    C->upd_y1 = y1;
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 // --------- Create EGLImage+GL texture from dma-buf for an output ----------
 static void ensure_tex(OutputCtx* C) {
   if (!C->texture) glGenTextures(1, &C->texture);
   if (C->egl_img == EGL_NO_IMAGE_KHR) {
     if (M.egl_dpy == EGL_NO_DISPLAY) {
-      M.egl_dpy = eglGetCurrentDisplay();
-      if (M.egl_dpy == EGL_NO_DISPLAY) throw std::runtime_error("No current EGLDisplay");
+      M.egl_dpy = platform_egl_display();
+      if (M.egl_dpy == EGL_NO_DISPLAY) throw std::runtime_error("No platform EGLDisplay");
     }
     ensure_gl_egl_image_fn();
     ensure_egl_image_fns();
@@ -219,12 +733,12 @@ static void ensure_tex(OutputCtx* C) {
 
     if (!img && p_eglCreateImageKHR) {
       const EGLint attrsKHR[] = {
-        EGL_LINUX_DRM_FOURCC_EXT,      (EGLint)C->fourcc,
+        EGL_LINUX_DRM_FOURCC_EXT,      (EGLint)C->buf_fourcc,
         EGL_DMA_BUF_PLANE0_FD_EXT,     (EGLint)C->dmabuf_fd,
         EGL_DMA_BUF_PLANE0_OFFSET_EXT, (EGLint)C->offset,
         EGL_DMA_BUF_PLANE0_PITCH_EXT,  (EGLint)C->stride,
-        EGL_WIDTH,                     (EGLint)C->width,
-        EGL_HEIGHT,                    (EGLint)C->height,
+        EGL_WIDTH,                     (EGLint)C->buf_w,
+        EGL_HEIGHT,                    (EGLint)C->buf_h,
         EGL_NONE
       };
       img = p_eglCreateImageKHR(M.egl_dpy, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT,
@@ -233,12 +747,12 @@ static void ensure_tex(OutputCtx* C) {
 #if defined(EGL_VERSION_1_5)
     if (!img && p_eglCreateImage) {
       const EGLAttrib attrsCore[] = {
-        EGL_LINUX_DRM_FOURCC_EXT,      (EGLAttrib)C->fourcc,
+        EGL_LINUX_DRM_FOURCC_EXT,      (EGLAttrib)C->buf_fourcc,
         EGL_DMA_BUF_PLANE0_FD_EXT,     (EGLAttrib)C->dmabuf_fd,
         EGL_DMA_BUF_PLANE0_OFFSET_EXT, (EGLAttrib)C->offset,
         EGL_DMA_BUF_PLANE0_PITCH_EXT,  (EGLAttrib)C->stride,
-        EGL_WIDTH,                     (EGLAttrib)C->width,
-        EGL_HEIGHT,                    (EGLAttrib)C->height,
+        EGL_WIDTH,                     (EGLAttrib)C->buf_w,
+        EGL_HEIGHT,                    (EGLAttrib)C->buf_h,
         EGL_NONE
       };
       img = p_eglCreateImage(M.egl_dpy, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT,
@@ -255,6 +769,512 @@ static void ensure_tex(OutputCtx* C) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glEGLImageTargetTexture2DOES_(GL_TEXTURE_2D, C->egl_img);
+  C->upd_y0 = 0;    // screencopy copy() has no damage: the whole buffer is new
+  C->upd_y1 = C->buf_h;
+}
+
+// --------- Mode-independent buffer handling ----------
+static void alloc_capture_buffer(OutputCtx* C) {
+  if (M.use_shm) alloc_shm_ring(C);
+  else           alloc_dmabuf_and_wlbuf(C);
+}
+// Both dma-buf slots, or the shm ring
+static void free_capture_buffer(OutputCtx* C) {
+  if (M.use_shm) { free_shm_ring(C); return; }
+  free_dmabuf_and_wlbuf(C);
+  swap_dma_slot(C);
+  free_dmabuf_and_wlbuf(C);
+}
+// Make a completed full copy visible in C->texture
+static void present_full_frame(OutputCtx* C) {
+  if (!M.use_shm) { ensure_tex(C); return; }
+  upload_shm(C, C->shm_cur, 0, C->shm_h);
+  C->shm_cur = (C->shm_cur + 1) % SHM_RING;
+  C->wlbuf = C->shm_bufs[C->shm_cur];
+}
+
+static const CaptureHint* find_hint(const OutputCtx* C) {
+  for (const auto& h : M.hints)
+    if (!C->name.empty() && h.name == C->name && h.width > 0 && h.height > 0 && h.fourcc)
+      return &h;
+  return nullptr;
+}
+
+// Probe a set of outputs concurrently. All captures are issued up front and
+// each output gets its buffer and copy as soon as its size arrives, so startup
+// costs about one compositor round trip whatever the output count. With
+// use_hints, outputs with a cached size/format copy immediately without waiting
+// for the offer. Returns the outputs whose copy failed (buffers released).
+static std::vector<OutputCtx*> probe_outputs(const std::vector<OutputCtx*>& list, bool use_hints) {
+  struct Probe {
+    OutputCtx*                C = nullptr;
+    zwlr_screencopy_frame_v1* f = nullptr;
+    bool                      copying = false;
+  };
+  std::vector<Probe> ps;
+  ps.reserve(list.size());
+
+  for (auto* C : list) {
+    C->frame_ready = C->frame_failed = C->buffer_done = false;
+    C->got_dmabuf_announce = false;
+    C->width = C->height = 0;
+
+    Probe p;
+    p.C = C;
+    p.f = zwlr_screencopy_manager_v1_capture_output(M.screencopy, 0, C->wlo);
+    if (!p.f) throw std::runtime_error("capture_output returned null on probe");
+    zwlr_screencopy_frame_v1_add_listener(p.f, &FRAME_LST, C);
+
+    const CaptureHint* h = use_hints ? find_hint(C) : nullptr;
+    if (h) {
+      C->width  = h->width;
+      C->height = h->height;
+      C->fourcc = h->fourcc;
+      alloc_capture_buffer(C);
+      zwlr_screencopy_frame_v1_copy(p.f, C->wlbuf);
+      p.copying = true;
+    }
+    ps.push_back(p);
+  }
+
+  for (;;) {
+    bool pending = false;
+    for (auto& p : ps) {
+      OutputCtx* C = p.C;
+      if (C->frame_ready || C->frame_failed) continue;
+      if (!p.copying) {
+        if (!C->buffer_done) { pending = true; continue; }
+        if (C->width <= 0 || C->height <= 0)
+          throw std::runtime_error("invalid w/h from screencopy probe");
+        alloc_capture_buffer(C);
+        zwlr_screencopy_frame_v1_copy(p.f, C->wlbuf);
+        p.copying = true;
+      }
+      pending = true;
+    }
+    if (!pending) break;
+    if (wl_display_dispatch(M.display) < 0)
+      throw std::runtime_error("dispatch failed during probe");
+  }
+
+  std::vector<OutputCtx*> failed;
+  for (auto& p : ps) {
+    OutputCtx* C = p.C;
+    zwlr_screencopy_frame_v1_destroy(p.f);
+    if (!C->frame_ready) {
+      free_capture_buffer(C);
+      failed.push_back(C);
+      continue;
+    }
+    C->frame_ready = false;
+    C->out_w = C->alloc_req_w = C->src_w = C->width;
+    C->out_h = C->alloc_req_h = C->src_h = C->height;
+    present_full_frame(C);
+  }
+  return failed;
+}
+
+// --------- Region of interest ----------
+// Region sizes are rounded up to this many pixels so head motion only moves the
+// origin of the copy; the buffer is reallocated only when the zoom changes enough.
+static const int ROI_ALIGN = 64;
+
+// Turn the requested ROI into the rect we actually copy (output pixels).
+// Returns false if that ends up covering the whole output.
+static bool fit_region(const OutputCtx* C, int& x, int& y, int& w, int& h) {
+  if (C->roi_w <= 0 || C->roi_h <= 0 || C->out_w <= 0 || C->out_h <= 0) return false;
+
+  const int s = C->scale;
+  w = ((C->roi_w + ROI_ALIGN - 1) / ROI_ALIGN) * ROI_ALIGN;
+  h = ((C->roi_h + ROI_ALIGN - 1) / ROI_ALIGN) * ROI_ALIGN;
+  if (w >= C->out_w && h >= C->out_h) return false;
+  if (w > C->out_w) w = C->out_w;
+  if (h > C->out_h) h = C->out_h;
+
+  // Keep the quantized rect centered on the request, then clamp into the output
+  x = C->roi_x - (w - C->roi_w) / 2;
+  y = C->roi_y - (h - C->roi_h) / 2;
+  if (x + w > C->out_w) x = C->out_w - w;
+  if (y + h > C->out_h) y = C->out_h - h;
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+
+  // Region is requested in logical coordinates; stay on whole logical pixels
+  x -= x % s; y -= y % s; w -= w % s; h -= h % s;
+  return w > 0 && h > 0;
+}
+
+static void export_cursor(const OutputCtx* C, CapturedOutput& co);
+static void export_output(const OutputCtx* C, CapturedOutput& co) {
+  co.wl_output = C->wlo;
+  co.width   = C->out_w;
+  co.height  = C->out_h;
+  co.src_x   = C->src_x;
+  co.src_y   = C->src_y;
+  co.src_w   = C->src_w;
+  co.src_h   = C->src_h;
+  co.texture = C->texture;
+  co.tex_w   = M.use_shm ? C->shm_w : C->buf_w;
+  co.tex_h   = M.use_shm ? C->shm_h : C->buf_h;
+  co.dirty_y0 = C->upd_y0;
+  co.dirty_y1 = C->upd_y1;
+  co.fourcc  = C->buf_fourcc;
+  co.name    = C->name;
+  export_cursor(C, co);
+}
+
+static void export_cursor(const OutputCtx* C, CapturedOutput& co) {
+  const CursorCtx* K = C->cursor;
+  co.cursor_visible = K && K->inside && K->tex && !K->stopped;
+  if (co.cursor_visible) {
+    co.cursor_x   = K->x - K->hot_x;
+    co.cursor_y   = K->y - K->hot_y;
+    co.cursor_tex = K->tex;
+    co.cursor_w   = K->tex_w;
+    co.cursor_h   = K->tex_h;
+  }
+}
+
+// --------- Window sources (ext-image-copy-capture) ----------
+static void alloc_window_buffers(OutputCtx* C) {
+  C->width  = C->sess_w;
+  C->height = C->sess_h;
+  if (M.use_shm) {
+    C->shm_stride = (uint32_t)C->width * 4;
+    alloc_shm_ring(C);
+  } else {
+    alloc_dmabuf_and_wlbuf(C);
+    swap_dma_slot(C);
+    alloc_dmabuf_and_wlbuf(C);
+  }
+  C->alloc_req_w = C->spare.req_w = C->out_w = C->src_w = C->width;
+  C->alloc_req_h = C->spare.req_h = C->out_h = C->src_h = C->height;
+  C->fresh_slots = SHM_RING;
+  C->tex_alloc = false;
+}
+
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+// Session: buffer constraints, resent as a whole whenever they change
+static void ws_buffer_size(void* data, ext_image_copy_capture_session_v1*, uint32_t w, uint32_t h) {
+  auto* C = static_cast<OutputCtx*>(data);
+  C->sess_w = (int)w;
+  C->sess_h = (int)h;
+}
+static void ws_shm_format(void* data, ext_image_copy_capture_session_v1*, uint32_t fmt) {
+  auto* C = static_cast<OutputCtx*>(data);
+  PixelLayout l;
+  if (!C->shm_format_set && pixel_layout_from_shm(fmt, l)) {
+    C->shm_format = fmt;
+    C->shm_format_set = true;
+  }
+}
+static void ws_dmabuf_device(void*, ext_image_copy_capture_session_v1*, wl_array*) {}
+static void ws_dmabuf_format(void* data, ext_image_copy_capture_session_v1*, uint32_t fmt,
+                             wl_array* modifiers) {
+  // Our buffers are linear
+  auto* C = static_cast<OutputCtx*>(data);
+  const uint64_t* mod;
+  wl_array_for_each(mod, modifiers) {
+    if (*mod == DRM_FORMAT_MOD_LINEAR) { C->dmabuf_offers.push_back(fmt); break; }
+  }
+}
+static void ws_done(void* data, ext_image_copy_capture_session_v1*) {
+  auto* C = static_cast<OutputCtx*>(data);
+  if (!M.use_shm && C->dmabuf_offers.empty()) {
+    fprintf(stderr, "[capture] %s: no linear dma-buf format offered\n", C->name.c_str());
+    C->removed = true;
+  } else if (M.use_shm && !C->shm_format_set) {
+    fprintf(stderr, "[capture] %s: no supported wl_shm format offered\n", C->name.c_str());
+    C->removed = true;
+  }
+  if (!C->dmabuf_offers.empty()) C->fourcc = negotiate_format(C->dmabuf_offers);
+  C->dmabuf_offers.clear();
+  C->shm_format_set = false;
+  C->buffer_done = true;
+}
+static void ws_stopped(void* data, ext_image_copy_capture_session_v1*) {
+  auto* C = static_cast<OutputCtx*>(data);
+  C->removed = true;   // window closed or capture revoked
+}
+static const ext_image_copy_capture_session_v1_listener WIN_SESSION_LST = {
+  ws_buffer_size, ws_shm_format, ws_dmabuf_device, ws_dmabuf_format, ws_done, ws_stopped
+};
+
+static void wf_transform(void*, ext_image_copy_capture_frame_v1*, uint32_t) {}
+static void wf_damage(void* data, ext_image_copy_capture_frame_v1*,
+                      int32_t /*x*/, int32_t y, int32_t /*w*/, int32_t h) {
+  add_damage_rows(static_cast<OutputCtx*>(data), y, y + h);
+}
+static void wf_presentation_time(void*, ext_image_copy_capture_frame_v1*,
+                                 uint32_t, uint32_t, uint32_t) {}
+static void wf_ready(void* data, ext_image_copy_capture_frame_v1*) {
+  static_cast<OutputCtx*>(data)->frame_ready = true;
+}
+static void wf_failed(void* data, ext_image_copy_capture_frame_v1*, uint32_t reason) {
+  auto* C = static_cast<OutputCtx*>(data);
+  C->frame_failed = true;
+  if (reason == EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED) C->removed = true;
+}
+static const ext_image_copy_capture_frame_v1_listener WIN_FRAME_LST = {
+  wf_transform, wf_damage, wf_presentation_time, wf_ready, wf_failed
+};
+
+// Show a finished capture, then start the next one. Only damaged rows are
+// uploaded (shm) or marked dirty (dma-buf), and the buffer about to be reused
+// is told what it missed, so capture cost follows what actually changed.
+static void window_next_frame(OutputCtx* C) {
+  if (C->removed) return;
+
+  if (C->win_frame) {
+    if (!C->frame_ready && !C->frame_failed) return;
+    ext_image_copy_capture_frame_v1_destroy(C->win_frame);
+    C->win_frame = nullptr;
+
+    if (C->frame_ready) {
+      const int y0 = C->dmg_y0, y1 = C->dmg_y1;
+      if (M.use_shm) {
+        upload_shm(C, C->shm_cur, y0, y1);
+        C->shm_cur = (C->shm_cur + 1) % SHM_RING;
+      } else {
+        swap_dma_slot(C);
+        ensure_tex(C);
+        if (C->tex_alloc) { C->upd_y0 = y0; C->upd_y1 = y1; }
+        C->tex_alloc = true;
+      }
+      C->prev_dmg_y0 = y0;
+      C->prev_dmg_y1 = y1;
+    } else {
+      C->fresh_slots = SHM_RING;   // contents of the failed slot are unknown
+    }
+  }
+
+  if (!C->buffer_done || C->removed) return;
+  if (C->sess_w <= 0 || C->sess_h <= 0) return;
+  if (C->sess_w != C->alloc_req_w || C->sess_h != C->alloc_req_h ||
+      (!M.use_shm && C->fourcc != C->buf_fourcc)) {
+    if (C->alloc_req_w) {
+      fprintf(stderr, "[capture] %s: resized to %dx%d\n", C->name.c_str(), C->sess_w, C->sess_h);
+      C->resized = true;
+    }
+    free_capture_buffer(C);
+    alloc_window_buffers(C);
+  }
+
+  C->frame_ready = C->frame_failed = false;
+  C->dmg_y0 = C->dmg_y1 = 0;
+  C->win_frame = ext_image_copy_capture_session_v1_create_frame(C->win_session);
+  ext_image_copy_capture_frame_v1_add_listener(C->win_frame, &WIN_FRAME_LST, C);
+  ext_image_copy_capture_frame_v1_attach_buffer(
+    C->win_frame, M.use_shm ? C->shm_bufs[C->shm_cur] : C->spare.buf);
+  if (C->fresh_slots > 0) {
+    --C->fresh_slots;
+    ext_image_copy_capture_frame_v1_damage_buffer(C->win_frame, 0, 0, C->width, C->height);
+  } else if (C->prev_dmg_y1 > C->prev_dmg_y0) {
+    ext_image_copy_capture_frame_v1_damage_buffer(C->win_frame, 0, C->prev_dmg_y0, C->width,
+                                                  C->prev_dmg_y1 - C->prev_dmg_y0);
+  }
+  ext_image_copy_capture_frame_v1_capture(C->win_frame);
+}
+
+// --------- Cursor overlay ----------
+static void cc_enter(void* data, ext_image_copy_capture_cursor_session_v1*) {
+  static_cast<CursorCtx*>(data)->inside = true;
+}
+static void cc_leave(void* data, ext_image_copy_capture_cursor_session_v1*) {
+  static_cast<CursorCtx*>(data)->inside = false;
+}
+static void cc_position(void* data, ext_image_copy_capture_cursor_session_v1*, int32_t x, int32_t y) {
+  auto* K = static_cast<CursorCtx*>(data);
+  K->x = x;
+  K->y = y;
+}
+static void cc_hotspot(void* data, ext_image_copy_capture_cursor_session_v1*, int32_t x, int32_t y) {
+  auto* K = static_cast<CursorCtx*>(data);
+  K->hot_x = x;
+  K->hot_y = y;
+}
+static const ext_image_copy_capture_cursor_session_v1_listener CURSOR_LST = {
+  cc_enter, cc_leave, cc_position, cc_hotspot
+};
+
+// Image session: only 32-bit shm with alpha, uploaded as-is (BGRA in memory)
+static void ci_buffer_size(void* data, ext_image_copy_capture_session_v1*, uint32_t w, uint32_t h) {
+  auto* K = static_cast<CursorCtx*>(data);
+  K->sess_w = (int)w;
+  K->sess_h = (int)h;
+}
+static void ci_shm_format(void* data, ext_image_copy_capture_session_v1*, uint32_t fmt) {
+  auto* K = static_cast<CursorCtx*>(data);
+  if (!K->format_set && fmt == WL_SHM_FORMAT_ARGB8888) {
+    K->shm_format = fmt;
+    K->format_set = true;
+  }
+}
+static void ci_dmabuf_device(void*, ext_image_copy_capture_session_v1*, wl_array*) {}
+static void ci_dmabuf_format(void*, ext_image_copy_capture_session_v1*, uint32_t, wl_array*) {}
+static void ci_done(void* data, ext_image_copy_capture_session_v1*) {
+  auto* K = static_cast<CursorCtx*>(data);
+  if (!K->format_set) {
+    fprintf(stderr, "[capture] cursor: no ARGB8888 shm format offered\n");
+    K->stopped = true;
+  }
+  K->format_set = false;
+  K->constraints = true;
+}
+static void ci_stopped(void* data, ext_image_copy_capture_session_v1*) {
+  static_cast<CursorCtx*>(data)->stopped = true;
+}
+static const ext_image_copy_capture_session_v1_listener CURSOR_IMAGE_LST = {
+  ci_buffer_size, ci_shm_format, ci_dmabuf_device, ci_dmabuf_format, ci_done, ci_stopped
+};
+
+static void cf_transform(void*, ext_image_copy_capture_frame_v1*, uint32_t) {}
+static void cf_damage(void*, ext_image_copy_capture_frame_v1*, int32_t, int32_t, int32_t, int32_t) {}
+static void cf_presentation_time(void*, ext_image_copy_capture_frame_v1*, uint32_t, uint32_t, uint32_t) {}
+static void cf_ready(void* data, ext_image_copy_capture_frame_v1*) {
+  static_cast<CursorCtx*>(data)->ready = true;
+}
+static void cf_failed(void* data, ext_image_copy_capture_frame_v1*, uint32_t reason) {
+  auto* K = static_cast<CursorCtx*>(data);
+  K->failed = true;
+  if (reason == EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED) K->stopped = true;
+}
+static const ext_image_copy_capture_frame_v1_listener CURSOR_FRAME_LST = {
+  cf_transform, cf_damage, cf_presentation_time, cf_ready, cf_failed
+};
+
+static void cursor_free_buffer(CursorCtx* K) {
+  if (K->buf)  { wl_buffer_destroy(K->buf); K->buf = nullptr; }
+  if (K->pool) { wl_shm_pool_destroy(K->pool); K->pool = nullptr; }
+  if (K->map)  { munmap(K->map, K->size); K->map = nullptr; }
+  if (K->fd >= 0) { close(K->fd); K->fd = -1; }
+  K->buf_w = K->buf_h = 0;
+}
+
+static bool cursor_alloc_buffer(CursorCtx* K) {
+  K->size = (size_t)K->sess_w * K->sess_h * 4;
+  K->fd = memfd_create("viture-cursor", MFD_CLOEXEC);
+  if (K->fd < 0 || ftruncate(K->fd, (off_t)K->size) < 0) return false;
+  void* map = mmap(nullptr, K->size, PROT_READ | PROT_WRITE, MAP_SHARED, K->fd, 0);
+  if (map == MAP_FAILED) return false;
+  K->map = (uint8_t*)map;
+  K->pool = wl_shm_create_pool(M.shm, K->fd, (int32_t)K->size);
+  K->buf = wl_shm_pool_create_buffer(K->pool, 0, K->sess_w, K->sess_h, K->sess_w * 4, K->shm_format);
+  K->buf_w = K->sess_w;
+  K->buf_h = K->sess_h;
+  return true;
+}
+
+static CursorCtx* cursor_create(OutputCtx* C) {
+  auto* K = new CursorCtx();
+  K->source  = ext_output_image_capture_source_manager_v1_create_source(M.output_sources, C->wlo);
+  K->session = ext_image_copy_capture_manager_v1_create_pointer_cursor_session(
+    M.copy_capture, K->source, M.pointer);
+  ext_image_copy_capture_cursor_session_v1_add_listener(K->session, &CURSOR_LST, K);
+  K->image = ext_image_copy_capture_cursor_session_v1_get_capture_session(K->session);
+  ext_image_copy_capture_session_v1_add_listener(K->image, &CURSOR_IMAGE_LST, K);
+  return K;
+}
+
+static void cursor_destroy(CursorCtx* K) {
+  if (K->frame)   ext_image_copy_capture_frame_v1_destroy(K->frame);
+  if (K->image)   ext_image_copy_capture_session_v1_destroy(K->image);
+  if (K->session) ext_image_copy_capture_cursor_session_v1_destroy(K->session);
+  if (K->source)  ext_image_capture_source_v1_destroy(K->source);
+  cursor_free_buffer(K);
+  if (K->tex) glDeleteTextures(1, &K->tex);
+  delete K;
+}
+
+// Upload a finished cursor image and keep the next capture pending; it
+// completes whenever the compositor changes the cursor.
+static void cursor_next_frame(CursorCtx* K) {
+  if (K->stopped) return;
+  if (K->frame) {
+    if (!K->ready && !K->failed) return;
+    ext_image_copy_capture_frame_v1_destroy(K->frame);
+    K->frame = nullptr;
+    if (K->ready) {
+      if (!K->tex) {
+        glGenTextures(1, &K->tex);
+        glBindTexture(GL_TEXTURE_2D, K->tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      }
+      glBindTexture(GL_TEXTURE_2D, K->tex);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, K->buf_w, K->buf_h, 0, GL_BGRA, GL_UNSIGNED_BYTE, K->map);
+      K->tex_w = K->buf_w;
+      K->tex_h = K->buf_h;
+    }
+  }
+
+  if (!K->constraints || K->stopped || K->sess_w <= 0 || K->sess_h <= 0) return;
+  if (K->sess_w != K->buf_w || K->sess_h != K->buf_h) {
+    cursor_free_buffer(K);
+    if (!cursor_alloc_buffer(K)) {
+      fprintf(stderr, "[capture] cursor: shm buffer allocation failed\n");
+      cursor_free_buffer(K);
+      K->stopped = true;
+      return;
+    }
+  }
+  K->ready = K->failed = false;
+  K->frame = ext_image_copy_capture_session_v1_create_frame(K->image);
+  ext_image_copy_capture_frame_v1_add_listener(K->frame, &CURSOR_FRAME_LST, K);
+  ext_image_copy_capture_frame_v1_attach_buffer(K->frame, K->buf);
+  ext_image_copy_capture_frame_v1_damage_buffer(K->frame, 0, 0, K->buf_w, K->buf_h);
+  ext_image_copy_capture_frame_v1_capture(K->frame);
+}
+
+// Start cursor sessions for outputs that lack one, then advance them
+static void update_cursors() {
+  const bool supported = M.copy_capture && M.output_sources && M.shm;
+  if (!supported || !M.pointer) {
+    if (!M.cursor_warned) {
+      fprintf(stderr, "[capture] no ext-image-copy-capture cursor sessions, pointer not shown\n");
+      M.cursor_warned = true;
+    }
+    return;
+  }
+  for (auto* C : M.outs) {
+    if (C->window || C->removed) continue;
+    if (!C->cursor) C->cursor = cursor_create(C);
+    cursor_next_frame(C->cursor);
+  }
+}
+#else
+static void window_next_frame(OutputCtx*) {}
+static void cursor_destroy(CursorCtx* K) { delete K; }
+static void update_cursors() {
+  if (!M.cursor_warned) {
+    fprintf(stderr, "[capture] built without ext-image-copy-capture, pointer not shown\n");
+    M.cursor_warned = true;
+  }
+}
+#endif
+
+static void release_output(OutputCtx* C) {
+  if (C->shm_inflight) { zwlr_screencopy_frame_v1_destroy(C->shm_inflight); C->shm_inflight = nullptr; }
+  if (C->dma_inflight) { zwlr_screencopy_frame_v1_destroy(C->dma_inflight); C->dma_inflight = nullptr; }
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  if (C->win_frame)   { ext_image_copy_capture_frame_v1_destroy(C->win_frame); C->win_frame = nullptr; }
+  if (C->win_session) { ext_image_copy_capture_session_v1_destroy(C->win_session); C->win_session = nullptr; }
+  if (C->win_source)  { ext_image_capture_source_v1_destroy(C->win_source); C->win_source = nullptr; }
+#endif
+  if (C->cursor) { cursor_destroy(C->cursor); C->cursor = nullptr; }
+  free_capture_buffer(C);
+  if (C->pbo[0])  { glDeleteBuffers(SHM_RING, C->pbo); C->pbo[0] = 0; }
+  if (C->texture) { glDeleteTextures(1, &C->texture); C->texture = 0; }
+  if (C->wlo) {
+    if (wl_output_get_version(C->wlo) >= WL_OUTPUT_RELEASE_SINCE_VERSION) wl_output_release(C->wlo);
+    else wl_output_destroy(C->wlo);
+    C->wlo = nullptr;
+  }
+  delete C;
 }
 
 // --------- Public API ----------
@@ -267,45 +1287,47 @@ void wlr_multi_capture_init(std::vector<CapturedOutput>& outs, int* totalW, int*
   M.registry = wl_display_get_registry(M.display);
   wl_registry_add_listener(M.registry, &REG_LST, nullptr);
   wl_display_roundtrip(M.display);
+  wl_display_roundtrip(M.display); // wl_output name/scale events
 
   if (!M.screencopy)   throw std::runtime_error("zwlr_screencopy_manager_v1 missing");
-  if (!M.linux_dmabuf) throw std::runtime_error("zwp_linux_dmabuf_v1 missing");
+  if (M.screencopy_ver < 3) throw std::runtime_error("zwlr_screencopy_manager_v1 v3 required");
   if (M.outs.empty())  throw std::runtime_error("no wl_output available");
 
-  // Probe each output -> learn w/h/fourcc via v3 buffer/linux_dmabuf events
-  for (auto* C : M.outs) {
-    C->frame_ready = false;
-    C->got_dmabuf_announce = false;
-    zwlr_screencopy_frame_v1* f =
-      zwlr_screencopy_manager_v1_capture_output(M.screencopy, 0, C->wlo);
-    if (!f) throw std::runtime_error("capture_output returned null on probe");
-    zwlr_screencopy_frame_v1_add_listener(f, &FRAME_LST, C);
-
-    // Wait for size info (linux_dmabuf or buffer event populates width/height)
-    while (!C->got_dmabuf_announce && C->width == 0 && C->height == 0) {
-      if (wl_display_dispatch(M.display) < 0)
-        throw std::runtime_error("dispatch failed during probe");
-    }
-    if (C->width <= 0 || C->height <= 0)
-      throw std::runtime_error("invalid w/h from screencopy probe");
-
-    // Prepare our dma-buf + wl_buffer
-    alloc_dmabuf_and_wlbuf(C);
+  // Zero-copy dma-buf when we can; wl_shm + CPU upload on software/VM setups.
+  // VITURE_CAPTURE=shm forces the fallback.
+  const char* mode = getenv("VITURE_CAPTURE");
+  if (mode && strcmp(mode, "shm") == 0) {
+    M.use_shm = true;
+  } else if (!M.linux_dmabuf) {
+    fprintf(stderr, "[capture] zwp_linux_dmabuf_v1 missing, using wl_shm\n");
+    M.use_shm = true;
+  } else if (!init_gbm()) {
+    fprintf(stderr, "[capture] no GBM device, using wl_shm\n");
+    M.use_shm = true;
+  }
+  if (M.use_shm && !M.shm) throw std::runtime_error("neither dma-buf nor wl_shm capture available");
+  if (M.use_shm)
+    fprintf(stdout, "[capture] wl_shm path, %s conversion\n", pixel_convert_impl());
 
-    // Request copy into our wl_buffer
-    zwlr_screencopy_frame_v1_copy(f, C->wlbuf);
+  // Unnamed outputs (wl_output < v4) still need a stable key
+  for (size_t i = 0; i < M.outs.size(); ++i)
+    if (M.outs[i]->name.empty()) M.outs[i]->name = "output-" + std::to_string(i);
 
-    // Wait for ready
-    while (!C->frame_ready) {
-      if (wl_display_dispatch(M.display) < 0)
-        throw std::runtime_error("dispatch failed waiting for frame_ready");
-    }
-    C->frame_ready = false;
-    zwlr_screencopy_frame_v1_destroy(f);
-
-    // Create EGLImage + GL texture
-    ensure_tex(C);
+  // Probe every output in parallel. Outputs with a cached size/format (see
+  // wlr_multi_set_hints) skip the offer round trip; if the cache is stale the
+  // compositor fails the copy and those outputs are probed again from scratch.
+  auto t0 = std::chrono::steady_clock::now();
+  const bool use_hints = !M.hints.empty() && !M.use_shm;
+  std::vector<OutputCtx*> failed = probe_outputs(M.outs, use_hints);
+  if (!failed.empty() && use_hints) {
+    for (auto* C : failed)
+      fprintf(stderr, "[capture] %s: cached size/format stale, probing\n", C->name.c_str());
+    failed = probe_outputs(failed, false);
   }
+  if (!failed.empty())
+    throw std::runtime_error("screencopy probe failed for " + failed[0]->name);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  fprintf(stdout, "[capture] %zu output(s) ready in %.1f ms\n", M.outs.size(), ms);
 
   // Build the exported list and simple horizontal placement
   outs.clear();
@@ -314,69 +1336,431 @@ void wlr_multi_capture_init(std::vector<CapturedOutput>& outs, int* totalW, int*
   int maxH = 0;
   for (auto* C : M.outs) {
     CapturedOutput co;
+    export_output(C, co);
     co.x = xcursor;
     co.y = 0;
-    co.width  = C->width;
-    co.height = C->height;
-    co.texture = C->texture;
     outs.push_back(co);
 
-    xcursor += C->width;
-    if (C->height > maxH) maxH = C->height;
+    xcursor += C->out_w;
+    if (C->out_h > maxH) maxH = C->out_h;
   }
   if (totalW) *totalW = xcursor;
   if (totalH) *totalH = maxH;
+  M.ready = true;
+}
+
+bool wlr_multi_update_outputs(std::vector<CapturedOutput>& outs) {
+  bool changed = false;
+
+  for (size_t i = 0; i < M.outs.size();) {
+    OutputCtx* C = M.outs[i];
+    if (!C->removed) {
+      // next_frame has already exported the new size, so the flag is what tells
+      if (i < outs.size() && (C->resized || outs[i].width != C->out_w || outs[i].height != C->out_h)) {
+        export_output(C, outs[i]);
+        changed = true;
+      }
+      C->resized = false;
+      ++i;
+      continue;
+    }
+    fprintf(stdout, "[capture] %s: removed\n", C->name.c_str());
+    release_output(C);
+    M.outs.erase(M.outs.begin() + i);
+    if (i < outs.size()) outs.erase(outs.begin() + i);
+    changed = true;
+  }
+
+  // Window sources join once their first frame is in the texture
+  for (size_t i = 0; i < M.added_windows.size();) {
+    OutputCtx* C = M.added_windows[i];
+    if (!C->removed) window_next_frame(C);
+    if (C->removed) {
+      fprintf(stderr, "[capture] %s: capture stopped\n", C->name.c_str());
+      release_output(C);
+    } else if (C->texture) {
+      CapturedOutput co;
+      export_output(C, co);
+      co.x = outs.empty() ? 0 : outs.back().x + outs.back().width;
+      fprintf(stdout, "[capture] %s: window %dx%d\n", C->name.c_str(), C->out_w, C->out_h);
+      M.outs.push_back(C);
+      outs.push_back(co);
+      changed = true;
+    } else {
+      ++i;
+      continue;
+    }
+    M.added_windows.erase(M.added_windows.begin() + i);
+  }
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  purge_toplevels();
+#endif
+
+  if (M.added.empty()) return changed;
+
+  // New globals: learn name/scale, then probe like at startup
+  std::vector<OutputCtx*> fresh;
+  fresh.swap(M.added);
+  wl_display_roundtrip(M.display);
+  for (size_t i = 0; i < fresh.size();) {
+    if (!fresh[i]->removed) { ++i; continue; }
+    release_output(fresh[i]);
+    fresh.erase(fresh.begin() + i);
+  }
+  for (auto* C : fresh)
+    if (C->name.empty()) C->name = "output-" + std::to_string(C->global);
+
+  std::vector<OutputCtx*> failed;
+  try {
+    failed = probe_outputs(fresh, false);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "[capture] probing new outputs: %s\n", e.what());
+    for (auto* C : fresh) free_capture_buffer(C);
+    failed = fresh;
+  }
+  for (auto* C : fresh) {
+    if (std::find(failed.begin(), failed.end(), C) != failed.end()) continue;
+    CapturedOutput co;
+    export_output(C, co);
+    co.x = outs.empty() ? 0 : outs.back().x + outs.back().width;
+    co.y = 0;
+    fprintf(stdout, "[capture] %s: added %dx%d\n", C->name.c_str(), C->out_w, C->out_h);
+    M.outs.push_back(C);
+    outs.push_back(co);
+    changed = true;
+  }
+  // A just-created output may not have a mode yet; retry on the next frames
+  for (auto* C : failed) {
+    if (++C->probe_tries < 3) { M.added.push_back(C); continue; }
+    fprintf(stderr, "[capture] %s: probe failed, ignoring output\n", C->name.c_str());
+    release_output(C);
+  }
+  return changed;
+}
+
+void wlr_multi_set_hints(const std::vector<CaptureHint>& hints) {
+  M.hints = hints;
+}
+
+void wlr_multi_set_region(size_t index, int x, int y, int w, int h) {
+  if (index >= M.outs.size()) return;
+  OutputCtx* C = M.outs[index];
+  C->roi_x = x;
+  C->roi_y = y;
+  C->roi_w = w > 0 ? w : 0;
+  C->roi_h = h > 0 ? h : 0;
+}
+
+// Throttling (wlr_multi_set_interval): true when output C should copy this frame
+static bool capture_due(OutputCtx* C) {
+  if (C->interval <= 0) return false;
+  if (++C->idle < C->interval) return false;
+  C->idle = 0;
+  return true;
+}
+
+// --------- wl_shm frame pump ----------
+static void shm_start_copy(OutputCtx* C) {
+  C->frame_ready = C->frame_failed = C->buffer_done = false;
+  C->dmg_y0 = C->dmg_y1 = 0;
+  C->shm_inflight = zwlr_screencopy_manager_v1_capture_output(M.screencopy, 0, C->wlo);
+  if (!C->shm_inflight) throw std::runtime_error("capture_output (shm) returned null");
+  zwlr_screencopy_frame_v1_add_listener(C->shm_inflight, &FRAME_LST, C);
+  // Compositor holds the frame until something changes and reports the damage
+  zwlr_screencopy_frame_v1_copy_with_damage(C->shm_inflight, C->wlbuf);
+}
+
+// Read whatever events arrive within timeout_ms (0: don't block, < 0: wait)
+static void pump_events(int timeout_ms) {
+  while (wl_display_prepare_read(M.display) != 0)
+    wl_display_dispatch_pending(M.display);
+  wl_display_flush(M.display);
+  pollfd pfd{ wl_display_get_fd(M.display), POLLIN, 0 };
+  if (poll(&pfd, 1, timeout_ms) > 0) {
+    if (wl_display_read_events(M.display) < 0)
+      throw std::runtime_error("wl_display_read_events failed");
+  } else {
+    wl_display_cancel_read(M.display);
+  }
+  if (wl_display_dispatch_pending(M.display) < 0)
+    throw std::runtime_error("wayland dispatch failed");
+}
+
+// Unlike the dma-buf path this never blocks: each output keeps one
+// copy_with_damage in flight, and static outputs simply keep their texture.
+// Regions of interest are not used here; shm always copies whole outputs.
+static void shm_next_frame(std::vector<CapturedOutput>& outs) {
+  for (auto* C : M.outs)
+    if (!C->shm_inflight && !C->removed && !C->window && capture_due(C)) shm_start_copy(C);
+
+  pump_events(0);
+  update_cursors();
+  // Cursors move without new frames
+  for (size_t i = 0; i < M.outs.size() && i < outs.size(); ++i)
+    export_cursor(M.outs[i], outs[i]);
+
+  for (size_t i = 0; i < M.outs.size(); ++i) {
+    OutputCtx* C = M.outs[i];
+    if (C->window) {
+      window_next_frame(C);
+      if (i < outs.size()) export_output(C, outs[i]);
+      continue;
+    }
+    if (!C->shm_inflight || (!C->frame_ready && !C->frame_failed)) continue;
+
+    const bool ok   = C->frame_ready;
+    const int  slot = C->shm_cur;
+    const int  y0 = C->dmg_y0, y1 = C->dmg_y1;
+    zwlr_screencopy_frame_v1_destroy(C->shm_inflight);
+    C->shm_inflight = nullptr;
+
+    const bool resized = C->width != C->shm_w || C->height != C->shm_h;
+    if (!ok && C->buffer_done &&
+        (resized || C->shm_format != C->shm_ring_format || C->shm_stride != C->shm_ring_stride)) {
+      // Output mode or buffer format changed under us: rebuild the ring (and
+      // its pixel layout) for the new offer
+      fprintf(stderr, "[capture] %s: now %dx%d, shm format 0x%08x, stride %u\n", C->name.c_str(),
+              C->width, C->height, C->shm_format, C->shm_stride);
+      free_shm_ring(C);
+      alloc_shm_ring(C);
+      C->out_w = C->src_w = C->alloc_req_w = C->width;
+      C->out_h = C->src_h = C->alloc_req_h = C->height;
+      C->resized = C->resized || resized;
+    } else if (ok) {
+      // Start the next copy into the other slot first, then convert this one
+      C->shm_cur = (slot + 1) % SHM_RING;
+      C->wlbuf = C->shm_bufs[C->shm_cur];
+    }
+    // Throttled outputs start their next copy when due (see above)
+    if (!C->removed && C->interval == 1) shm_start_copy(C);
+    if (ok) upload_shm(C, slot, y0, y1);
+    if (i < outs.size()) export_output(C, outs[i]);
+  }
+}
+
+// Copies that waited for the compositor's offer of a new region size or
+// format: reallocate the spare buffer and issue them. Until they land the
+// texture keeps showing the last finished copy.
+static void start_waiting_copies() {
+  for (auto* C : M.outs) {
+    if (!C->dma_inflight || !C->dma_awaiting || !C->buffer_done || C->frame_failed) continue;
+    C->dma_awaiting = false;
+    if (C->width <= 0 || C->height <= 0)
+      throw std::runtime_error("invalid w/h from screencopy region");
+    swap_dma_slot(C);
+    free_dmabuf_and_wlbuf(C);
+    alloc_dmabuf_and_wlbuf(C);
+    C->alloc_req_w = C->pend_w;
+    C->alloc_req_h = C->pend_h;
+    swap_dma_slot(C);
+    zwlr_screencopy_frame_v1_copy(C->dma_inflight, C->spare.buf);
+  }
 }
 
 void wlr_multi_next_frame(std::vector<CapturedOutput>& outs) {
-  (void)outs; // our internal contexts already hold wl_buffer/tex
+  for (auto* C : M.outs) C->upd_y0 = C->upd_y1 = 0;
+  for (auto& o : outs) o.dirty_y0 = o.dirty_y1 = 0;
+  M.last_wait_us = 0;
+  if (M.use_shm) { shm_next_frame(outs); return; }
 
-  // Kick a screencopy for each output and wait until each is ready
+  // Kick a screencopy for each due output (whole output or its region of
+  // interest). Outputs whose previous copy is still running are left alone.
   for (auto* C : M.outs) {
+    if (C->window || C->dma_inflight) continue;
     C->frame_ready = false;
-    zwlr_screencopy_frame_v1* f =
-      zwlr_screencopy_manager_v1_capture_output(M.screencopy, 0, C->wlo);
+    C->frame_failed = false;
+    if (C->removed || !capture_due(C)) continue;
+
+    int rx = 0, ry = 0, rw = C->out_w, rh = C->out_h;
+    const bool region = fit_region(C, rx, ry, rw, rh);
+    if (!region) { rx = 0; ry = 0; rw = C->out_w; rh = C->out_h; }
+
+    zwlr_screencopy_frame_v1* f = region
+      ? zwlr_screencopy_manager_v1_capture_output_region(
+          M.screencopy, 0, C->wlo, rx / C->scale, ry / C->scale, rw / C->scale, rh / C->scale)
+      : zwlr_screencopy_manager_v1_capture_output(M.screencopy, 0, C->wlo);
     if (!f) throw std::runtime_error("capture_output (next) returned null");
     zwlr_screencopy_frame_v1_add_listener(f, &FRAME_LST, C);
-    zwlr_screencopy_frame_v1_copy(f, C->wlbuf);
+    C->dma_inflight = f;
+    C->pend_x = rx; C->pend_y = ry; C->pend_w = rw; C->pend_h = rh;
+
+    if (!C->spare.buf || rw != C->spare.req_w || rh != C->spare.req_h || C->fourcc != C->spare.fourcc) {
+      // Copy size or negotiated format changed: the spare is reallocated once
+      // the offer arrives (start_waiting_copies), without blocking this frame
+      C->width = C->height = 0;
+      C->got_dmabuf_announce = false;
+      C->buffer_done = false;
+      C->dma_awaiting = true;
+      continue;
+    }
+    zwlr_screencopy_frame_v1_copy(f, C->spare.buf);
   }
 
-  // Drain events until everyone is ready
-  bool anyPending = true;
-  while (anyPending) {
-    if (wl_display_dispatch(M.display) < 0)
-      throw std::runtime_error("dispatch failed waiting for next frames");
-    anyPending = false;
-    for (auto* C : M.outs) if (!C->frame_ready) { anyPending = true; break; }
+  // Wait for the copies, at most the wait budget; late ones are collected by
+  // a later call. They write the spare buffer, so the texture keeps showing
+  // the last finished copy until then.
+  const auto t0 = std::chrono::steady_clock::now();
+  for (;;) {
+    start_waiting_copies();
+    bool anyPending = false;
+    for (auto* C : M.outs)
+      if (C->dma_inflight && !C->frame_ready && !C->frame_failed) { anyPending = true; break; }
+    if (!anyPending) break;
+    int timeout_ms = -1;
+    if (M.wait_budget_us >= 0) {
+      long left = M.wait_budget_us - (long)std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::steady_clock::now() - t0).count();
+      if (left <= 0) break;
+      timeout_ms = (int)((left + 999) / 1000);
+    }
+    pump_events(timeout_ms);
   }
+  M.last_wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - t0).count();
+  // Window and cursor events arrive independently of the copies above
+  pump_events(0);
+  update_cursors();
 
-  for (auto* C : M.outs) {
+  for (size_t i = 0; i < M.outs.size(); ++i) {
+    OutputCtx* C = M.outs[i];
+    if (C->window) {
+      window_next_frame(C);
+      if (i < outs.size()) export_output(C, outs[i]);
+      continue;
+    }
+    if (i < outs.size()) export_cursor(C, outs[i]);
+    if (!C->dma_inflight || (!C->frame_ready && !C->frame_failed)) continue;
+    zwlr_screencopy_frame_v1_destroy(C->dma_inflight);
+    C->dma_inflight = nullptr;
+    C->dma_awaiting = false;
+
+    if (C->frame_failed && C->buffer_done && C->pend_w == C->out_w && C->pend_h == C->out_h &&
+        C->width > 0 && C->height > 0 && (C->width != C->out_w || C->height != C->out_h)) {
+      // Output mode changed under us: the next frame reallocates at the new size
+      fprintf(stderr, "[capture] %s: resized to %dx%d\n", C->name.c_str(), C->width, C->height);
+      C->out_w = C->src_w = C->width;
+      C->out_h = C->src_h = C->height;
+      C->resized = true;
+    }
+    if (C->frame_ready) {
+      C->src_x = C->pend_x; C->src_y = C->pend_y; C->src_w = C->pend_w; C->src_h = C->pend_h;
+      swap_dma_slot(C);
+      ensure_tex(C);
+    }
     C->frame_ready = false;
-    // Rebind the texture to ensure GL sees the image (not strictly required every frame)
-    ensure_tex(C);
+    if (i < outs.size()) export_output(C, outs[i]);
   }
 }
 
+void wlr_multi_set_interval(size_t index, int n) {
+  if (index >= M.outs.size()) return;
+  M.outs[index]->interval = n > 0 ? n : 0;
+}
+
+void wlr_multi_set_wait_budget(int us) { M.wait_budget_us = us; }
+
+long wlr_multi_last_wait_us() { return M.last_wait_us; }
+
 void wlr_multi_shutdown() {
-  for (auto* C : M.outs) {
-    if (C->egl_img != EGL_NO_IMAGE_KHR) {
-      if (p_eglDestroyImage)     p_eglDestroyImage(M.egl_dpy, C->egl_img);
-      else if (p_eglDestroyImageKHR) p_eglDestroyImageKHR(M.egl_dpy, C->egl_img);
-      C->egl_img = EGL_NO_IMAGE_KHR;
-    }
-    if (C->texture) { glDeleteTextures(1, &C->texture); C->texture = 0; }
-    if (C->wlbuf)   { wl_buffer_destroy(C->wlbuf); C->wlbuf = nullptr; }
-    if (C->dmabuf_fd >= 0) { close(C->dmabuf_fd); C->dmabuf_fd = -1; }
-    if (C->wlo) { wl_output_destroy(C->wlo); C->wlo = nullptr; }
-    delete C;
-  }
+  for (auto* C : M.outs)  release_output(C);
+  for (auto* C : M.added) release_output(C);
+  for (auto* C : M.added_windows) release_output(C);
   M.outs.clear();
+  M.added.clear();
+  M.added_windows.clear();
+  M.ready = false;
+  pool_clear();
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+  for (auto* T : M.toplevels) { ext_foreign_toplevel_handle_v1_destroy(T->handle); delete T; }
+  M.toplevels.clear();
+  if (M.toplevel_list)    { ext_foreign_toplevel_list_v1_destroy(M.toplevel_list); M.toplevel_list = nullptr; }
+  if (M.toplevel_sources) {
+    ext_foreign_toplevel_image_capture_source_manager_v1_destroy(M.toplevel_sources);
+    M.toplevel_sources = nullptr;
+  }
+  if (M.copy_capture) { ext_image_copy_capture_manager_v1_destroy(M.copy_capture); M.copy_capture = nullptr; }
+  if (M.output_sources) {
+    ext_output_image_capture_source_manager_v1_destroy(M.output_sources);
+    M.output_sources = nullptr;
+  }
+#endif
+  if (M.pointer) {
+    if (wl_pointer_get_version(M.pointer) >= WL_POINTER_RELEASE_SINCE_VERSION) wl_pointer_release(M.pointer);
+    else wl_pointer_destroy(M.pointer);
+    M.pointer = nullptr;
+  }
+  if (M.seat) {
+    if (wl_seat_get_version(M.seat) >= WL_SEAT_RELEASE_SINCE_VERSION) wl_seat_release(M.seat);
+    else wl_seat_destroy(M.seat);
+    M.seat = nullptr;
+  }
 
   if (M.linux_dmabuf) { zwp_linux_dmabuf_v1_destroy(M.linux_dmabuf); M.linux_dmabuf = nullptr; }
   if (M.screencopy)   { zwlr_screencopy_manager_v1_destroy(M.screencopy); M.screencopy = nullptr; }
+  if (M.shm)          { wl_shm_destroy(M.shm); M.shm = nullptr; }
   if (M.registry)     { wl_registry_destroy(M.registry); M.registry = nullptr; }
   if (M.display)      { wl_display_disconnect(M.display); M.display = nullptr; }
-  if (M.gbm)          { gbm_device_destroy(M.gbm); M.gbm = nullptr; }
-  if (M.drm_fd >= 0)  { close(M.drm_fd); M.drm_fd = -1; }
+  if (M.gbm)          { render_device_release(); M.gbm = nullptr; }
+}
+
+
+// --------- Window sources: public API ----------
+#ifdef HAVE_EXT_IMAGE_COPY_CAPTURE
+bool wlr_multi_windows_supported() {
+  return M.toplevel_list && M.toplevel_sources && M.copy_capture;
+}
+
+std::vector<CaptureWindow> wlr_multi_windows() {
+  std::vector<CaptureWindow> ws;
+  for (const auto* T : M.toplevels)
+    if (!T->closed) ws.push_back(CaptureWindow{T->id, T->app_id, T->title});
+  return ws;
 }
 
+static bool name_taken(const std::string& name) {
+  for (const auto* C : M.outs)          if (C->name == name) return true;
+  for (const auto* C : M.added_windows) if (C->name == name) return true;
+  return false;
+}
+
+std::string wlr_multi_add_window(const std::string& match) {
+  if (!wlr_multi_windows_supported() || match.empty()) return "";
+
+  // Exact identifier or app_id first, then a title substring
+  const Toplevel* found = nullptr;
+  for (const auto* T : M.toplevels)
+    if (!T->closed && (T->id == match || T->app_id == match)) { found = T; break; }
+  if (!found)
+    for (const auto* T : M.toplevels)
+      if (!T->closed && T->title.find(match) != std::string::npos) { found = T; break; }
+  if (!found) return "";
+
+  auto* C = new OutputCtx();
+  C->window = true;
+  std::string base = "window:" + (found->app_id.empty() ? found->id : found->app_id);
+  C->name = base;
+  for (int k = 2; name_taken(C->name); ++k) C->name = base + "-" + std::to_string(k);
+
+  C->win_source = ext_foreign_toplevel_image_capture_source_manager_v1_create_source(
+    M.toplevel_sources, found->handle);
+  C->win_session = ext_image_copy_capture_manager_v1_create_session(M.copy_capture, C->win_source, 0);
+  ext_image_copy_capture_session_v1_add_listener(C->win_session, &WIN_SESSION_LST, C);
+  wl_display_flush(M.display);
+  M.added_windows.push_back(C);
+  fprintf(stdout, "[capture] %s: capturing \"%s\"\n", C->name.c_str(), found->title.c_str());
+  return C->name;
+}
+
+bool wlr_multi_remove_window(const std::string& name) {
+  for (auto* C : M.outs)
+    if (C->window && C->name == name) { C->removed = true; return true; }
+  for (auto* C : M.added_windows)
+    if (C->name == name) { C->removed = true; return true; }
+  return false;
+}
+#else
+bool wlr_multi_windows_supported() { return false; }
+std::vector<CaptureWindow> wlr_multi_windows() { return {}; }
+std::string wlr_multi_add_window(const std::string&) { return ""; }
+bool wlr_multi_remove_window(const std::string&) { return false; }
+#endif
@@ -1,4 +1,6 @@
 #include "capture_wlr_dmabuf.hpp"
+#include "platform.hpp"
+#include "render_device.hpp"
 
 #include <wayland-client.h>
 #include <EGL/egl.h>
@@ -39,8 +41,7 @@ struct WLCtx {
   zwp_linux_dmabuf_v1*        linux_dmabuf = nullptr;
 
   // DRM/GBM
-  int         drm_fd = -1;
-  gbm_device* gbm    = nullptr;
+  gbm_device* gbm    = nullptr;   // shared, render_device.hpp
   gbm_bo*     bo     = nullptr;
 
   // Format & geometry
@@ -93,17 +94,6 @@ static void ensure_egl_image_fns() {
     throw std::runtime_error("No eglCreateImage(KHR) function available from EGL");
 }
 
-static int open_render_node() {
-  const char* cands[] = {
-    "/dev/dri/renderD128", "/dev/dri/renderD129", "/dev/dri/renderD130"
-  };
-  for (const char* p : cands) {
-    int fd = open(p, O_RDWR | O_CLOEXEC);
-    if (fd >= 0) return fd;
-  }
-  throw std::runtime_error("Failed to open DRM render node (/dev/dri/renderD12x)");
-}
-
 // ---------- registry ----------
 static void reg_global(void*, wl_registry* reg, uint32_t name, const char* iface, uint32_t ver) {
   if (strcmp(iface, wl_output_interface.name) == 0) {
@@ -153,10 +143,9 @@ static const zwlr_screencopy_frame_v1_listener FRAME_LST = {
 
 // ---------- allocate our dmabuf + wl_buffer ----------
 static void create_gbm_and_wlbuffer() {
-  if (G.drm_fd < 0) G.drm_fd = open_render_node();
   if (!G.gbm) {
-    G.gbm = gbm_create_device(G.drm_fd);
-    if (!G.gbm) throw std::runtime_error("gbm_create_device failed");
+    G.gbm = render_device_acquire();
+    if (!G.gbm) throw std::runtime_error("no usable GBM device");
   }
   const uint32_t fmt = G.fourcc ? G.fourcc : DRM_FORMAT_XRGB8888;
 
@@ -189,8 +178,8 @@ static void ensure_egl_image_and_texture() {
   if (G.tex == 0) glGenTextures(1, &G.tex);
 
   if (G.egl_img == EGL_NO_IMAGE_KHR) {
-    G.egl_dpy = eglGetCurrentDisplay();
-    if (G.egl_dpy == EGL_NO_DISPLAY) throw std::runtime_error("No current EGLDisplay");
+    G.egl_dpy = platform_egl_display();
+    if (G.egl_dpy == EGL_NO_DISPLAY) throw std::runtime_error("No platform EGLDisplay");
     ensure_gl_egl_image_fn();
     ensure_egl_image_fns();
 
@@ -323,12 +312,11 @@ void wlr_dmabuf_capture_shutdown() {
   if (G.wlbuf)   { wl_buffer_destroy(G.wlbuf); G.wlbuf = nullptr; }
   for (int i=0;i<4;++i) if (G.fds[i] >= 0) { close(G.fds[i]); G.fds[i] = -1; }
   if (G.bo)      { gbm_bo_destroy(G.bo); G.bo = nullptr; }
-  if (G.gbm)     { gbm_device_destroy(G.gbm); G.gbm = nullptr; }
+  if (G.gbm)     { render_device_release(); G.gbm = nullptr; }
   if (G.output)  { wl_output_destroy(G.output); G.output = nullptr; }
   if (G.linux_dmabuf) { zwp_linux_dmabuf_v1_destroy(G.linux_dmabuf); G.linux_dmabuf = nullptr; }
   if (G.screencopy)   { zwlr_screencopy_manager_v1_destroy(G.screencopy); G.screencopy = nullptr; }
   if (G.registry){ wl_registry_destroy(G.registry); G.registry = nullptr; }
   if (G.display) { wl_display_disconnect(G.display); G.display = nullptr; }
-  if (G.drm_fd >= 0) { close(G.drm_fd); G.drm_fd = -1; }
 }
 
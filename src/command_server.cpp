@@ -6,10 +6,15 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <cerrno>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // If libsystemd is available we’ll prefer its helpers.
 // CMake will define HAVE_LIBSYSTEMD when found (see patches below).
@@ -17,19 +22,54 @@
   #include <systemd/sd-daemon.h>
 #endif
 
-// ---- public callbacks ----
 static int g_listen_fd = -1;
 
-void (*cmd_on_align)()             = nullptr;
-void (*cmd_on_push)()              = nullptr;
-void (*cmd_on_pop)()               = nullptr;
-void (*cmd_on_zoom_in_fov)()           = nullptr;
-void (*cmd_on_zoom_out_fov)()          = nullptr;
-void (*cmd_on_zoom_in)()           = nullptr;
-void (*cmd_on_zoom_out)()          = nullptr;
-void (*cmd_on_shift_left)()        = nullptr;
-void (*cmd_on_shift_right)()       = nullptr;
-void (*cmd_on_toggle_center_dot)() = nullptr;
+// ---- command registry ----
+struct Command {
+  std::vector<CmdArgSpec> spec;
+  CmdHandler              fn;
+};
+static std::unordered_map<std::string, Command>  g_cmds;
+static std::unordered_map<std::string, CmdQuery> g_queries;
+
+void cmdsrv_register(const std::string& name, std::vector<CmdArgSpec> args, CmdHandler fn) {
+  Command c;
+  c.spec = std::move(args);
+  c.fn   = std::move(fn);
+  g_cmds[name] = std::move(c);
+}
+
+void cmdsrv_register_query(const std::string& key, CmdQuery fn) {
+  g_queries[key] = std::move(fn);
+}
+
+// ---- connected clients ----
+struct Client {
+  int      fd         = -1;
+  uint64_t id         = 0;
+  bool     subscribed = false;
+};
+static const size_t MAX_CLIENTS = 16;
+static const size_t MAX_PACKET  = 4096;
+static std::vector<Client> g_clients;
+static uint64_t g_next_client_id = 1;
+
+// ---- work queued for cmdsrv_dispatch ----
+// Map values are node-stable, so Command/CmdQuery pointers stay valid.
+struct PendingCmd {
+  std::string     id;                // "#n " reply prefix, may be empty
+  std::string     error;             // parse error, replied as-is
+  const Command*  cmd   = nullptr;
+  const CmdQuery* query = nullptr;
+  int             subscribe = -1;    // 1 subscribe, 0 unsubscribe
+  CmdArgs         args;
+};
+struct PendingPacket {
+  uint64_t                client = 0;
+  std::vector<PendingCmd> cmds;
+};
+static std::mutex                 g_pending_mtx;
+static std::vector<PendingPacket> g_pending;
 
 // ---- helpers ----
 static int set_nonblock(int fd) {
@@ -194,19 +234,145 @@ bool cmdsrv_init() {
   return true;
 }
 
-static void handle_cmd(const std::string& cmd) {
-  if (cmd == "align")                 { if (cmd_on_align)             cmd_on_align(); }
-  else if (cmd == "push")             { if (cmd_on_push)              cmd_on_push(); }
-  else if (cmd == "pop")              { if (cmd_on_pop)               cmd_on_pop(); }
-  else if (cmd == "zoom-in-fov")      { if (cmd_on_zoom_in_fov)       cmd_on_zoom_in_fov(); }
-  else if (cmd == "zoom-out-fov")     { if (cmd_on_zoom_out_fov)      cmd_on_zoom_out_fov(); }
-  else if (cmd == "zoom-in")          { if (cmd_on_zoom_in)           cmd_on_zoom_in(); }
-  else if (cmd == "zoom-out")         { if (cmd_on_zoom_out)          cmd_on_zoom_out(); }
-  else if (cmd == "shift-left")       { if (cmd_on_shift_left)        cmd_on_shift_left(); }
-  else if (cmd == "shift-right")      { if (cmd_on_shift_right)       cmd_on_shift_right(); }
-  else if (cmd == "toggle-center-dot"){ if (cmd_on_toggle_center_dot) cmd_on_toggle_center_dot(); }
-  else {
-    std::fprintf(stderr, "unknown cmd: %s\n", cmd.c_str());
+static bool parse_number(const std::string& tok, double& out) {
+  const char* s = tok.c_str();
+  char* end = nullptr;
+  errno = 0;
+  double v = std::strtod(s, &end);
+  // "nan" and "inf" parse but slip past every range check
+  if (end == s || *end != 0 || errno == ERANGE || !std::isfinite(v)) return false;
+  out = v;
+  return true;
+}
+
+// Parses one command line into `pc`. Returns false for blank lines.
+static bool parse_cmd(const std::string& line, PendingCmd& pc) {
+  // tokenize on whitespace
+  std::vector<std::string> tok;
+  size_t p = 0;
+  while (p < line.size()) {
+    while (p < line.size() && (line[p] == ' ' || line[p] == '\t' || line[p] == '\r')) ++p;
+    size_t e = p;
+    while (e < line.size() && line[e] != ' ' && line[e] != '\t' && line[e] != '\r') ++e;
+    if (e > p) tok.emplace_back(line, p, e - p);
+    p = e;
+  }
+  if (tok.empty()) return false;
+
+  if (tok[0][0] == '#') { pc.id = tok[0] + " "; tok.erase(tok.begin()); }
+  if (tok.empty()) { pc.error = "missing command"; return true; }
+
+  const std::string& name = tok[0];
+  if (name == "get") {
+    auto it = tok.size() == 2 ? g_queries.find(tok[1]) : g_queries.end();
+    if (tok.size() != 2)            pc.error = "usage: get <key>";
+    else if (it == g_queries.end()) pc.error = "unknown key";
+    else                            pc.query = &it->second;
+    return true;
+  }
+  if (name == "subscribe")   { pc.subscribe = 1; return true; }
+  if (name == "unsubscribe") { pc.subscribe = 0; return true; }
+
+  auto it = g_cmds.find(name);
+  if (it == g_cmds.end()) {
+    std::fprintf(stderr, "unknown cmd: %s\n", name.c_str());
+    pc.error = "unknown command";
+    return true;
+  }
+
+  const std::vector<CmdArgSpec>& spec = it->second.spec;
+  const size_t given = tok.size() - 1;
+  if (given > spec.size()) { pc.error = "too many arguments"; return true; }
+
+  pc.args.nums.assign(spec.size(), 0.0);
+  pc.args.strs.assign(spec.size(), std::string());
+  for (size_t a = 0; a < spec.size(); ++a) {
+    const CmdArgSpec& as = spec[a];
+    if (a >= given) {
+      if (!as.optional) { pc.error = "missing argument"; return true; }
+      pc.args.nums[a] = as.def;
+      continue;
+    }
+    const std::string& t = tok[a + 1];
+    if (as.type == CmdArgSpec::String) { pc.args.strs[a] = t; continue; }
+    double v;
+    if (!parse_number(t, v))         { pc.error = "bad number '" + t + "'"; return true; }
+    if (v < as.min || v > as.max)    { pc.error = "out of range '" + t + "'"; return true; }
+    pc.args.nums[a] = v;
+  }
+  pc.cmd = &it->second;
+  return true;
+}
+
+static void send_packet(Client& cl, const std::string& s) {
+  if (cl.fd < 0 || s.empty()) return;
+  if (::send(cl.fd, s.data(), s.size(), MSG_NOSIGNAL | MSG_DONTWAIT) < 0 &&
+      errno != EAGAIN && errno != EWOULDBLOCK) {
+    ::close(cl.fd);   // peer went away; reaped in cmdsrv_poll
+    cl.fd = -1;
+  }
+}
+
+// Reads every pending packet of one client. Returns false once it disconnected.
+static bool service_client(Client& cl) {
+  char buf[MAX_PACKET];
+  for (;;) {
+    ssize_t n = ::recv(cl.fd, buf, sizeof(buf), 0);
+    if (n == 0) return false;
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    // Split the packet into commands; they run and reply together in dispatch
+    PendingPacket pkt;
+    pkt.client = cl.id;
+    size_t start = 0;
+    for (size_t i = 0; i <= (size_t)n; ++i) {
+      if (i == (size_t)n || buf[i] == '\n' || buf[i] == ';') {
+        PendingCmd pc;
+        if (i > start && parse_cmd(std::string(buf + start, i - start), pc))
+          pkt.cmds.push_back(std::move(pc));
+        start = i + 1;
+      }
+    }
+    if (!pkt.cmds.empty()) {
+      std::lock_guard<std::mutex> lk(g_pending_mtx);
+      g_pending.push_back(std::move(pkt));
+    }
+  }
+}
+
+static Client* find_client(uint64_t id) {
+  for (auto& cl : g_clients)
+    if (cl.id == id) return &cl;
+  return nullptr;
+}
+
+void cmdsrv_dispatch() {
+  std::vector<PendingPacket> work;
+  {
+    std::lock_guard<std::mutex> lk(g_pending_mtx);
+    work.swap(g_pending);
+  }
+
+  for (auto& pkt : work) {
+    Client* cl = find_client(pkt.client);
+    std::string reply;
+    for (auto& pc : pkt.cmds) {
+      if (!pc.error.empty()) { reply += pc.id + "err " + pc.error + "\n"; continue; }
+      if (pc.query) { reply += pc.id + "ok " + (*pc.query)() + "\n"; continue; }
+      if (pc.subscribe >= 0) {
+        if (cl) cl->subscribed = pc.subscribe == 1;
+        reply += pc.id + "ok\n";
+        continue;
+      }
+      pc.cmd->fn(pc.args);
+      reply += pc.id + "ok\n";
+    }
+    // client may have gone away since the packet was read; commands still ran
+    if (cl) send_packet(*cl, reply);
   }
 }
 
@@ -220,25 +386,42 @@ void cmdsrv_poll() {
       perror("accept");
       break;
     }
-
-    // One short command per connection
-    char buf[256];
-    ssize_t n = ::recv(cfd, buf, sizeof(buf)-1, 0);
-    if (n > 0) {
-      buf[n] = 0;
-      std::string s(buf);
-      // trim trailing whitespace/newlines
-      while (!s.empty() && (s.back()=='\n' || s.back()=='\r' || s.back()==' ')) s.pop_back();
-      handle_cmd(s);
+    if (g_clients.size() >= MAX_CLIENTS) {
+      std::fprintf(stderr, "cmdsrv: too many clients, dropping connection\n");
+      ::close(cfd);
+      continue;
     }
-    ::close(cfd);
+    Client cl;
+    cl.fd = cfd;
+    cl.id = g_next_client_id++;
+    g_clients.push_back(cl);
+  }
+
+  for (size_t i = 0; i < g_clients.size();) {
+    if (g_clients[i].fd >= 0 && service_client(g_clients[i])) { ++i; continue; }
+    if (g_clients[i].fd >= 0) ::close(g_clients[i].fd);
+    g_clients.erase(g_clients.begin() + i);
   }
 }
 
+bool cmdsrv_has_subscribers() {
+  for (const auto& cl : g_clients)
+    if (cl.subscribed) return true;
+  return false;
+}
+
+void cmdsrv_publish(const std::string& key, const std::string& value) {
+  const std::string msg = "event " + key + " " + value + "\n";
+  for (auto& cl : g_clients)
+    if (cl.subscribed) send_packet(cl, msg);
+}
+
 void cmdsrv_shutdown() {
+  for (auto& cl : g_clients)
+    if (cl.fd >= 0) ::close(cl.fd);
+  g_clients.clear();
   if (g_listen_fd >= 0) {
     ::close(g_listen_fd);
     g_listen_fd = -1;
   }
 }
-
@@ -0,0 +1,79 @@
+#include "foveation.hpp"
+#include "offscreen_target.hpp"
+
+#include <GL/gl.h>
+#include <algorithm>
+#include <cstdio>
+
+static bool  enabled = false;
+static float size_frac = 0.45f;
+static float scale = 0.5f;
+
+static OffscreenTarget target;   // periphery
+
+// Current frame
+static int    fb_w = 0, fb_h = 0;
+static bool   active = false;
+
+void fovea_set_enabled(bool on) { enabled = on; }
+bool fovea_enabled() { return enabled; }
+void fovea_set_size(float f) { size_frac = std::clamp(f, 0.1f, 1.0f); }
+float fovea_size() { return size_frac; }
+void fovea_set_scale(float s) { scale = std::clamp(s, 0.25f, 1.0f); }
+float fovea_scale() { return scale; }
+
+// Center rect in a w x h viewport
+static void center_rect(int w, int h, int& x, int& y, int& cw, int& ch) {
+  cw = int(w * size_frac + 0.5f);
+  ch = int(h * size_frac + 0.5f);
+  x = (w - cw) / 2;
+  y = (h - ch) / 2;
+}
+
+bool fovea_begin_periphery(int w, int h) {
+  active = false;
+  if (!enabled || size_frac >= 1.0f || w <= 0 || h <= 0) return false;
+  const int lw = std::max(1, int(w * scale)), lh = std::max(1, int(h * scale));
+  if (!target_ensure(target, lw, lh)) {
+    fprintf(stderr, "[fovea] no %dx%d periphery target, foveation off\n", lw, lh);
+    enabled = false;
+    return false;
+  }
+  fb_w = w; fb_h = h;
+  active = true;
+
+  target_bind(target);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  // Depth 0 over the center: the full-resolution pass covers it, so early-z
+  // rejects everything there instead of shading it twice. Inset by a texel
+  // so rounding never leaves a gap between the two passes.
+  int x, y, cw, ch;
+  center_rect(lw, lh, x, y, cw, ch);
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(x + 1, y + 1, std::max(0, cw - 2), std::max(0, ch - 2));
+  glClearDepth(0.0);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  glClearDepth(1.0);
+  glDisable(GL_SCISSOR_TEST);
+  return true;
+}
+
+void fovea_begin_center() {
+  if (!active) return;
+  target_blit_to_prev(target, fb_w, fb_h);
+
+  int x, y, cw, ch;
+  center_rect(fb_w, fb_h, x, y, cw, ch);
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(x, y, cw, ch);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void fovea_end() {
+  if (!active) return;
+  glDisable(GL_SCISSOR_TEST);
+  active = false;
+}
+
+void fovea_shutdown() { target_free(target); }
@@ -0,0 +1,275 @@
+#include "frame_dump.hpp"
+#include "session_state.hpp"
+
+#include <GL/gl.h>
+#include <sys/types.h>
+#include <zlib.h>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Readback ring: a PBO is mapped RING-1 frames after its glReadPixels, by
+// which time the copy has long finished on any GPU we run on.
+static const int    RING      = 3;
+// Frames waiting for the compressor. At ~8 MB per 1080p frame this bounds the
+// recorder's memory; past it frames are dropped.
+static const size_t MAX_QUEUE = 4;
+
+struct Slot {
+  GLuint   pbo   = 0;
+  GLsync   fence = nullptr;
+  size_t   size  = 0;
+  int      w = 0, h = 0;
+  uint64_t t_us  = 0;
+};
+struct Job {
+  std::vector<uint8_t> px;
+  int      w = 0, h = 0;
+  uint64_t t_us = 0;
+};
+
+// Render thread only
+static Slot   slots[RING];
+static int    next_slot = 0;
+static bool   recording = false;
+static std::string out_path;
+static std::chrono::steady_clock::time_point t0;
+static double readback_us = 0.0;    // EMA of issue + map + copy, render thread
+
+// Shared with the worker, under mu
+static std::mutex mu;
+static std::condition_variable cv;
+static std::deque<Job> queue;
+static std::vector<std::vector<uint8_t>> spare;   // recycled pixel buffers
+static bool   stop_worker = false;
+static long   written = 0, dropped = 0;
+static double compress_ms = 0.0;   // EMA
+static uint64_t raw_bytes = 0, file_bytes = 0;
+
+// Worker only (and stop, after the join)
+static std::thread worker;
+static FILE* out = nullptr;
+static std::vector<uint64_t> offsets;
+
+static uint64_t now_us() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - t0).count());
+}
+
+static void put32(std::vector<uint8_t>& b, uint32_t v) {
+  for (int i = 0; i < 4; ++i) b.push_back(uint8_t(v >> (8 * i)));
+}
+static void put64(std::vector<uint8_t>& b, uint64_t v) {
+  for (int i = 0; i < 8; ++i) b.push_back(uint8_t(v >> (8 * i)));
+}
+static void put_magic(std::vector<uint8_t>& b, const char* m) { b.insert(b.end(), m, m + 4); }
+
+static void worker_main() {
+  std::vector<uint8_t> z, hdr;
+  for (;;) {
+    Job j;
+    {
+      std::unique_lock<std::mutex> lk(mu);
+      cv.wait(lk, [] { return stop_worker || !queue.empty(); });
+      if (queue.empty()) break;   // stopping and drained
+      j = std::move(queue.front());
+      queue.pop_front();
+    }
+    const auto c0 = std::chrono::steady_clock::now();
+    uLongf zlen = compressBound(uLong(j.px.size()));
+    z.resize(zlen);
+    const bool ok = compress2(z.data(), &zlen, j.px.data(), uLong(j.px.size()),
+                              Z_BEST_SPEED) == Z_OK;
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - c0).count();
+
+    bool wrote = false;
+    const off_t off = ok ? ftello(out) : -1;
+    if (off >= 0) {
+      hdr.clear();
+      put_magic(hdr, "VFRM");
+      put32(hdr, uint32_t(j.w)); put32(hdr, uint32_t(j.h));
+      put64(hdr, j.t_us);
+      put32(hdr, uint32_t(j.px.size())); put32(hdr, uint32_t(zlen));
+      wrote = std::fwrite(hdr.data(), 1, hdr.size(), out) == hdr.size() &&
+              std::fwrite(z.data(), 1, zlen, out) == zlen;
+      if (wrote) offsets.push_back(uint64_t(off));
+    }
+
+    std::lock_guard<std::mutex> lk(mu);
+    if (wrote) {
+      ++written;
+      raw_bytes  += j.px.size();
+      file_bytes += VDUMP_FRAME_LEN + zlen;
+      compress_ms += (ms - compress_ms) * 0.1;
+    } else {
+      ++dropped;
+    }
+    spare.push_back(std::move(j.px));
+  }
+}
+
+static std::string default_path() {
+  const std::string dir = session_state_subdir("dumps");
+  if (dir.empty()) return dir;
+  char name[64];
+  const std::time_t t = std::time(nullptr);
+  std::strftime(name, sizeof name, "/dump-%Y%m%d-%H%M%S.vdmp", std::localtime(&t));
+  return dir + name;
+}
+
+void frame_dump_start(const std::string& path) {
+  if (recording) frame_dump_stop();
+  const std::string p = path.empty() ? default_path() : path;
+  if (p.empty()) throw std::runtime_error("frame dump: no usable state directory");
+  out = std::fopen(p.c_str(), "wb");
+  if (!out) throw std::runtime_error("frame dump: cannot create " + p + ": " + std::strerror(errno));
+  std::vector<uint8_t> hdr;
+  put_magic(hdr, "VDMP");
+  put32(hdr, VDUMP_VERSION);
+  put32(hdr, VDUMP_FORMAT_RGBA);
+  std::fwrite(hdr.data(), 1, hdr.size(), out);
+
+  out_path = p;
+  offsets.clear();
+  written = dropped = 0;
+  raw_bytes = 0;
+  file_bytes = VDUMP_HEADER_LEN;
+  compress_ms = readback_us = 0.0;
+  next_slot = 0;
+  stop_worker = false;
+  t0 = std::chrono::steady_clock::now();
+  worker = std::thread(worker_main);
+  recording = true;
+  fprintf(stdout, "[dump] recording to %s\n", p.c_str());
+}
+
+// Map a finished readback into a job. With `wait` the fence is waited on
+// (stop); otherwise a slot still in flight is left for a later frame.
+static bool collect(Slot& s, bool wait) {
+  if (!s.fence) return true;
+  const GLenum r = glClientWaitSync(s.fence, 0, wait ? GLuint64(1000000000) : 0);
+  if (r == GL_TIMEOUT_EXPIRED && !wait) return false;
+  glDeleteSync(s.fence);
+  s.fence = nullptr;
+
+  std::unique_lock<std::mutex> lk(mu);
+  if (r == GL_WAIT_FAILED || r == GL_TIMEOUT_EXPIRED || queue.size() >= MAX_QUEUE) {
+    ++dropped;
+    return true;
+  }
+  Job j;
+  if (!spare.empty()) { j.px = std::move(spare.back()); spare.pop_back(); }
+  lk.unlock();
+
+  const size_t len = size_t(s.w) * s.h * 4;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+  const void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(len), GL_MAP_READ_BIT);
+  if (src) {
+    j.px.resize(len);
+    std::memcpy(j.px.data(), src, len);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  j.w = s.w; j.h = s.h; j.t_us = s.t_us;
+
+  lk.lock();
+  if (!src) { ++dropped; spare.push_back(std::move(j.px)); return true; }
+  queue.push_back(std::move(j));
+  lk.unlock();
+  cv.notify_one();
+  return true;
+}
+
+void frame_dump_capture(int w, int h) {
+  if (!recording || w <= 0 || h <= 0) return;
+  const auto c0 = std::chrono::steady_clock::now();
+
+  // Oldest first, so frames reach the file in order
+  for (int i = 0; i < RING; ++i)
+    if (!collect(slots[(next_slot + i) % RING], false)) break;
+
+  Slot& s = slots[next_slot];
+  if (s.fence) {
+    // GPU is RING frames behind: skip this frame rather than wait
+    std::lock_guard<std::mutex> lk(mu);
+    ++dropped;
+    return;
+  }
+  const size_t len = size_t(w) * h * 4;
+  if (!s.pbo) glGenBuffers(1, &s.pbo);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+  if (s.size != len) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(len), nullptr, GL_STREAM_READ);
+    s.size = len;
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  s.w = w; s.h = h;
+  s.t_us = now_us();
+  next_slot = (next_slot + 1) % RING;
+
+  const double us = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - c0).count();
+  readback_us += (us - readback_us) * 0.1;
+}
+
+void frame_dump_stop() {
+  if (!recording) return;
+  recording = false;
+  for (int i = 0; i < RING; ++i) collect(slots[(next_slot + i) % RING], true);
+  for (Slot& s : slots) {
+    if (s.pbo) glDeleteBuffers(1, &s.pbo);
+    s = Slot();
+  }
+  {
+    std::lock_guard<std::mutex> lk(mu);
+    stop_worker = true;
+  }
+  cv.notify_one();
+  worker.join();
+  spare.clear();
+
+  std::vector<uint8_t> tail;
+  const off_t idx = ftello(out);
+  put_magic(tail, "VIDX");
+  put32(tail, uint32_t(offsets.size()));
+  for (uint64_t o : offsets) put64(tail, o);
+  put64(tail, uint64_t(idx));
+  put_magic(tail, "VEND");
+  const bool ok = idx >= 0 && std::fwrite(tail.data(), 1, tail.size(), out) == tail.size();
+  if (std::fclose(out) != 0 || !ok)
+    fprintf(stderr, "[dump] %s: writing the index failed, file is unindexed\n", out_path.c_str());
+  out = nullptr;
+  file_bytes += tail.size();
+  fprintf(stdout, "[dump] %s: %ld frames, %ld dropped, %.1f MB\n", out_path.c_str(),
+          written, dropped, file_bytes / 1048576.0);
+}
+
+bool frame_dump_active() { return recording; }
+const std::string& frame_dump_path() { return out_path; }
+
+long frame_dump_written() { std::lock_guard<std::mutex> lk(mu); return written; }
+long frame_dump_dropped() { std::lock_guard<std::mutex> lk(mu); return dropped; }
+
+std::string frame_dump_stats() {
+  std::lock_guard<std::mutex> lk(mu);
+  char buf[512];
+  snprintf(buf, sizeof buf,
+           "recording=%d path=%s written=%ld dropped=%ld queued=%zu readback_us=%.0f "
+           "compress_ms=%.1f mb=%.1f ratio=%.2f",
+           recording ? 1 : 0, out_path.empty() ? "-" : out_path.c_str(), written, dropped,
+           queue.size(), readback_us, compress_ms, file_bytes / 1048576.0,
+           file_bytes ? double(raw_bytes) / double(file_bytes) : 0.0);
+  return buf;
+}
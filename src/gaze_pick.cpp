@@ -0,0 +1,144 @@
+#include "gaze_pick.hpp"
+#include "mat4.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Quad in scene space: center, half-extent axes, normal, bounds
+struct Quad {
+  int   id;
+  float c[3], ax[3], ay[3], n[3];
+  float ax_len2, ay_len2;
+  float lo[3], hi[3];
+};
+
+struct Node {
+  float lo[3], hi[3];
+  int   left = -1, right = -1;   // children, or -1 for a leaf
+  int   first = 0, count = 0;    // leaf range in quads
+};
+
+static const int LEAF_SIZE = 2;
+
+static std::vector<Quad> quads;
+static std::vector<Node> nodes;
+
+static float dot3(const float a[3], const float b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static int build_node(int first, int count) {
+  Node nd;
+  for (int k = 0; k < 3; ++k) { nd.lo[k] = 1e30f; nd.hi[k] = -1e30f; }
+  for (int i = first; i < first + count; ++i)
+    for (int k = 0; k < 3; ++k) {
+      nd.lo[k] = std::min(nd.lo[k], quads[i].lo[k]);
+      nd.hi[k] = std::max(nd.hi[k], quads[i].hi[k]);
+    }
+  const int idx = (int)nodes.size();
+  nodes.push_back(nd);
+  if (count <= LEAF_SIZE) {
+    nodes[idx].first = first;
+    nodes[idx].count = count;
+    return idx;
+  }
+
+  // Median split on the longest axis of the centers
+  float clo[3] = {1e30f, 1e30f, 1e30f}, chi[3] = {-1e30f, -1e30f, -1e30f};
+  for (int i = first; i < first + count; ++i)
+    for (int k = 0; k < 3; ++k) {
+      clo[k] = std::min(clo[k], quads[i].c[k]);
+      chi[k] = std::max(chi[k], quads[i].c[k]);
+    }
+  int axis = 0;
+  for (int k = 1; k < 3; ++k)
+    if (chi[k] - clo[k] > chi[axis] - clo[axis]) axis = k;
+  const int mid = first + count / 2;
+  std::nth_element(quads.begin() + first, quads.begin() + mid, quads.begin() + first + count,
+                   [axis](const Quad& a, const Quad& b) { return a.c[axis] < b.c[axis]; });
+
+  const int l = build_node(first, mid - first);
+  const int r = build_node(mid, first + count - mid);
+  nodes[idx].left = l;
+  nodes[idx].right = r;
+  return idx;
+}
+
+void gaze_pick_build(const std::vector<PickQuad>& in) {
+  quads.clear();
+  nodes.clear();
+  for (const PickQuad& p : in) {
+    Quad q;
+    q.id = p.id;
+    const float o[3] = {0, 0, 0}, ex[3] = {p.w / 2, 0, 0}, ey[3] = {0, p.h / 2, 0};
+    mat4_point(p.model, o, q.c);
+    mat4_dir(p.model, ex, q.ax);
+    mat4_dir(p.model, ey, q.ay);
+    q.n[0] = q.ax[1] * q.ay[2] - q.ax[2] * q.ay[1];
+    q.n[1] = q.ax[2] * q.ay[0] - q.ax[0] * q.ay[2];
+    q.n[2] = q.ax[0] * q.ay[1] - q.ax[1] * q.ay[0];
+    q.ax_len2 = dot3(q.ax, q.ax);
+    q.ay_len2 = dot3(q.ay, q.ay);
+    if (q.ax_len2 <= 0 || q.ay_len2 <= 0) continue;
+    for (int k = 0; k < 3; ++k) {
+      const float e = std::fabs(q.ax[k]) + std::fabs(q.ay[k]);
+      q.lo[k] = q.c[k] - e;
+      q.hi[k] = q.c[k] + e;
+    }
+    quads.push_back(q);
+  }
+  if (!quads.empty()) build_node(0, (int)quads.size());
+}
+
+static bool ray_box(const float o[3], const float inv[3], const float lo[3], const float hi[3],
+                    float tmax) {
+  float t0 = 0, t1 = tmax;
+  for (int k = 0; k < 3; ++k) {
+    float a = (lo[k] - o[k]) * inv[k], b = (hi[k] - o[k]) * inv[k];
+    if (a > b) std::swap(a, b);
+    t0 = std::max(t0, a);
+    t1 = std::min(t1, b);
+    if (t0 > t1) return false;
+  }
+  return true;
+}
+
+static bool ray_quad(const Quad& q, const float o[3], const float d[3], PickHit& hit) {
+  const float denom = dot3(q.n, d);
+  if (std::fabs(denom) < 1e-9f) return false;
+  const float co[3] = {q.c[0] - o[0], q.c[1] - o[1], q.c[2] - o[2]};
+  const float t = dot3(q.n, co) / denom;
+  if (t <= 0 || t >= hit.t) return false;
+  const float rel[3] = {o[0] + d[0] * t - q.c[0], o[1] + d[1] * t - q.c[1], o[2] + d[2] * t - q.c[2]};
+  const float lx = dot3(rel, q.ax) / q.ax_len2, ly = dot3(rel, q.ay) / q.ay_len2;   // [-1, 1] inside
+  if (std::fabs(lx) > 1 || std::fabs(ly) > 1) return false;
+  hit.id = q.id;
+  hit.t  = t;
+  hit.u  = 0.5f + lx / 2;
+  hit.v  = 0.5f - ly / 2;
+  return true;
+}
+
+bool gaze_pick(const float origin[3], const float dir[3], PickHit& hit) {
+  hit = PickHit{};
+  if (nodes.empty()) return false;
+  const float len = std::sqrt(dot3(dir, dir));
+  if (len <= 0) return false;
+  const float d[3] = {dir[0] / len, dir[1] / len, dir[2] / len};
+  float inv[3];
+  for (int k = 0; k < 3; ++k) inv[k] = 1.0f / (std::fabs(d[k]) > 1e-12f ? d[k] : 1e-12f);
+
+  hit.t = 1e30f;
+  int stack[64], sp = 0;
+  stack[sp++] = 0;
+  while (sp > 0) {
+    const Node& nd = nodes[stack[--sp]];
+    if (!ray_box(origin, inv, nd.lo, nd.hi, hit.t)) continue;
+    if (nd.left < 0) {
+      for (int i = nd.first; i < nd.first + nd.count; ++i) ray_quad(quads[i], origin, d, hit);
+    } else if (sp + 2 <= 64) {
+      stack[sp++] = nd.left;
+      stack[sp++] = nd.right;
+    }
+  }
+  if (hit.id < 0) { hit = PickHit{}; return false; }
+  return true;
+}
@@ -0,0 +1,60 @@
+#include "gaze_select.hpp"
+
+#include <algorithm>
+
+static double dwell_s   = 0.35;
+static double release_s = 0.15;
+
+static int    cand     = -1;
+static double acc      = 0;      // seconds on the candidate
+static double last_t   = -1;
+static double off_since = -1;    // when the gaze left the candidate, -1 while on it
+static bool   fired    = false;  // candidate already selected, waiting to be left
+
+// Longest gap between samples counted as dwell (stalls do not select)
+static const double MAX_STEP = 0.1;
+
+void   gaze_select_set_dwell(double s) { dwell_s = std::max(0.0, s); }
+double gaze_select_dwell() { return dwell_s; }
+void   gaze_select_set_release(double s) { release_s = std::max(0.0, s); }
+double gaze_select_release() { return release_s; }
+
+void gaze_select_reset() {
+  cand = -1;
+  acc = 0;
+  last_t = off_since = -1;
+  fired = false;
+}
+
+int gaze_select_feed(double t, int target) {
+  const double dt = last_t < 0 ? 0 : std::clamp(t - last_t, 0.0, MAX_STEP);
+  last_t = t;
+
+  if (cand >= 0 && target == cand) {
+    off_since = -1;
+    if (fired) return -1;
+    acc += dt;
+    if (acc < dwell_s) return -1;
+    fired = true;
+    return cand;
+  }
+
+  if (cand >= 0) {
+    if (off_since < 0) off_since = t;
+    if (t - off_since < release_s) return -1;   // brief excursion: hold the candidate
+  }
+
+  // Candidate released (or none): start over on whatever is under the gaze
+  cand = target;
+  acc = 0;
+  off_since = -1;
+  fired = false;
+  return -1;
+}
+
+int gaze_select_candidate() { return cand; }
+float gaze_select_progress() {
+  if (cand < 0) return 0.0f;
+  if (fired || dwell_s <= 0) return 1.0f;
+  return float(std::min(1.0, acc / dwell_s));
+}
@@ -0,0 +1,80 @@
+#include "governor.hpp"
+
+#include <cstdio>
+
+static double budget_us = 1e6 / 120;
+static bool   enabled   = true;
+static int    level     = GOV_FULL;
+
+static double avg_us    = 0;     // exponential moving average of the work time
+static int    over      = 0;     // consecutive frames above the high mark
+static int    under     = 0;     // consecutive frames below the low mark
+static int    cooldown  = 0;     // frames before the next decision
+static long   changes   = 0;
+static std::string last = "-";
+
+// Step down after OVER_FRAMES above HIGH * budget; step up after UNDER_FRAMES
+// below LOW * budget. Slow to recover so a level is not toggled every second.
+static const double AVG_ALPHA    = 0.1;
+static const double HIGH         = 0.9;
+static const double LOW          = 0.6;
+static const int    OVER_FRAMES  = 20;
+static const int    UNDER_FRAMES = 240;
+static const int    COOLDOWN     = 60;
+
+static const char* const NAMES[GOV_LEVELS] = {
+  "full", "background", "thumbnails", "sampling", "resolution"
+};
+
+void   governor_set_budget(double us) { budget_us = us > 0 ? us : budget_us; }
+double governor_budget() { return budget_us; }
+
+void governor_set_enabled(bool on) { enabled = on; }
+bool governor_enabled() { return enabled; }
+
+int governor_level() { return level; }
+
+const char* governor_level_name(int l) {
+  return l >= 0 && l < GOV_LEVELS ? NAMES[l] : "?";
+}
+
+static void set_level(int l, const char* why) {
+  char buf[160];
+  std::snprintf(buf, sizeof(buf), "%s->%s (%s, avg %.1f ms, budget %.1f ms)",
+                NAMES[level], NAMES[l], why, avg_us / 1000.0, budget_us / 1000.0);
+  std::fprintf(stdout, "[governor] %s\n", buf);
+  last = buf;
+  level = l;
+  ++changes;
+  over = under = 0;
+  cooldown = COOLDOWN;
+}
+
+bool governor_feed(double work_us) {
+  avg_us = avg_us <= 0 ? work_us : avg_us + (work_us - avg_us) * AVG_ALPHA;
+  const int before = level;
+
+  if (!enabled) {
+    if (level != GOV_FULL) set_level(GOV_FULL, "disabled");
+    return level != before;
+  }
+
+  over  = avg_us > HIGH * budget_us ? over + 1 : 0;
+  under = avg_us < LOW * budget_us ? under + 1 : 0;
+  if (cooldown > 0) {
+    --cooldown;
+    return false;
+  }
+  if (over >= OVER_FRAMES && level + 1 < GOV_LEVELS)
+    set_level(level + 1, "over budget");
+  else if (under >= UNDER_FRAMES && level > GOV_FULL)
+    set_level(level - 1, "headroom");
+  return level != before;
+}
+
+std::string governor_stats() {
+  char buf[320];
+  std::snprintf(buf, sizeof(buf), "level=%s avg_us=%.0f budget_us=%.0f changes=%ld last=%s",
+                NAMES[level], avg_us, budget_us, changes, last.c_str());
+  return buf;
+}
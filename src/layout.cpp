@@ -0,0 +1,344 @@
+#include "layout.hpp"
+#include "mat4.hpp"
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// ---- Config file ----
+static std::string config_dir() {
+  const char* xdg = std::getenv("XDG_CONFIG_HOME");
+  if (xdg && *xdg) return std::string(xdg) + "/viture";
+  const char* home = std::getenv("HOME");
+  if (home && *home) return std::string(home) + "/.config/viture";
+  return std::string();
+}
+
+std::string layout_config_path() {
+  std::string d = config_dir();
+  return d.empty() ? d : d + "/layout";
+}
+
+static std::string trim(const std::string& s) {
+  size_t a = s.find_first_not_of(" \t\r"), b = s.find_last_not_of(" \t\r");
+  return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+}
+
+// Comma separated numbers into out[0..n)
+static void parse_list(const std::string& v, float* out, int n) {
+  std::stringstream ss(v);
+  std::string item;
+  for (int i = 0; i < n && std::getline(ss, item, ','); ++i)
+    out[i] = std::strtof(item.c_str(), nullptr);
+}
+
+static void set_layout_key(LayoutConfig& c, const std::string& k, const std::string& v) {
+  const float f = std::strtof(v.c_str(), nullptr);
+  if (k == "mode") {
+    if (v == "ring") c.mode = LayoutMode::Ring;
+    else if (v == "grid") c.mode = LayoutMode::Grid;
+    else if (v == "wall") c.mode = LayoutMode::Wall;
+    else if (v == "free") c.mode = LayoutMode::Free;
+    else std::fprintf(stderr, "[layout] unknown mode '%s'\n", v.c_str());
+  }
+  else if (k == "width" && f > 0) c.width = f;
+  else if (k == "distance") c.distance = std::max(0.0f, f);
+  else if (k == "arc" && f > 0 && f <= 180) c.arc = f;
+  else if (k == "columns") c.columns = std::max(1, int(f));
+  else if (k == "spacing") c.spacing = std::max(0.0f, f);
+  else if (k == "thumbnails") c.thumbnails = f != 0 ? 1 : 0;
+  else std::fprintf(stderr, "[layout] ignoring '%s'\n", k.c_str());
+}
+
+static void set_panel_key(PanelSpec& p, const std::string& k, const std::string& v) {
+  const float f = std::strtof(v.c_str(), nullptr);
+  if (k == "width") p.width = std::max(0.0f, f);
+  else if (k == "src") {
+    float r[4] = {0, 0, 0, 0};
+    parse_list(v, r, 4);
+    for (int i = 0; i < 4; ++i) p.src[i] = std::max(0, int(r[i]));
+  }
+  else if (k == "tilt") p.tilt = f;
+  else if (k == "roll") p.roll = f;
+  else if (k == "yaw") p.yaw = f;
+  else if (k == "pitch") p.pitch = f;
+  else if (k == "distance") p.distance = std::max(0.0f, f);
+  else if (k == "offset") parse_list(v, p.offset, 3);
+  else if (k == "hidden") p.hidden = f != 0;
+  else if (k == "split") {
+    float r[2] = {1, 1};
+    parse_list(v, r, 2);
+    p.split_cols = std::clamp(int(r[0]), 1, 16);
+    p.split_rows = std::clamp(int(r[1]), 1, 16);
+  }
+  else std::fprintf(stderr, "[layout] ignoring '%s' in [panel %s]\n", k.c_str(), p.match.c_str());
+}
+
+bool layout_config_load(LayoutConfig& cfg) {
+  cfg = LayoutConfig{};
+  std::ifstream in(layout_config_path());
+  if (!in) return false;
+
+  std::string line, section;
+  PanelSpec* panel = nullptr;
+  while (std::getline(in, line)) {
+    size_t hash = line.find('#');
+    if (hash != std::string::npos) line.erase(hash);
+    line = trim(line);
+    if (line.empty()) continue;
+    if (line.front() == '[' && line.back() == ']') {
+      section = trim(line.substr(1, line.size() - 2));
+      panel = nullptr;
+      if (section.compare(0, 6, "panel ") == 0) {
+        cfg.panels.push_back(PanelSpec{});
+        panel = &cfg.panels.back();
+        panel->match = trim(section.substr(6));
+      }
+      continue;
+    }
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) continue;
+    const std::string k = trim(line.substr(0, eq)), v = trim(line.substr(eq + 1));
+    if (panel) set_panel_key(*panel, k, v);
+    else if (section == "layout") set_layout_key(cfg, k, v);
+  }
+  return true;
+}
+
+// ---- Hot reload ----
+static int inotify_fd = -1;
+
+bool layout_watch_init() {
+  const std::string dir = config_dir();
+  if (dir.empty()) return false;
+  // Watch the directory: editors replace the file rather than write it in place
+  ::mkdir(dir.c_str(), 0700);
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0) { perror("[layout] inotify_init1"); return false; }
+  if (inotify_add_watch(inotify_fd, dir.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM) < 0) {
+    std::fprintf(stderr, "[layout] cannot watch %s: %s\n", dir.c_str(), std::strerror(errno));
+    close(inotify_fd);
+    inotify_fd = -1;
+    return false;
+  }
+  return true;
+}
+
+bool layout_watch_poll() {
+  if (inotify_fd < 0) return false;
+  bool changed = false;
+  alignas(inotify_event) char buf[4096];
+  for (;;) {
+    ssize_t n = read(inotify_fd, buf, sizeof(buf));
+    if (n <= 0) break;
+    for (char* p = buf; p < buf + n;) {
+      auto* ev = reinterpret_cast<inotify_event*>(p);
+      // IN_CREATE alone is an empty file about to be written: wait for the close
+      if (ev->len && std::strcmp(ev->name, "layout") == 0 && !(ev->mask & IN_CREATE))
+        changed = true;
+      p += sizeof(inotify_event) + ev->len;
+    }
+  }
+  return changed;
+}
+
+void layout_watch_shutdown() {
+  if (inotify_fd >= 0) { close(inotify_fd); inotify_fd = -1; }
+}
+
+// ---- Views ----
+static bool spec_matches(const PanelSpec& p, const LayoutOutput& o, int idx) {
+  return p.match == o.name || p.match == std::to_string(idx);
+}
+
+void layout_views(const LayoutConfig& cfg, const std::vector<LayoutOutput>& outs,
+                  std::vector<LayoutView>& views) {
+  views.clear();
+  for (int i = 0; i < int(outs.size()); ++i) {
+    const LayoutOutput& o = outs[i];
+    const size_t first = views.size();
+    bool matched = false;
+    for (int k = 0; k < int(cfg.panels.size()); ++k) {
+      const PanelSpec& p = cfg.panels[k];
+      if (!spec_matches(p, o, i)) continue;
+      matched = true;
+      if (p.hidden) continue;
+      int x = 0, y = 0, w = o.width, h = o.height;
+      if (p.src[2] > 0 && p.src[3] > 0) {
+        x = std::min(p.src[0], o.width);
+        y = std::min(p.src[1], o.height);
+        w = std::min(p.src[2], o.width - x);
+        h = std::min(p.src[3], o.height - y);
+      }
+      const int cols = p.split_cols, rows = p.split_rows;
+      for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c) {
+          const int x0 = x + w * c / cols, x1 = x + w * (c + 1) / cols;
+          const int y0 = y + h * r / rows, y1 = y + h * (r + 1) / rows;
+          views.push_back(LayoutView{i, {x0, y0, x1 - x0, y1 - y0}, o.width, o.height, o.name, k});
+        }
+    }
+    if (!matched)
+      views.push_back(LayoutView{i, {0, 0, o.width, o.height}, o.width, o.height, o.name, -1});
+    // Several views of one output get numbered names for focus/session lookup
+    if (views.size() - first > 1)
+      for (size_t v = first; v < views.size(); ++v)
+        views[v].name = o.name + "#" + std::to_string(v - first);
+  }
+}
+
+// ---- Compile ----
+static const float DEFAULT_DISTANCE = 4.0f;
+static const float THUMB_Y = 1.2f, THUMB_SPACING = 0.6f, THUMB_SIZE = 0.55f;
+
+float layout_ring_radius(const LayoutConfig& cfg, float arc) {
+  if (cfg.distance > 0) return cfg.distance;
+  float pi_div_n = 3.14159265359f / (360.0f / arc);
+  return (cfg.width / 2.0f) * (std::cos(pi_div_n) / std::sin(pi_div_n));
+}
+
+static const PanelSpec* view_spec(const LayoutConfig& cfg, const LayoutView& v) {
+  return v.spec >= 0 ? &cfg.panels[v.spec] : nullptr;
+}
+
+// Panel for view `vi` at the origin: size and the UV rect of its source.
+static PanelPlacement panel_base(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                                 int vi, PanelKind kind) {
+  const LayoutView& v = views[vi];
+  const PanelSpec* s = view_spec(cfg, v);
+  PanelPlacement p{kind, vi, v.output, cfg.width, 0, 0, 0, 1, 1, {}};
+  if (v.out_w > 0 && v.out_h > 0) {
+    p.u0 = float(v.src[0]) / v.out_w;
+    p.v0 = float(v.src[1]) / v.out_h;
+    p.u1 = float(v.src[0] + v.src[2]) / v.out_w;
+    p.v1 = float(v.src[1] + v.src[3]) / v.out_h;
+  }
+  if (s && s->width > 0) p.w = s->width;
+  p.h = p.w * float(std::max(1, v.src[3])) / float(std::max(1, v.src[2]));
+  if (kind == PanelKind::Thumbnail) p.w = p.h = THUMB_SIZE;
+  mat4_identity(p.model);
+  return p;
+}
+
+// Per-panel tilt/roll about the panel center, applied last
+static void finish_panel(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                         PanelPlacement& p, std::vector<PanelPlacement>& panels) {
+  const PanelSpec* s = view_spec(cfg, views[p.view]);
+  if (s && p.kind != PanelKind::Thumbnail) {
+    if (s->tilt != 0) mat4_rotate(p.model, s->tilt, 1, 0, 0);
+    if (s->roll != 0) mat4_rotate(p.model, s->roll, 0, 0, 1);
+  }
+  panels.push_back(p);
+}
+
+static void compile_ring(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                         const RingState& ring, std::vector<PanelPlacement>& panels) {
+  const float base_z = -layout_ring_radius(cfg, ring.arc);
+  const int n = int(views.size());
+
+  // Ring (background monitors)
+  for (int i = 0; i < int(ring.focus.size()) - 1; ++i) {
+    int vi = ring.focus[i + 1];
+    if (vi < 0 || vi >= n) continue;
+    PanelPlacement p = panel_base(cfg, views, vi, PanelKind::Ring);
+    mat4_rotate(p.model, -i * ring.arc + ring.offset, 0, 1, 0);
+    mat4_translate(p.model, 0, 0, base_z);
+    finish_panel(cfg, views, p, panels);
+  }
+
+  // Foreground monitor
+  if (!ring.focus.empty() && ring.focus[0] >= 0 && ring.focus[0] < n) {
+    PanelPlacement p = panel_base(cfg, views, ring.focus[0], PanelKind::Foreground);
+    mat4_rotate(p.model, -ring.arc * (p.h / p.w), 1, 0, 0);
+    mat4_translate(p.model, 0, 0, base_z);
+    finish_panel(cfg, views, p, panels);
+  }
+}
+
+// Grid (flat) or wall (the same grid bent onto a cylinder around the center)
+static void compile_grid(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                         bool wall, std::vector<PanelPlacement>& panels) {
+  if (views.empty()) return;
+  std::vector<PanelPlacement> cells;
+  for (int i = 0; i < int(views.size()); ++i)
+    cells.push_back(panel_base(cfg, views, i, PanelKind::Placed));
+
+  float cw = 0, ch = 0;
+  for (const auto& c : cells) { cw = std::max(cw, c.w); ch = std::max(ch, c.h); }
+  const int cols = std::min(cfg.columns, int(cells.size()));
+  const int rows = (int(cells.size()) + cols - 1) / cols;
+  const float dist = cfg.distance > 0 ? cfg.distance : DEFAULT_DISTANCE;
+  const float step_x = cw + cfg.spacing, step_y = ch + cfg.spacing;
+  const float step_deg = step_x / dist * 180.0f / float(M_PI);
+
+  for (size_t k = 0; k < cells.size(); ++k) {
+    PanelPlacement& c = cells[k];
+    const float col = float(k % cols) - (cols - 1) / 2.0f;
+    const float y = ((rows - 1) / 2.0f - float(k / cols)) * step_y;
+    if (wall) {
+      mat4_rotate(c.model, -col * step_deg, 0, 1, 0);
+      mat4_translate(c.model, 0, y, -dist);
+    } else {
+      mat4_translate(c.model, col * step_x, y, -dist);
+    }
+    finish_panel(cfg, views, c, panels);
+  }
+}
+
+// Free placement from the panel sections. Slices of one section are laid out
+// side by side on an arc centered on the section's direction.
+static void compile_free(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                         std::vector<PanelPlacement>& panels) {
+  for (int i = 0; i < int(views.size()); ++i) {
+    const PanelSpec* s = view_spec(cfg, views[i]);
+    if (!s) continue;
+    PanelPlacement p = panel_base(cfg, views, i, PanelKind::Placed);
+    const float dist = s->distance > 0 ? s->distance
+                     : cfg.distance > 0 ? cfg.distance : DEFAULT_DISTANCE;
+    // Position of this view in its section's split grid
+    int first = i;
+    while (first > 0 && views[first - 1].spec == views[i].spec) --first;
+    const int k = i - first;
+    const float col = float(k % s->split_cols) - (s->split_cols - 1) / 2.0f;
+    const float row = (s->split_rows - 1) / 2.0f - float(k / s->split_cols);
+    const float step_deg = (p.w + cfg.spacing) / dist * 180.0f / float(M_PI);
+
+    mat4_translate(p.model, s->offset[0], s->offset[1], s->offset[2]);
+    mat4_rotate(p.model, -s->yaw - col * step_deg, 0, 1, 0);
+    mat4_rotate(p.model, s->pitch, 1, 0, 0);
+    mat4_translate(p.model, 0, row * (p.h + cfg.spacing), -dist);
+    finish_panel(cfg, views, p, panels);
+  }
+}
+
+void layout_compile(const LayoutConfig& cfg, const std::vector<LayoutView>& views,
+                    const RingState& ring, std::vector<PanelPlacement>& panels) {
+  panels.clear();
+  switch (cfg.mode) {
+    case LayoutMode::Ring: compile_ring(cfg, views, ring, panels); break;
+    case LayoutMode::Grid: compile_grid(cfg, views, false, panels); break;
+    case LayoutMode::Wall: compile_grid(cfg, views, true, panels); break;
+    case LayoutMode::Free: compile_free(cfg, views, panels); break;
+  }
+
+  // Thumbnails row (one per view)
+  const bool thumbs = cfg.thumbnails < 0 ? cfg.mode == LayoutMode::Ring : cfg.thumbnails != 0;
+  if (!thumbs) return;
+  const float z = cfg.mode == LayoutMode::Ring ? -layout_ring_radius(cfg, ring.arc)
+                : cfg.distance > 0 ? -cfg.distance : -DEFAULT_DISTANCE;
+  for (size_t i = 0; i < views.size(); ++i) {
+    PanelPlacement p = panel_base(cfg, views, int(i), PanelKind::Thumbnail);
+    float x = (i - (views.size() - 1) / 2.0f) * THUMB_SPACING;
+    mat4_translate(p.model, x, THUMB_Y, z);
+    panels.push_back(p);
+  }
+}
@@ -1,42 +1,92 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
 #include <unistd.h>
 #include <vector>
 
+#include "buffer_pool.hpp"
 #include "command_server.hpp"
+#include "foveation.hpp"
+#include "frame_dump.hpp"
+#include "gaze_pick.hpp"
+#include "gaze_select.hpp"
+#include "governor.hpp"
+#include "layout.hpp"
 #include "glasses.hpp"
+#include "mat4.hpp"
+#include "panel_shader.hpp"
 #include "platform.hpp"
+#include "render_check.hpp"
+#include "render_device.hpp"
+#include "render_scale.hpp"
+#include "session_state.hpp"
+#include "virtual_output.hpp"
 #include "viture.h"
 
 // multi-output capture (no xdg-output)
 #include "capture_multi.hpp"
 
+// A virtual screen: a sub-rect (x, y, width, height) of output `index`
 struct MyMonitor {
   int x, y, width, height, index;
+  std::string name;
 };
 
 static float screen_angle_offset_degrees = 0.0f;
 static bool center_dot_enabled = true;
+static bool cursor_enabled = true;
 
 static float eye_zoom_mult = 1.0f;
 static float angle_deg = 40.0f;
 
-static std::vector<MyMonitor> monitors;
+static std::vector<MyMonitor> monitors; // one per layout view
 static std::vector<MyMonitor *> focusedmonitors;
 
-// ---- Commands hooked into command_server ----
-static void on_align() {
+static LayoutConfig layout_cfg;
+static std::vector<LayoutOutput> layout_outputs; // captured outputs
+static std::vector<LayoutView> layout_views_;
+
+// Region-of-interest capture: only copy the part of each output that is on
+// screen (plus a margin for head motion) instead of the whole output.
+struct UvRect {
+  float u0 = 1, v0 = 1, u1 = 0, v1 = 0;
+  bool valid() const { return u0 < u1 && v0 < v1; }
+};
+static bool roi_enabled = false;
+static float roi_margin = 0.25f; // fraction of the visible extent, per side
+static std::vector<UvRect> roi_rects; // per output, rebuilt by render()
+
+// Frame timing, exposed through "get stats"
+struct FrameStats {
+  double capture_init_ms = 0.0; // wlr_multi_capture_init
+  double first_frame_ms = 0.0;  // process start -> first frame presented
+  long frames = 0;
+  long last_us = 0;
+  long highest_us = 0;
+  double avg_us = 0.0; // exponential moving average
+};
+static FrameStats frame_stats;
+
+// How each output was shown last frame, for the quality governor's capture
+// intervals (rebuilt by render(), the highest use of any panel wins)
+enum OutputUse { USE_HIDDEN, USE_THUMBNAIL, USE_PANEL, USE_FOCUS };
+static std::vector<int> output_use;
+
+// ---- Commands (registered with command_server, run on the render thread) ----
+static void on_align(const CmdArgs &) {
   glasses.oroll = -glasses.roll;
   glasses.opitch = -glasses.pitch;
   glasses.oyaw = -glasses.yaw;
 }
-static void on_push() {
+static void on_push(const CmdArgs &) {
   for (int i = int(focusedmonitors.size()) - 1; i >= 0; i--)
     if (i == int(focusedmonitors.size()) - 1)
       focusedmonitors.push_back(focusedmonitors[i]);
@@ -45,22 +95,368 @@ static void on_push() {
   if (!focusedmonitors.empty())
     focusedmonitors[0] = nullptr;
 }
-static void on_pop() {
+static void on_pop(const CmdArgs &) {
   for (size_t i = 0; i < focusedmonitors.size(); ++i)
     focusedmonitors[i] =
         (i + 1 < focusedmonitors.size() ? focusedmonitors[i + 1] : nullptr);
   if (!focusedmonitors.empty())
     focusedmonitors.pop_back();
 }
-static void on_zoom_in_fov() { glasses.fov *= 0.95; }
-static void on_zoom_out_fov() { glasses.fov *= 1.05; }
-static void on_zoom_in() { eye_zoom_mult += 0.05; }
-static void on_zoom_out() { eye_zoom_mult -= 0.05; }
-static void on_shift_left() { screen_angle_offset_degrees += angle_deg / 2.0f; }
-static void on_shift_right() {
-  screen_angle_offset_degrees -= angle_deg / 2.0f;
+// fov commands take an optional factor, zoom an optional step, shift an
+// optional angle in degrees.
+static void on_zoom_fov_by(const CmdArgs &a) { glasses.fov *= a.num(0); }
+static void on_fov(const CmdArgs &a) { glasses.fov = a.num(0); }
+static void on_zoom_in(const CmdArgs &a) { eye_zoom_mult += float(a.num(0)); }
+static void on_zoom_out(const CmdArgs &a) { eye_zoom_mult -= float(a.num(0)); }
+static void on_zoom(const CmdArgs &a) { eye_zoom_mult = float(a.num(0)); }
+static void on_shift_left(const CmdArgs &a) {
+  screen_angle_offset_degrees += float(a.num(0));
+}
+static void on_shift_right(const CmdArgs &a) {
+  screen_angle_offset_degrees -= float(a.num(0));
+}
+static void on_toggle_center_dot(const CmdArgs &) {
+  center_dot_enabled = !center_dot_enabled;
+}
+static void on_toggle_cursor(const CmdArgs &) { cursor_enabled = !cursor_enabled; }
+static void on_exposure(const CmdArgs &a) {
+  panel_shader_set_exposure(float(a.num(0)));
+}
+static void on_sharpness(const CmdArgs &a) {
+  panel_shader_set_sharpness(float(a.num(0)));
+}
+static void on_anisotropy(const CmdArgs &a) {
+  panel_shader_set_anisotropy(float(a.num(0)));
+}
+static void on_toggle_mips(const CmdArgs &) {
+  panel_shader_set_mips(!panel_shader_mips());
+}
+static void on_toggle_foveation(const CmdArgs &) {
+  fovea_set_enabled(!fovea_enabled());
+  std::fprintf(stdout, "[fovea] foveated rendering %s\n",
+               fovea_enabled() ? "on" : "off");
+}
+static void on_fovea_size(const CmdArgs &a) { fovea_set_size(float(a.num(0))); }
+static void on_fovea_scale(const CmdArgs &a) { fovea_set_scale(float(a.num(0))); }
+static void on_render_scale(const CmdArgs &a) {
+  rscale_set(float(a.num(0)));
+  std::fprintf(stdout, "[rscale] render scale %.2f\n", double(rscale()));
+}
+static void on_dwell(const CmdArgs &a) { gaze_select_set_dwell(a.num(0) / 1000.0); }
+static void on_dwell_release(const CmdArgs &a) {
+  gaze_select_set_release(a.num(0) / 1000.0);
+}
+static void on_toggle_governor(const CmdArgs &) {
+  governor_set_enabled(!governor_enabled());
+  std::fprintf(stdout, "[governor] %s\n", governor_enabled() ? "on" : "off");
+}
+static void on_capture_budget(const CmdArgs &a) {
+  pool_set_budget(size_t(a.num(0)) << 20);
+}
+// "record-start [path]": lossless recording of what the glasses show
+static void on_record_start(const CmdArgs &a) {
+  try {
+    frame_dump_start(a.str(0));
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[dump] %s\n", e.what());
+  }
+}
+static void on_record_stop(const CmdArgs &) { frame_dump_stop(); }
+static void on_toggle_roi(const CmdArgs &) {
+  roi_enabled = !roi_enabled;
+  std::fprintf(stdout, "[roi] region capture %s\n", roi_enabled ? "on" : "off");
+}
+
+// Headless outputs shown only in the glasses
+static const int GLASSES_HZ = 60; // panel refresh of the glasses
+static std::string focus_pending; // bring this output forward once captured
+
+// "output-create [w] [h] [hz]": 0 picks the size whose pixels map 1:1 onto the
+// glasses for a default-width panel in the foreground, and the glasses' refresh.
+static void on_output_create(const CmdArgs &a) {
+  int w = int(a.num(0)), h = int(a.num(1)), hz = int(a.num(2));
+  if (w <= 0) {
+    int fbw = 0, fbh = 0;
+    window_get_framebuffer_size(&fbw, &fbh);
+    float radius = layout_ring_radius(layout_cfg, angle_deg);
+    float flat_z = (radius - layout_cfg.width * 1.05f) * eye_zoom_mult;
+    float aspect = h > 0 ? 0.0f : 9.0f / 16.0f;
+    int mh = 0;
+    vout_match_density(layout_cfg.width, radius - flat_z, glasses.fov, fbh,
+                       aspect, w, mh);
+    if (h <= 0)
+      h = mh;
+  } else if (h <= 0) {
+    h = (w * 9 / 16 + 7) / 8 * 8;
+  }
+  if (hz <= 0)
+    hz = GLASSES_HZ;
+  std::string err;
+  std::string name = vout_create(w, h, hz, err);
+  if (name.empty())
+    std::fprintf(stderr, "[vout] output-create failed: %s\n", err.c_str());
+  else
+    focus_pending = name;
+}
+static void on_output_destroy(const CmdArgs &a) {
+  std::string err;
+  if (!vout_destroy(a.str(0), err))
+    std::fprintf(stderr, "[vout] output-destroy %s: %s\n", a.str(0).c_str(),
+                 err.c_str());
+}
+
+// "window-add <app_id|identifier|title part>": capture one window as its own panel
+static void on_window_add(const CmdArgs &a) {
+  if (!wlr_multi_windows_supported()) {
+    std::fprintf(stderr, "[capture] window capture not supported here\n");
+    return;
+  }
+  std::string name = wlr_multi_add_window(a.str(0));
+  if (name.empty())
+    std::fprintf(stderr, "[capture] no window matches '%s'\n", a.str(0).c_str());
+  else
+    focus_pending = name;
+}
+static void on_window_remove(const CmdArgs &a) {
+  if (!wlr_multi_remove_window(a.str(0)))
+    std::fprintf(stderr, "[capture] no window source '%s'\n", a.str(0).c_str());
+}
+
+// ---- Queries ("get <key>") ----
+static std::string fmt(const char *f, ...) __attribute__((format(printf, 1, 2)));
+static std::string fmt(const char *f, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, f);
+  std::vsnprintf(buf, sizeof(buf), f, ap);
+  va_end(ap);
+  return buf;
+}
+
+static std::string focus_string() {
+  std::string s;
+  for (size_t i = 0; i < focusedmonitors.size(); ++i) {
+    if (i)
+      s += ',';
+    s += focusedmonitors[i]
+             ? std::to_string(focusedmonitors[i] - monitors.data())
+             : "-";
+  }
+  return s.empty() ? "-" : s;
+}
+
+static std::string state_string() {
+  return fmt("fov=%.3f zoom=%.3f angle-offset=%.2f center-dot=%d roi=%d ",
+             double(glasses.fov), double(eye_zoom_mult),
+             double(screen_angle_offset_degrees), center_dot_enabled ? 1 : 0,
+             roi_enabled ? 1 : 0) +
+         "focus=" + focus_string();
+}
+
+static std::string gaze_string();
+
+static void register_commands() {
+  cmdsrv_register("align", {}, on_align);
+  cmdsrv_register("push", {}, on_push);
+  cmdsrv_register("pop", {}, on_pop);
+  cmdsrv_register("zoom-in-fov", {cmd_opt_num(0.95, 0.01, 1.0)}, on_zoom_fov_by);
+  cmdsrv_register("zoom-out-fov", {cmd_opt_num(1.05, 1.0, 100.0)}, on_zoom_fov_by);
+  cmdsrv_register("fov", {cmd_num(1.0, 170.0)}, on_fov);
+  cmdsrv_register("zoom-in", {cmd_opt_num(0.05, 0.0, 100.0)}, on_zoom_in);
+  cmdsrv_register("zoom-out", {cmd_opt_num(0.05, 0.0, 100.0)}, on_zoom_out);
+  cmdsrv_register("zoom", {cmd_num(-100.0, 100.0)}, on_zoom);
+  cmdsrv_register("shift-left", {cmd_opt_num(angle_deg / 2.0, -360.0, 360.0)},
+                  on_shift_left);
+  cmdsrv_register("shift-right", {cmd_opt_num(angle_deg / 2.0, -360.0, 360.0)},
+                  on_shift_right);
+  cmdsrv_register("toggle-center-dot", {}, on_toggle_center_dot);
+  cmdsrv_register("toggle-cursor", {}, on_toggle_cursor);
+  cmdsrv_register("toggle-roi", {}, on_toggle_roi);
+  cmdsrv_register("exposure", {cmd_num(0.01, 100.0)}, on_exposure);
+  cmdsrv_register("sharpness", {cmd_num(0.0, 1.0)}, on_sharpness);
+  cmdsrv_register("anisotropy", {cmd_num(1.0, 16.0)}, on_anisotropy);
+  cmdsrv_register("toggle-mips", {}, on_toggle_mips);
+  cmdsrv_register("toggle-foveation", {}, on_toggle_foveation);
+  cmdsrv_register("toggle-governor", {}, on_toggle_governor);
+  cmdsrv_register("dwell", {cmd_num(0.0, 10000.0)}, on_dwell);
+  cmdsrv_register("dwell-release", {cmd_num(0.0, 10000.0)}, on_dwell_release);
+  cmdsrv_register("fovea-size", {cmd_num(0.1, 1.0)}, on_fovea_size);
+  cmdsrv_register("fovea-scale", {cmd_num(0.25, 1.0)}, on_fovea_scale);
+  cmdsrv_register("render-scale", {cmd_num(0.5, 2.0)}, on_render_scale);
+  cmdsrv_register("capture-budget", {cmd_num(16.0, 65536.0)}, on_capture_budget);
+  cmdsrv_register("record-start", {cmd_opt_str()}, on_record_start);
+  cmdsrv_register("record-stop", {}, on_record_stop);
+  cmdsrv_register("output-create",
+                  {cmd_opt_num(0, 0, 7680), cmd_opt_num(0, 0, 4320),
+                   cmd_opt_num(0, 0, 240)},
+                  on_output_create);
+  cmdsrv_register("output-destroy", {cmd_str()}, on_output_destroy);
+  cmdsrv_register("window-add", {cmd_str()}, on_window_add);
+  cmdsrv_register("window-remove", {cmd_str()}, on_window_remove);
+
+  cmdsrv_register_query("fov", [] { return fmt("%.3f", double(glasses.fov)); });
+  cmdsrv_register_query("zoom", [] { return fmt("%.3f", double(eye_zoom_mult)); });
+  cmdsrv_register_query("angle-offset", [] {
+    return fmt("%.2f", double(screen_angle_offset_degrees));
+  });
+  cmdsrv_register_query("center-dot", [] {
+    return std::string(center_dot_enabled ? "1" : "0");
+  });
+  cmdsrv_register_query("roi", [] { return std::string(roi_enabled ? "1" : "0"); });
+  cmdsrv_register_query("cursor", [] {
+    return std::string(cursor_enabled ? "1" : "0");
+  });
+  cmdsrv_register_query("exposure", [] {
+    return fmt("%.3f", double(panel_shader_exposure()));
+  });
+  cmdsrv_register_query("sharpness", [] {
+    return fmt("%.2f", double(panel_shader_sharpness()));
+  });
+  cmdsrv_register_query("anisotropy", [] {
+    return fmt("%.0f", double(panel_shader_anisotropy()));
+  });
+  cmdsrv_register_query("mips", [] {
+    return std::string(panel_shader_mips() ? "1" : "0");
+  });
+  cmdsrv_register_query("foveation", [] {
+    return fmt("%d size=%.2f scale=%.2f", fovea_enabled() ? 1 : 0,
+               double(fovea_size()), double(fovea_scale()));
+  });
+  cmdsrv_register_query("render-scale", [] {
+    return fmt("%.2f effective=%.2f", double(rscale()),
+               double(rscale_effective()));
+  });
+  cmdsrv_register_query("align", [] {
+    return fmt("roll=%.2f pitch=%.2f yaw=%.2f", double(glasses.oroll),
+               double(glasses.opitch), double(glasses.oyaw));
+  });
+  cmdsrv_register_query("focus", focus_string);
+  cmdsrv_register_query("gaze", gaze_string);
+  cmdsrv_register_query("dwell", [] {
+    return fmt("dwell_ms=%.0f release_ms=%.0f candidate=%d progress=%.2f",
+               gaze_select_dwell() * 1000.0, gaze_select_release() * 1000.0,
+               gaze_select_candidate(), double(gaze_select_progress()));
+  });
+  cmdsrv_register_query("platform", [] { return std::string(platform_name()); });
+  cmdsrv_register_query("outputs", [] {
+    return std::to_string(layout_outputs.size());
+  });
+  cmdsrv_register_query("virtual-outputs", [] {
+    std::string s;
+    for (const std::string &n : vout_list())
+      s += (s.empty() ? "" : ",") + n;
+    return s.empty() ? std::string("-") : s;
+  });
+  cmdsrv_register_query("windows", [] {
+    std::string s;
+    for (const CaptureWindow &w : wlr_multi_windows())
+      s += (s.empty() ? "" : ";") + w.id + ":" + w.app_id + ":" + w.title;
+    return s.empty() ? std::string("-") : s;
+  });
+  cmdsrv_register_query("views", [] {
+    std::string s;
+    for (const MyMonitor &m : monitors)
+      s += (s.empty() ? "" : ",") + m.name;
+    return s.empty() ? std::string("-") : s;
+  });
+  cmdsrv_register_query("stats", [] {
+    return fmt("frames=%ld last_us=%ld avg_us=%.0f highest_us=%ld "
+               "capture_init_ms=%.1f first_frame_ms=%.1f capture_wait_us=%ld "
+               "governor=%s render_node=%s capture_mb=%.1f "
+               "record_written=%ld record_dropped=%ld",
+               frame_stats.frames, frame_stats.last_us, frame_stats.avg_us,
+               frame_stats.highest_us, frame_stats.capture_init_ms,
+               frame_stats.first_frame_ms, wlr_multi_last_wait_us(),
+               governor_level_name(governor_level()),
+               *render_device_path() ? render_device_path() : "-",
+               pool_total() / 1048576.0, frame_dump_written(),
+               frame_dump_dropped());
+  });
+  cmdsrv_register_query("capture-memory", pool_stats);
+  cmdsrv_register_query("record", frame_dump_stats);
+  cmdsrv_register_query("governor", [] {
+    return fmt("%d %s", governor_enabled() ? 1 : 0, governor_stats().c_str());
+  });
+  cmdsrv_register_query("state", state_string);
+}
+
+// ---- Session persistence ----
+// State is snapshotted per set of outputs and saved once it has been stable for
+// SAVE_DEBOUNCE, so keybind spam produces one write instead of dozens.
+static std::string session_key;
+static std::string saved_state;   // persist_string() at the last save
+static std::string pending_state; // changed state waiting to settle
+static std::chrono::steady_clock::time_point pending_since, last_check;
+static const std::chrono::milliseconds SAVE_CHECK_INTERVAL(250);
+static const std::chrono::milliseconds SAVE_DEBOUNCE(1000);
+
+static std::string persist_string() {
+  return state_string() + fmt(" align=%.3f,%.3f,%.3f", double(glasses.oroll),
+                              double(glasses.opitch), double(glasses.oyaw));
+}
+
+static SessionState snapshot_session() {
+  SessionState st;
+  st.fov = glasses.fov;
+  st.zoom = eye_zoom_mult;
+  st.angle_offset = screen_angle_offset_degrees;
+  st.center_dot = center_dot_enabled;
+  st.roi = roi_enabled;
+  st.oroll = glasses.oroll;
+  st.opitch = glasses.opitch;
+  st.oyaw = glasses.oyaw;
+  for (const MyMonitor *m : focusedmonitors)
+    st.focus.push_back(m ? m->name : "-");
+  return st;
+}
+
+static void apply_session(const SessionState &st) {
+  glasses.fov = st.fov;
+  eye_zoom_mult = st.zoom;
+  screen_angle_offset_degrees = st.angle_offset;
+  center_dot_enabled = st.center_dot;
+  roi_enabled = st.roi;
+  glasses.oroll = st.oroll;
+  glasses.opitch = st.opitch;
+  glasses.oyaw = st.oyaw;
+
+  std::vector<MyMonitor *> focus;
+  for (const std::string &name : st.focus) {
+    if (name == "-") {
+      focus.push_back(nullptr);
+      continue;
+    }
+    for (MyMonitor &m : monitors)
+      if (m.name == name) {
+        focus.push_back(&m);
+        break;
+      }
+  }
+  if (!focus.empty())
+    focusedmonitors = focus;
+}
+
+static void session_tick(bool force) {
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - last_check < SAVE_CHECK_INTERVAL)
+    return;
+  last_check = now;
+
+  std::string st = persist_string();
+  if (st == saved_state) {
+    pending_state.clear();
+    return;
+  }
+  if (st != pending_state) {
+    pending_state = st;
+    pending_since = now;
+  }
+  if (force || now - pending_since >= SAVE_DEBOUNCE) {
+    if (session_save(session_key, snapshot_session()))
+      saved_state = st;
+    pending_state.clear();
+  }
 }
-static void on_toggle_center_dot() { center_dot_enabled = !center_dot_enabled; }
 
 // ---- Tiny helpers ----
 static void draw_filled_center_rect(float half_w, float half_h) {
@@ -96,9 +492,10 @@ static void draw_filled_center_rect(float half_w, float half_h) {
   glEnable(GL_TEXTURE_2D);
 }
 
-static void getLookVector(float &dx, float &dy, float &dz) {
-  float pitchRad = get_pitch(glasses) * M_PI / 180.0;
-  float yawRad = get_yaw(glasses) * M_PI / 180.0;
+static void getLookVector(float pitch, float yaw, float &dx, float &dy,
+                          float &dz) {
+  float pitchRad = pitch * M_PI / 180.0;
+  float yawRad = yaw * M_PI / 180.0;
   dx = std::sin(yawRad) * -std::cos(pitchRad);
   dy = -std::sin(pitchRad);
   dz = -std::cos(yawRad) * std::cos(pitchRad);
@@ -115,70 +512,372 @@ static bool initGL() {
   glLoadIdentity();
   gluPerspective(60.0, w > 0 ? double(w) / double(h) : 16.0 / 9.0, 0.1, 1000.0);
   glMatrixMode(GL_MODELVIEW);
+  if (!panel_shader_init())
+    fprintf(stderr, "[gl] panel shader unavailable, HDR outputs not tone-mapped\n");
   return true;
 }
 
-static void getMonitorUVs(const MyMonitor &m, int fbW, int fbH, float &u0,
-                          float &v0, float &u1, float &v1) {
-  // u0 = float(m.x) / fbW;
-  // v0 = float(m.y) / fbH;
-  // u1 = float(m.x + m.width) / fbW;
-  // v1 = float(m.y + m.height) / fbH;
-  u0 = 0.0f;
-  v0 = 0.0f;
-  u1 = 1.0f;
-  v1 = 1.0f;
+// We treat each output as a separate texture; when drawing quads we bind the
+// needed texture. [u0,u1]x[v0,v1] is the part of the output shown on the
+// panel; only the portion actually held in the texture (src rect) is drawn.
+static void drawOutputQuad(const CapturedOutput &o, float u0, float v0,
+                           float u1, float v1, float w, float h) {
+  float cu0 = 0, cv0 = 0, cu1 = 1, cv1 = 1;
+  if (o.src_w > 0 && o.src_h > 0 && o.width > 0 && o.height > 0) {
+    cu0 = float(o.src_x) / o.width;
+    cv0 = float(o.src_y) / o.height;
+    cu1 = float(o.src_x + o.src_w) / o.width;
+    cv1 = float(o.src_y + o.src_h) / o.height;
+  }
+  float a0 = std::max(u0, cu0), a1 = std::min(u1, cu1);
+  float b0 = std::max(v0, cv0), b1 = std::min(v1, cv1);
+  if (a0 >= a1 || b0 >= b1)
+    return;
+
+  float x0 = -w / 2 + (a0 - u0) / (u1 - u0) * w;
+  float x1 = -w / 2 + (a1 - u0) / (u1 - u0) * w;
+  float y0 = h / 2 - (b0 - v0) / (v1 - v0) * h;
+  float y1 = h / 2 - (b1 - v0) / (v1 - v0) * h;
+  float s0 = (a0 - cu0) / (cu1 - cu0), s1 = (a1 - cu0) / (cu1 - cu0);
+  float t0 = (b0 - cv0) / (cv1 - cv0), t1 = (b1 - cv0) / (cv1 - cv0);
+
+  glBindTexture(GL_TEXTURE_2D, o.texture);
+  panel_shader_begin(o);
+  glBegin(GL_QUADS);
+  glTexCoord2f(s0, t0);
+  glVertex3f(x0, y0, 0);
+  glTexCoord2f(s1, t0);
+  glVertex3f(x1, y0, 0);
+  glTexCoord2f(s1, t1);
+  glVertex3f(x1, y1, 0);
+  glTexCoord2f(s0, t1);
+  glVertex3f(x0, y1, 0);
+  glEnd();
+  panel_shader_end();
 }
 
-// We treat each output as a separate texture; when drawing quads we bind the
-// needed texture.
-static void drawTexturedQuad(GLuint tex, float u0, float v0, float u1, float v1,
-                             float w, float h) {
-  glBindTexture(GL_TEXTURE_2D, tex);
+// Pointer of `o` as a small quad over the panel drawn by drawOutputQuad with
+// the same arguments, clipped to the panel's UV rect. Pulled forward with a
+// polygon offset so it wins the depth test against its own panel.
+static void drawCursorQuad(const CapturedOutput &o, float u0, float v0,
+                           float u1, float v1, float w, float h) {
+  if (!o.cursor_visible || !o.cursor_tex || o.width <= 0 || o.height <= 0)
+    return;
+  float cu0 = float(o.cursor_x) / o.width;
+  float cv0 = float(o.cursor_y) / o.height;
+  float cu1 = float(o.cursor_x + o.cursor_w) / o.width;
+  float cv1 = float(o.cursor_y + o.cursor_h) / o.height;
+  float a0 = std::max(u0, cu0), a1 = std::min(u1, cu1);
+  float b0 = std::max(v0, cv0), b1 = std::min(v1, cv1);
+  if (a0 >= a1 || b0 >= b1)
+    return;
+
+  float x0 = -w / 2 + (a0 - u0) / (u1 - u0) * w;
+  float x1 = -w / 2 + (a1 - u0) / (u1 - u0) * w;
+  float y0 = h / 2 - (b0 - v0) / (v1 - v0) * h;
+  float y1 = h / 2 - (b1 - v0) / (v1 - v0) * h;
+  float s0 = (a0 - cu0) / (cu1 - cu0), s1 = (a1 - cu0) / (cu1 - cu0);
+  float t0 = (b0 - cv0) / (cv1 - cv0), t1 = (b1 - cv0) / (cv1 - cv0);
+
+  glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_BIT);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // cursor images are premultiplied
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(-1.0f, -1.0f);
+  glBindTexture(GL_TEXTURE_2D, o.cursor_tex);
+  glColor4f(1, 1, 1, 1);
   glBegin(GL_QUADS);
-  glTexCoord2f(u0, v0);
-  glVertex3f(-w / 2, h / 2, 0);
-  glTexCoord2f(u1, v0);
-  glVertex3f(w / 2, h / 2, 0);
-  glTexCoord2f(u1, v1);
-  glVertex3f(w / 2, -h / 2, 0);
-  glTexCoord2f(u0, v1);
-  glVertex3f(-w / 2, -h / 2, 0);
+  glTexCoord2f(s0, t0);
+  glVertex3f(x0, y0, 0);
+  glTexCoord2f(s1, t0);
+  glVertex3f(x1, y0, 0);
+  glTexCoord2f(s1, t1);
+  glVertex3f(x1, y1, 0);
+  glTexCoord2f(s0, t1);
+  glVertex3f(x0, y1, 0);
   glEnd();
+  glPopAttrib();
+}
+
+// Part of the current panel (w x h quad at z=0 under the current modelview)
+// that falls inside the viewport, in panel UV with roi_margin padding.
+static bool panelVisibleUV(float w, float h, UvRect &r) {
+  GLdouble mv[16], pj[16];
+  GLint vp[4];
+  glGetDoublev(GL_MODELVIEW_MATRIX, mv);
+  glGetDoublev(GL_PROJECTION_MATRIX, pj);
+  glGetIntegerv(GL_VIEWPORT, vp);
+
+  // Cast the four viewport corner rays onto the panel plane
+  const double cx[4] = {double(vp[0]), double(vp[0] + vp[2]),
+                        double(vp[0] + vp[2]), double(vp[0])};
+  const double cy[4] = {double(vp[1]), double(vp[1]), double(vp[1] + vp[3]),
+                        double(vp[1] + vp[3])};
+  double minx = 1e30, miny = 1e30, maxx = -1e30, maxy = -1e30;
+  bool all_hit = true;
+  for (int k = 0; k < 4 && all_hit; ++k) {
+    GLdouble nx, ny, nz, fx, fy, fz;
+    gluUnProject(cx[k], cy[k], 0.0, mv, pj, vp, &nx, &ny, &nz);
+    gluUnProject(cx[k], cy[k], 1.0, mv, pj, vp, &fx, &fy, &fz);
+    double dz = fz - nz;
+    double t = std::fabs(dz) > 1e-9 ? -nz / dz : -1.0;
+    if (t < 0) {
+      all_hit = false;
+      break;
+    }
+    double ix = nx + (fx - nx) * t, iy = ny + (fy - ny) * t;
+    minx = std::min(minx, ix);
+    maxx = std::max(maxx, ix);
+    miny = std::min(miny, iy);
+    maxy = std::max(maxy, iy);
+  }
+
+  if (!all_hit) {
+    // Frustum is not bounded by the panel plane (grazing angle): keep the
+    // whole panel unless all of its corners are clipped on the same side.
+    int out[6] = {0, 0, 0, 0, 0, 0};
+    const float px[4] = {-w / 2, w / 2, w / 2, -w / 2};
+    const float py[4] = {h / 2, h / 2, -h / 2, -h / 2};
+    for (int k = 0; k < 4; ++k) {
+      double e[4], c[4];
+      for (int i = 0; i < 4; ++i)
+        e[i] = mv[i] * px[k] + mv[4 + i] * py[k] + mv[12 + i];
+      for (int i = 0; i < 4; ++i)
+        c[i] = pj[i] * e[0] + pj[4 + i] * e[1] + pj[8 + i] * e[2] +
+               pj[12 + i] * e[3];
+      out[0] += c[0] < -c[3];
+      out[1] += c[0] > c[3];
+      out[2] += c[1] < -c[3];
+      out[3] += c[1] > c[3];
+      out[4] += c[2] < -c[3];
+      out[5] += c[2] > c[3];
+    }
+    for (int i = 0; i < 6; ++i)
+      if (out[i] == 4)
+        return false;
+    r = UvRect{0, 0, 1, 1};
+    return true;
+  }
+
+  float u0 = float(minx / w + 0.5), u1 = float(maxx / w + 0.5);
+  float v0 = float(0.5 - maxy / h), v1 = float(0.5 - miny / h);
+  float mu = (u1 - u0) * roi_margin, mvv = (v1 - v0) * roi_margin;
+  r.u0 = std::max(0.0f, u0 - mu);
+  r.u1 = std::min(1.0f, u1 + mu);
+  r.v0 = std::max(0.0f, v0 - mvv);
+  r.v1 = std::min(1.0f, v1 + mvv);
+  return r.valid();
+}
+
+// Grow output idx's region of interest by the visible part of the current
+// panel, which shows [u0,u1]x[v0,v1] of that output.
+static void accumulateROI(int idx, float u0, float v0, float u1, float v1,
+                          float w, float h) {
+  if (!roi_enabled || idx < 0 || idx >= (int)roi_rects.size())
+    return;
+  UvRect p;
+  if (!panelVisibleUV(w, h, p))
+    return;
+  UvRect &r = roi_rects[idx];
+  r.u0 = std::min(r.u0, u0 + p.u0 * (u1 - u0));
+  r.u1 = std::max(r.u1, u0 + p.u1 * (u1 - u0));
+  r.v0 = std::min(r.v0, v0 + p.v0 * (v1 - v0));
+  r.v1 = std::max(r.v1, v0 + p.v1 * (v1 - v0));
+}
+
+// Hand this frame's visible rects to the capture for the next frame. Outputs
+// that are not on any panel (thumbnail only) keep whole-output capture.
+static void updateROI(const std::vector<CapturedOutput> &outs) {
+  for (size_t i = 0; i < outs.size(); ++i) {
+    if (!roi_enabled || i >= roi_rects.size() || !roi_rects[i].valid()) {
+      wlr_multi_set_region(i, 0, 0, 0, 0);
+      continue;
+    }
+    const UvRect &r = roi_rects[i];
+    int x0 = int(std::floor(r.u0 * outs[i].width));
+    int y0 = int(std::floor(r.v0 * outs[i].height));
+    int x1 = int(std::ceil(r.u1 * outs[i].width));
+    int y1 = int(std::ceil(r.v1 * outs[i].height));
+    wlr_multi_set_region(i, x0, y0, x1 - x0, y1 - y0);
+  }
 }
 
-int focusIndex = 0;
-int focusCandidate = -1;
-int focusFrames = 0;
-const int FOCUS_HOLD_FRAMES = 20;
-static bool isLookingAt(float eyeX, float eyeY, float eyeZ, float rayX,
-                        float rayY, float rayZ, float centerX, float centerY,
-                        float centerZ, float width, float height) {
-  // Avoid division by zero for ray parallel to plane
-  if (fabs(rayZ) < 1e-5) {
-    return false;
+// ---- Layout ----
+// Panel transforms are compiled from the layout config once per change and
+// shared by drawing and gaze picking.
+static std::vector<PanelPlacement> panels;
+
+struct LayoutKey {
+  float angle = 0, offset = 0;
+  std::vector<const MyMonitor *> focus;
+  size_t mons = 0;
+  bool operator==(const LayoutKey &o) const {
+    return angle == o.angle && offset == o.offset && focus == o.focus &&
+           mons == o.mons;
   }
+};
+static LayoutKey layout_key;
+static bool layout_valid = false;
+
+// The arc is also a runtime setting (shift commands, the saved session): a
+// reload only overrides it when the file's value changed.
+static void load_layout_config(bool initial) {
+  const float prev_arc = layout_cfg.arc;
+  if (layout_config_load(layout_cfg))
+    std::fprintf(stdout, "[layout] loaded %s\n", layout_config_path().c_str());
+  if (initial || layout_cfg.arc != prev_arc)
+    angle_deg = layout_cfg.arc;
+  layout_valid = false;
+}
+
+// Rebuild the virtual screens (one per output or output slice), keeping the
+// focus stack by name.
+static void rebuild_views() {
+  std::vector<std::string> focus;
+  for (const MyMonitor *m : focusedmonitors)
+    focus.push_back(m ? m->name : "-");
+
+  layout_views(layout_cfg, layout_outputs, layout_views_);
+  monitors.clear();
+  for (const LayoutView &v : layout_views_)
+    monitors.push_back(
+        MyMonitor{v.src[0], v.src[1], v.src[2], v.src[3], v.output, v.name});
+
+  focusedmonitors.clear();
+  for (const std::string &name : focus) {
+    if (name == "-") {
+      focusedmonitors.push_back(nullptr);
+      continue;
+    }
+    for (MyMonitor &m : monitors)
+      if (m.name == name) {
+        focusedmonitors.push_back(&m);
+        break;
+      }
+  }
+  bool any = false;
+  for (const MyMonitor *m : focusedmonitors)
+    any |= m != nullptr;
+  if (!any) {
+    // Nothing to keep: front view first, the rest around the ring
+    focusedmonitors.clear();
+    for (size_t i = 0; i < monitors.size() && i < 7; ++i)
+      focusedmonitors.push_back(&monitors[i]);
+  }
+  layout_valid = false;
+  // View indices changed: a pending dwell could commit to another view
+  gaze_select_reset();
+}
+
+static void rebuild_layout() {
+  RingState ring;
+  ring.arc = angle_deg;
+  ring.offset = screen_angle_offset_degrees;
+  for (const MyMonitor *m : focusedmonitors)
+    ring.focus.push_back(m ? int(m - monitors.data()) : -1);
+  layout_compile(layout_cfg, layout_views_, ring, panels);
+
+  std::vector<PickQuad> quads;
+  quads.reserve(panels.size());
+  for (size_t i = 0; i < panels.size(); ++i) {
+    PickQuad q{int(i), {}, panels[i].w, panels[i].h};
+    std::memcpy(q.model, panels[i].model, sizeof(q.model));
+    quads.push_back(q);
+  }
+  gaze_pick_build(quads);
+}
+
+static void update_layout(const std::vector<MyMonitor> &mons) {
+  while (focusedmonitors.size() > 7)
+    focusedmonitors.pop_back();
+  LayoutKey k{angle_deg, screen_angle_offset_degrees,
+              std::vector<const MyMonitor *>(focusedmonitors.begin(),
+                                             focusedmonitors.end()),
+              mons.size()};
+  if (layout_valid && k == layout_key)
+    return;
+  layout_key = std::move(k);
+  layout_valid = true;
+  rebuild_layout();
+}
+
+// Eye position and look direction in scene space (before the head roll).
+static void view_ray(float pitch, float yaw, float eye[3], float dir[3]) {
+  getLookVector(pitch, yaw, dir[0], dir[1], dir[2]);
+  float flat_z =
+      (layout_ring_radius(layout_cfg, angle_deg) - layout_cfg.width * 1.05f) *
+      eye_zoom_mult;
+  eye[0] = 0;
+  eye[1] = 0;
+  eye[2] = -flat_z;
+}
+
+// ---- Gaze ----
+static PickHit gaze_hit; // last pick, id indexes panels
 
-  // Calculate intersection parameter t for plane Z = centerZ
-  float t = (centerZ - eyeZ) / rayZ;
+static uint64_t imu_cursor = 0; // IMU reports consumed by the gaze stage
 
-  // Intersection must be in front of the eye
-  if (t < 0) {
-    return false;
+// Pick the panel under the gaze for one head pose (offsets applied).
+static void pick_gaze(float roll, float pitch, float yaw, PickHit &hit) {
+  float eye[3], dir[3];
+  view_ray(pitch, yaw, eye, dir);
+  // The scene is rolled about the view axis; undo it for the ray
+  float unroll[16], o[3], d[3];
+  mat4_identity(unroll);
+  mat4_rotate(unroll, -roll, 0, 0, 1);
+  mat4_point(unroll, eye, o);
+  mat4_dir(unroll, dir, d);
+  gaze_pick(o, d, hit);
+}
+
+static void focus_monitor(int i) {
+  if (focusedmonitors.size() == 0) {
+    focusedmonitors.push_back(&monitors[i]);
+  } else {
+    focusedmonitors[0] = &monitors[i];
   }
+}
 
-  // Calculate intersection point coordinates
-  float ix = eyeX + rayX * t;
-  float iy = eyeY + rayY * t;
+// Gaze stage, run once per loop iteration outside render(). Every IMU report
+// since the last run is picked and fed to the dwell selector with its arrival
+// time, so dwell does not depend on the frame rate. Dwelling on a thumbnail
+// brings its output to the foreground.
+static void update_gaze(const std::vector<MyMonitor> &mons) {
+  ImuSample s[IMU_RING];
+  size_t n = imu_drain(imu_cursor, s);
+  if (n == 0) // no new report: sample the current pose
+    s[n++] = ImuSample{imu_clock(), glasses.roll, glasses.pitch, glasses.yaw};
 
-  // Check if intersection lies within quad bounds
-  return (ix >= centerX - width / 2 && ix <= centerX + width / 2 &&
-          iy >= centerY - height / 2 && iy <= centerY + height / 2);
+  for (size_t k = 0; k < n; ++k) {
+    pick_gaze(s[k].roll + glasses.oroll, s[k].pitch + glasses.opitch,
+              s[k].yaw + glasses.oyaw, gaze_hit);
+    int target = -1;
+    if (gaze_hit.id >= 0 && panels[gaze_hit.id].kind == PanelKind::Thumbnail)
+      target = panels[gaze_hit.id].view;
+    int sel = gaze_select_feed(s[k].t, target);
+    if (sel >= 0) {
+      focus_monitor(sel);
+      update_layout(mons);
+    }
+  }
 }
 
-static void render(const std::vector<CapturedOutput> &outs,
-                   const std::vector<MyMonitor> &mons, int fbW, int fbH) {
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// "<kind> <view> <output name> u=<u> v=<v>" of the panel under the gaze, with
+// u/v in output UV, or "none"
+static std::string gaze_string() {
+  if (gaze_hit.id < 0 || gaze_hit.id >= int(panels.size()))
+    return "none";
+  const PanelPlacement &p = panels[gaze_hit.id];
+  static const char *kinds[] = {"ring", "foreground", "thumbnail", "panel"};
+  return fmt("%s %d %s u=%.4f v=%.4f", kinds[int(p.kind)], p.view,
+             monitors[p.view].name.c_str(),
+             double(p.u0 + gaze_hit.u * (p.u1 - p.u0)),
+             double(p.v0 + gaze_hit.v * (p.v1 - p.v0)));
+}
+
+// One pass over the scene into the current viewport. Only the primary pass
+// (full resolution) updates ROI state and draws the center dot.
+static void draw_scene(const std::vector<CapturedOutput> &outs, bool primary) {
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_TEXTURE_2D);
 
@@ -191,130 +890,207 @@ static void render(const std::vector<CapturedOutput> &outs,
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
 
-  float roll = get_roll(glasses);
-  float roll_perc = 0.0f;
-  float focused_w = 3.0f;
-  float n = 360.0f / angle_deg;
-  float pi_div_n = 3.14159265359f / n;
-  float r = (focused_w / 2.0f) * (std::cos(pi_div_n) / std::sin(pi_div_n));
-  float base_z = (-r + roll_perc);
-
-  float rayX, rayY, rayZ;
-  getLookVector(rayX, rayY, rayZ);
-  float flat_z = (r - focused_w * 1.05f) * eye_zoom_mult;
-  float eyeX = rayX * roll_perc, eyeY = rayY * roll_perc,
-        eyeZ = rayZ * roll_perc - flat_z;
-  float tx = eyeX + rayX, ty = eyeY + rayY, tz = eyeZ + rayZ;
-  gluLookAt(eyeX, eyeY, eyeZ, tx, ty, tz, 0, 1, 0);
-  glRotatef(roll, 0, 0, 1);
+  float eye[3], ray[3];
+  view_ray(get_pitch(glasses), get_yaw(glasses), eye, ray);
+  gluLookAt(eye[0], eye[1], eye[2], eye[0] + ray[0], eye[1] + ray[1],
+            eye[2] + ray[2], 0, 1, 0);
+  glRotatef(get_roll(glasses), 0, 0, 1);
 
-  while (focusedmonitors.size() > 7)
-    focusedmonitors.pop_back();
+  if (primary) {
+    roi_rects.assign(outs.size(), UvRect{});
+    output_use.assign(outs.size(), USE_HIDDEN);
+  }
 
-  // Draw ring (background monitors)
-  for (int i = 0; i < int(focusedmonitors.size()) - 1; ++i) {
-    const MyMonitor *m = focusedmonitors[i + 1];
-    if (!m)
+  for (size_t i = 0; i < panels.size(); ++i) {
+    const PanelPlacement &p = panels[i];
+    if (p.output < 0 || p.output >= (int)outs.size())
       continue;
+    glPushMatrix();
+    glMultMatrixf(p.model);
+    if (primary) {
+      UvRect vis;
+      int use = USE_THUMBNAIL;
+      if (p.kind == PanelKind::Foreground || int(i) == gaze_hit.id)
+        use = USE_FOCUS;
+      else if (p.kind != PanelKind::Thumbnail)
+        use = panelVisibleUV(p.w, p.h, vis) ? USE_PANEL : USE_HIDDEN;
+      output_use[p.output] = std::max(output_use[p.output], use);
+    }
+    if (primary && p.kind != PanelKind::Thumbnail)
+      accumulateROI(p.output, p.u0, p.v0, p.u1, p.v1, p.w, p.h);
+    drawOutputQuad(outs[p.output], p.u0, p.v0, p.u1, p.v1, p.w, p.h);
+    if (cursor_enabled && p.kind != PanelKind::Thumbnail)
+      drawCursorQuad(outs[p.output], p.u0, p.v0, p.u1, p.v1, p.w, p.h);
+    glPopMatrix();
+  }
 
-    // Find which output feeds this monitor rectangle
-    // In this simplified layout every MyMonitor corresponds 1:1 to an output by
-    // index.
-    int idx = m->index;
-    if (idx < 0 || idx >= (int)outs.size())
-      continue;
+  if (primary && center_dot_enabled)
+    draw_filled_center_rect(4 * rscale_effective(), 4 * rscale_effective());
+}
 
-    float aspect = float(m->height) / float(m->width);
-    float focused_h = focused_w * aspect;
+static void render(const std::vector<CapturedOutput> &outs) {
+  int ww = 0, wh = 0, w = 0, h = 0;
+  window_get_framebuffer_size(&ww, &wh);
+  rscale_begin(ww, wh, w, h);
+  if (fovea_begin_periphery(w, h)) {
+    panel_shader_set_cheap(true);
+    draw_scene(outs, false);
+    panel_shader_set_cheap(false);
+    fovea_begin_center();
+  } else {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+  draw_scene(outs, true);
+  fovea_end();
+  rscale_end();
+}
 
-    glPushMatrix();
-    glRotatef(-i * angle_deg + screen_angle_offset_degrees, 0, 1, 0);
-    glTranslatef(0, 0, base_z);
+// Shed load at the governor's level: capture outputs outside the foreground
+// less often (thumbnail-only ones not at all from GOV_THUMBNAILS), cheapen
+// panel sampling, and finally lower the render scale.
+static int capture_interval(int use, int level) {
+  if (use == USE_FOCUS || level < GOV_BACKGROUND)
+    return 1;
+  if (use == USE_HIDDEN)
+    return 0;
+  if (use == USE_THUMBNAIL)
+    return level >= GOV_THUMBNAILS ? 0 : 4;
+  return level >= GOV_THUMBNAILS ? 3 : 2;
+}
 
-    float u0, v0, u1, v1;
-    getMonitorUVs(*m, fbW, fbH, u0, v0, u1, v1);
-    drawTexturedQuad(outs[idx].texture, u0, v0, u1, v1, focused_w, focused_h);
-    glPopMatrix();
-  }
+static void apply_governor(const std::vector<CapturedOutput> &outs) {
+  const int level = governor_level();
+  for (size_t i = 0; i < outs.size(); ++i)
+    wlr_multi_set_interval(
+        i, capture_interval(i < output_use.size() ? output_use[i] : USE_PANEL,
+                            level));
+  panel_shader_set_reduced(level >= GOV_SAMPLING);
+  rscale_set_load_factor(level >= GOV_RESOLUTION ? 0.75f : 1.0f);
+}
 
-  // Foreground monitor
-  if (!focusedmonitors.empty() && focusedmonitors[0]) {
-    const MyMonitor *m = focusedmonitors[0];
-    int idx = m->index;
-    if (idx >= 0 && idx < (int)outs.size()) {
-      float aspect = float(m->height) / float(m->width),
-            focused_h = focused_w * aspect;
-      glPushMatrix();
-      glRotatef(-angle_deg * aspect, 1, 0, 0);
-      glTranslatef(0, 0, base_z);
-      float u0, v0, u1, v1;
-      getMonitorUVs(*m, fbW, fbH, u0, v0, u1, v1);
-      drawTexturedQuad(outs[idx].texture, u0, v0, u1, v1, focused_w, focused_h);
-      glPopMatrix();
+// Output hotplug (virtual outputs and window sources included): re-derive the
+// views, and bring a just-created output or window to the front.
+static void outputs_changed(const std::vector<CapturedOutput> &outs) {
+  layout_outputs.clear();
+  for (const CapturedOutput &o : outs)
+    layout_outputs.push_back(LayoutOutput{o.name, o.width, o.height});
+  rebuild_views();
+  if (focus_pending.empty())
+    return;
+  for (size_t i = 0; i < monitors.size(); ++i)
+    if (outs[monitors[i].index].name == focus_pending) {
+      focus_monitor(int(i));
+      focus_pending.clear();
+      break;
     }
-  }
+}
 
-  // Thumbnails row (one per output)
-  float thumbY = 1.2f, spacing = 0.6f, thumbSize = 0.55f;
-  for (size_t i = 0; i < mons.size(); ++i) {
-    const MyMonitor &m = mons[i];
-    int idx = m.index;
-    if (idx < 0 || idx >= (int)outs.size())
-      continue;
+// ---- Render check ----
+// $VITURE_RENDER_CHECK=<dir>: draw fixed scenarios over synthetic outputs with
+// the built-in layout and compare them with the goldens in <dir> (see
+// render_check.hpp), then exit. No glasses, capture or command server.
+struct CheckScenario {
+  const char *name;
+  int outputs;
+  float roll, pitch, yaw;
+  int thumbnails; // LayoutConfig::thumbnails
+};
+static const CheckScenario check_scenarios[] = {
+    {"1-front", 1, 0, 0, 0, -1}, // first: the reference for frame times
+    {"3-front", 3, 0, 0, 0, -1},
+    {"3-left", 3, 0, 0, -35, -1},
+    {"3-tilted", 3, 8, 10, 12, -1},
+    {"7-front", 7, 0, 0, 0, -1},
+    {"7-thumbnails", 7, 0, -15, 0, -1}, // up at the thumbnail row
+    {"7-right-no-thumbnails", 7, 0, 0, 40, 0},
+};
 
-    float x = (i - (mons.size() - 1) / 2.0f) * spacing, y = thumbY, z = base_z;
-    glPushMatrix();
-    glTranslatef(x, y, z);
-    float u0, v0, u1, v1;
-    getMonitorUVs(m, fbW, fbH, u0, v0, u1, v1);
-    drawTexturedQuad(outs[idx].texture, u0, v0, u1, v1, thumbSize, thumbSize);
-    glPopMatrix();
+static int run_render_check(const std::string &dir) {
+  const char *update_env = std::getenv("VITURE_RENDER_CHECK_UPDATE");
+  const bool update = update_env && std::strcmp(update_env, "1") == 0;
+  const char *timing_env = std::getenv("VITURE_RENDER_CHECK_TIMING");
+  const bool gate_time = timing_env && std::strcmp(timing_env, "gate") == 0;
+  const int CHECK_FRAMES = 20;
+  setenv("VITURE_PLATFORM", "surfaceless", 0);
+  init_window_and_gl(1920, 1080, "render check");
+  if (!initGL()) {
+    shutdown_window();
+    return 1;
+  }
+  int w = 0, h = 0;
+  window_get_framebuffer_size(&w, &h);
+  glasses = Glasses{};
+  glasses.fov = 40.0;
 
-    // Gaze selection
-    if (isLookingAt(eyeX, eyeY, eyeZ, rayX, rayY, rayZ, x, y, z, thumbSize,
-                    thumbSize)) {
-      if (focusCandidate == i) {
-        focusFrames++;
-        if (focusFrames >= FOCUS_HOLD_FRAMES) {
-          focusIndex = i;
-          focusCandidate = -1;
-          focusFrames = 0;
-          if (focusedmonitors.size() == 0) {
-            focusedmonitors.push_back(&monitors[i]);
-          } else {
-            focusedmonitors[0] = &monitors[i];
-          }
-        }
-      } else {
-        focusCandidate = i;
-        focusFrames = 1;
-      }
+  int failed = 0;
+  double ref_us = 0;
+  std::vector<CapturedOutput> outs;
+  for (const CheckScenario &sc : check_scenarios) {
+    layout_cfg = LayoutConfig{};
+    layout_cfg.thumbnails = sc.thumbnails;
+    angle_deg = layout_cfg.arc;
+    const double import_ms = rcheck_make_outputs(sc.outputs, 1920, 1080, outs);
+    focusedmonitors.clear();
+    outputs_changed(outs);
+    focus_monitor(0);
+    layout_valid = false;
+    update_layout(monitors);
+    panel_shader_update(outs);
+    glasses.roll = sc.roll;
+    glasses.pitch = sc.pitch;
+    glasses.yaw = sc.yaw;
+
+    std::vector<double> times;
+    for (int f = 0; f < CHECK_FRAMES; ++f) {
+      const auto t0 = std::chrono::steady_clock::now();
+      render(outs);
+      glFinish();
+      times.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count());
     }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2,
+                     times.end());
+
+    const double median_us = times[times.size() / 2];
+    if (ref_us == 0)
+      ref_us = median_us;
+
+    std::string image_msg, time_msg;
+    const bool image_ok = rcheck_compare(dir, sc.name, w, h, update, image_msg);
+    const bool time_ok = rcheck_time(dir, sc.name, median_us, ref_us, gate_time,
+                                     update, time_msg);
+    failed += !image_ok || !time_ok;
+    std::fprintf(image_ok && time_ok ? stdout : stderr,
+                 "[check] %-22s %s  image: %s  render: %s  import: %.1f ms\n",
+                 sc.name, image_ok && time_ok ? "ok  " : "FAIL",
+                 image_msg.c_str(), time_msg.c_str(), import_ms);
+    rcheck_free_outputs(outs);
   }
+  rcheck_finish(dir);
+  std::fprintf(stdout, "[check] %d of %zu scenarios failed\n", failed,
+               sizeof(check_scenarios) / sizeof(check_scenarios[0]));
 
-  if (center_dot_enabled)
-    draw_filled_center_rect(4, 4);
+  panel_shader_shutdown();
+  rscale_shutdown();
+  shutdown_window();
+  return failed ? 1 : 0;
 }
 
 int main(int, char **) {
+  const auto process_start = std::chrono::steady_clock::now();
+  if (const char *dir = std::getenv("VITURE_RENDER_CHECK"))
+    return run_render_check(dir);
   if (init_glasses() != ERR_SUCCESS) {
     std::fprintf(stderr, "Failed to setup glasses\n");
     return 1;
   }
   glasses.fov = 40.0;
-  on_align();
-
-  // Hook command handlers
-  cmd_on_align = on_align;
-  cmd_on_push = on_push;
-  cmd_on_pop = on_pop;
-  cmd_on_zoom_in_fov = on_zoom_in_fov;
-  cmd_on_zoom_out_fov = on_zoom_out_fov;
-  cmd_on_zoom_in = on_zoom_in;
-  cmd_on_zoom_out = on_zoom_out;
-  cmd_on_shift_left = on_shift_left;
-  cmd_on_shift_right = on_shift_right;
-  cmd_on_toggle_center_dot = on_toggle_center_dot;
+  on_align(CmdArgs{});
+
+  load_layout_config(true);
+  layout_watch_init();
+  register_commands();
 
   // Window + GL (EGL)
   init_window_and_gl(1920, 1080, "Viture AR (Wayland DMA-BUF)");
@@ -332,9 +1108,20 @@ int main(int, char **) {
   }
 
   // Discover outputs & build a synthetic big framebuffer layout (side-by-side)
+  // Cached output sizes/formats let the capture skip its startup probe
+  std::vector<CaptureHint> hints;
+  for (const OutputCache &oc : session_load_outputs())
+    hints.push_back(CaptureHint{oc.name, oc.width, oc.height, oc.fourcc});
+  wlr_multi_set_hints(hints);
+
   std::vector<CapturedOutput> outs;
   int fbW = 0, fbH = 0;
+  auto capture_start = std::chrono::steady_clock::now();
   wlr_multi_capture_init(outs, &fbW, &fbH);
+  frame_stats.capture_init_ms =
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - capture_start)
+          .count();
   std::fprintf(stdout, "[debug] fbW=%d, fbH=%d\n", fbW, fbH);
 
   // for (auto& o : outs) { fbW += o.width; fbH = std::max(fbH, o.height); }
@@ -345,60 +1132,129 @@ int main(int, char **) {
                  o.x, o.y, o.width, o.height);
   }
 
-  monitors.clear();
-  int curX = 0;
-  for (int i = 0; i < (int)outs.size(); ++i) {
-    MyMonitor m{};
-    m.x = curX;
-    m.y = 0;
-    m.width = outs[i].width;
-    m.height = outs[i].height;
-    m.index = i; // 1:1 mapping monitor -> CapturedOutput index
-    monitors.push_back(m);
-    curX += m.width;
-  }
+  outputs_changed(outs);
 
-  focusedmonitors.clear();
-  if (!monitors.empty()) {
-    focusedmonitors.push_back(&monitors[0]);
+  // Restore the workspace for this set of outputs before the first frame
+  std::vector<std::string> names;
+  std::vector<OutputCache> caches;
+  for (const CapturedOutput &o : outs) {
+    names.push_back(o.name);
+    caches.push_back(OutputCache{o.name, o.width, o.height, o.fourcc});
+  }
+  session_key = session_layout_key(names);
+  session_save_outputs(caches);
+  SessionState restored;
+  if (session_load(session_key, restored)) {
+    apply_session(restored);
+    std::fprintf(stdout, "[state] restored layout '%s'\n", session_key.c_str());
   }
+  saved_state = persist_string();
 
+  std::string last_state;
   long highest = 0;
   int frame = 0;
   const int warm_frames = 1000;
-  const useconds_t target_us = 1000000 / 120;
+  // Frame budget: the scanout refresh when the swap waits for vblank (kms),
+  // else 120 Hz paced by the sleep below
+  const int refresh_hz = platform_refresh_hz();
+  const useconds_t target_us = 1000000 / (refresh_hz > 0 ? refresh_hz : 120);
+  // Copies that miss half the frame are picked up next frame rather than
+  // stalling the loop; the governor sees the work time without that wait
+  // and without the swap.
+  wlr_multi_set_wait_budget(int(target_us / 2));
+  governor_set_budget(target_us);
 
   while (!window_should_close()) {
     auto start = std::chrono::high_resolution_clock::now();
 
     // Update all outputs
     wlr_multi_next_frame(outs);
+    if (wlr_multi_update_outputs(outs))
+      outputs_changed(outs);
+    panel_shader_update(outs);
 
-    // Render using our stitched layout
+    // Render using our stitched layout. Queued commands run here, between
+    // frames, so their side effects never overlap a render() in progress.
     cmdsrv_poll();
-    render(outs, monitors, fbW, fbH);
+    cmdsrv_dispatch();
+    if (layout_watch_poll()) {
+      // Capture keeps running; only views and transforms change
+      load_layout_config(false);
+      rebuild_views();
+    }
+    update_layout(monitors);
+    update_gaze(monitors);
+    render(outs);
+    updateROI(outs);
+    apply_governor(outs);
+
+    if (cmdsrv_has_subscribers()) {
+      std::string st = state_string();
+      if (st != last_state) {
+        cmdsrv_publish("state", st);
+        last_state.swap(st);
+      }
+    }
+
+    session_tick(false);
 
+    if (frame_dump_active()) {
+      int fw = 0, fh = 0;
+      window_get_framebuffer_size(&fw, &fh);
+      frame_dump_capture(fw, fh);
+    }
+    // A vblank-paced swap blocks until the previous flip lands; that is not work
+    const long work_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::high_resolution_clock::now() - start)
+                             .count();
     window_swap();
     window_poll();
 
+    if (frame_stats.frames == 0) {
+      frame_stats.first_frame_ms =
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - process_start)
+              .count();
+      std::fprintf(stdout,
+                   "[startup] capture init %.1f ms, first frame after %.1f ms "
+                   "(%zu outputs)\n",
+                   frame_stats.capture_init_ms, frame_stats.first_frame_ms,
+                   outs.size());
+    }
+
     auto end = std::chrono::high_resolution_clock::now();
     auto dur =
         std::chrono::duration_cast<std::chrono::microseconds>(end - start)
             .count();
+    frame_stats.frames++;
+    frame_stats.last_us = dur;
+    frame_stats.avg_us += (dur - frame_stats.avg_us) * 0.05;
+    if (dur > frame_stats.highest_us)
+      frame_stats.highest_us = dur;
+    if (governor_feed(double(work_us - wlr_multi_last_wait_us())) &&
+        cmdsrv_has_subscribers())
+      cmdsrv_publish("governor", governor_stats());
     if (frame > warm_frames) {
-      if (dur > highest) {
-        highest = dur;
-        std::cout << "new highest frame " << dur << " us\n";
+      if (work_us > highest) {
+        highest = work_us;
+        std::cout << "new highest frame " << work_us << " us of work\n";
       }
     } else {
       ++frame;
     }
 
-    if (dur < target_us) {
+    if (refresh_hz <= 0 && dur < target_us) {
       usleep(target_us - dur);
     }
   }
 
+  session_tick(true);
+  frame_dump_stop();
+  layout_watch_shutdown();
+  fovea_shutdown();
+  rscale_shutdown();
+  panel_shader_shutdown();
+  vout_destroy_all();
   wlr_multi_shutdown();
   cmdsrv_shutdown();
   shutdown_window();
@@ -0,0 +1,52 @@
+#include "offscreen_target.hpp"
+
+bool target_ensure(OffscreenTarget& t, int w, int h) {
+  if (t.fbo && t.w == w && t.h == h) return true;
+  target_free(t);
+  GLint max_rb = 0;
+  glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_rb);
+  if (w <= 0 || h <= 0 || w > max_rb || h > max_rb) return false;
+
+  GLint bound = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+  glGenFramebuffers(1, &t.fbo);
+  glGenRenderbuffers(1, &t.color_rb);
+  glGenRenderbuffers(1, &t.depth_rb);
+  glBindRenderbuffer(GL_RENDERBUFFER, t.color_rb);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+  glBindRenderbuffer(GL_RENDERBUFFER, t.depth_rb);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t.color_rb);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, t.depth_rb);
+  const bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, bound);
+  if (!ok) {
+    target_free(t);
+    return false;
+  }
+  t.w = w; t.h = h;
+  return true;
+}
+
+void target_bind(OffscreenTarget& t) {
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &t.prev_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+  glViewport(0, 0, t.w, t.h);
+}
+
+void target_blit_to_prev(OffscreenTarget& t, int w, int h) {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, t.fbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, t.prev_fbo);
+  glBlitFramebuffer(0, 0, t.w, t.h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  glBindFramebuffer(GL_FRAMEBUFFER, t.prev_fbo);
+  glViewport(0, 0, w, h);
+}
+
+void target_free(OffscreenTarget& t) {
+  if (t.fbo)      { glDeleteFramebuffers(1, &t.fbo); t.fbo = 0; }
+  if (t.color_rb) { glDeleteRenderbuffers(1, &t.color_rb); t.color_rb = 0; }
+  if (t.depth_rb) { glDeleteRenderbuffers(1, &t.depth_rb); t.depth_rb = 0; }
+  t.w = t.h = 0;
+}
@@ -0,0 +1,318 @@
+#include "panel_shader.hpp"
+
+#include <GL/gl.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+struct PanelProgram {
+  GLuint prog = 0;
+  GLint  tex = -1, mips = -1, texel = -1, sharpness = -1, use_mips = -1, exposure = -1;
+};
+
+// Half-size mip chain of one capture texture: level 0 here is 1/2 of the capture.
+struct MipChain {
+  GLuint tex    = 0;
+  int    w = 0, h = 0;
+  int    levels = 0;
+  GLenum ifmt   = 0;
+  bool   seen   = false;
+};
+
+static PanelProgram prog_sdr, prog_hdr;
+static const PanelProgram* bound = nullptr;
+static std::unordered_map<GLuint, MipChain> chains;   // by capture texture
+static GLuint fbo        = 0;
+static float  exposure   = 1.0f;
+static float  sharpness  = 0.4f;
+static float  anisotropy = 4.0f;
+static float  max_aniso  = 1.0f;
+static bool   mips_on    = true;
+static bool   cheap      = false;
+static bool   reduced    = false;   // quality governor: no sharpen, no anisotropy
+
+// Vertex stage stays fixed function; gl_TexCoord[0] comes from glTexCoord2f.
+static const char* PANEL_FS = R"(
+uniform sampler2D tex;       // capture, bilinear
+uniform sampler2D mips;      // half-size mip chain
+uniform vec2  texel;         // 1 / capture size
+uniform float sharpness;     // 0..1
+uniform float use_mips;
+uniform float exposure;
+
+void main() {
+  vec2 uv = gl_TexCoord[0].st;
+  vec2 dx = dFdx(uv / texel), dy = dFdy(uv / texel);
+  float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+
+  vec3 c = texture2D(tex, uv).rgb;
+  vec3 mip = texture2D(mips, uv).rgb;
+
+  // Contrast-adaptive sharpen: less where the neighbourhood is near clipping.
+  // Uniform branch, so the extra taps cost nothing when sharpening is off.
+  if (sharpness > 0.0) {
+    vec3 n = texture2D(tex, uv - vec2(0.0, texel.y)).rgb;
+    vec3 s = texture2D(tex, uv + vec2(0.0, texel.y)).rgb;
+    vec3 w = texture2D(tex, uv - vec2(texel.x, 0.0)).rgb;
+    vec3 e = texture2D(tex, uv + vec2(texel.x, 0.0)).rgb;
+    vec3 mn = min(c, min(min(n, s), min(w, e)));
+    vec3 mx = max(c, max(max(n, s), max(w, e)));
+    vec3 amp = sqrt(clamp(min(mn, 1.0 - mx) / max(mx, 1e-4), 0.0, 1.0));
+    vec3 wt = -amp / mix(8.0, 5.0, sharpness);
+    vec3 sharp = (c + (n + s + w + e) * wt) / (1.0 + 4.0 * wt);
+    c = mix(c, sharp, sharpness * clamp(1.0 - lod, 0.0, 1.0));
+  }
+
+  // Hardware picks level lod - 1 of the half-size chain
+  c = mix(c, mip, use_mips * clamp(lod, 0.0, 1.0));
+  c *= exposure;
+
+#ifdef HDR
+  const float WHITE = 4.0;   // scRGB value mapped to display white
+  c = max(c, 0.0);
+  c = c * (1.0 + c / (WHITE * WHITE)) / (1.0 + c);
+  c = mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c));
+#endif
+  gl_FragColor = vec4(c, 1.0);
+}
+)";
+
+static GLuint compile(GLenum type, const std::string& src) {
+  GLuint s = glCreateShader(type);
+  const char* p = src.c_str();
+  glShaderSource(s, 1, &p, nullptr);
+  glCompileShader(s);
+  GLint ok = 0;
+  glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+  if (!ok) {
+    char log[1024];
+    glGetShaderInfoLog(s, sizeof(log), nullptr, log);
+    fprintf(stderr, "[shader] compile failed: %s\n", log);
+    glDeleteShader(s);
+    return 0;
+  }
+  return s;
+}
+
+static bool link_panel(PanelProgram& pp, const char* defines) {
+  GLuint fs = compile(GL_FRAGMENT_SHADER, std::string("#version 120\n") + defines + PANEL_FS);
+  if (!fs) return false;
+  GLuint p = glCreateProgram();
+  glAttachShader(p, fs);
+  glLinkProgram(p);
+  glDeleteShader(fs);
+  GLint ok = 0;
+  glGetProgramiv(p, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    char log[1024];
+    glGetProgramInfoLog(p, sizeof(log), nullptr, log);
+    fprintf(stderr, "[shader] link failed: %s\n", log);
+    glDeleteProgram(p);
+    return false;
+  }
+  pp.prog      = p;
+  pp.tex       = glGetUniformLocation(p, "tex");
+  pp.mips      = glGetUniformLocation(p, "mips");
+  pp.texel     = glGetUniformLocation(p, "texel");
+  pp.sharpness = glGetUniformLocation(p, "sharpness");
+  pp.use_mips  = glGetUniformLocation(p, "use_mips");
+  pp.exposure  = glGetUniformLocation(p, "exposure");
+  return true;
+}
+
+bool panel_shader_init() {
+  if (!link_panel(prog_sdr, "") || !link_panel(prog_hdr, "#define HDR\n")) {
+    panel_shader_shutdown();
+    return false;
+  }
+  const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+  if (ext && (strstr(ext, "GL_EXT_texture_filter_anisotropic") ||
+              strstr(ext, "GL_ARB_texture_filter_anisotropic")))
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_aniso);
+  anisotropy = std::min(anisotropy, max_aniso);
+  glGenFramebuffers(1, &fbo);
+  return true;
+}
+
+void panel_shader_shutdown() {
+  for (auto& kv : chains) glDeleteTextures(1, &kv.second.tex);
+  chains.clear();
+  if (fbo) { glDeleteFramebuffers(1, &fbo); fbo = 0; }
+  if (prog_sdr.prog) { glDeleteProgram(prog_sdr.prog); prog_sdr = PanelProgram{}; }
+  if (prog_hdr.prog) { glDeleteProgram(prog_hdr.prog); prog_hdr = PanelProgram{}; }
+}
+
+// ---- Mip chains ----
+
+static GLenum mip_format(uint32_t fourcc) {
+  if (capture_format_is_float(fourcc)) return GL_RGBA16F;
+  if (capture_format_precision(fourcc) > 8) return GL_RGB10_A2;
+  return GL_RGBA8;
+}
+
+static void apply_sampling(const MipChain& m) {
+  glBindTexture(GL_TEXTURE_2D, m.tex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m.levels - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  if (max_aniso > 1.0f)
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, reduced ? 1.0f : anisotropy);
+}
+
+static void alloc_chain(MipChain& m, int w, int h, GLenum ifmt) {
+  if (!m.tex) glGenTextures(1, &m.tex);
+  m.w = w; m.h = h; m.ifmt = ifmt;
+  m.levels = 1;
+  while ((std::max(w, h) >> m.levels) > 0) ++m.levels;
+  glBindTexture(GL_TEXTURE_2D, m.tex);
+  for (int l = 0; l < m.levels; ++l)
+    glTexImage2D(GL_TEXTURE_2D, l, ifmt, std::max(1, w >> l), std::max(1, h >> l), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  apply_sampling(m);
+}
+
+// Render rows [y0, y1) of a dw x dh target from the bound texture; each target
+// texel lands on the centre of its 2x2 source block, so bilinear = box filter.
+static void downsample_rows(int dw, int dh, int y0, int y1) {
+  glViewport(0, 0, dw, dh);
+  const float v0 = float(y0) / dh, v1 = float(y1) / dh;
+  glBegin(GL_QUADS);
+  glTexCoord2f(0, v0); glVertex2f(0, float(y0));
+  glTexCoord2f(1, v0); glVertex2f(float(dw), float(y0));
+  glTexCoord2f(1, v1); glVertex2f(float(dw), float(y1));
+  glTexCoord2f(0, v1); glVertex2f(0, float(y1));
+  glEnd();
+}
+
+static void update_chain(const CapturedOutput& o, MipChain& m, int y0, int y1) {
+  // Level 0 from the capture, level l from level l-1, each over the damaged rows only
+  for (int l = 0; l < m.levels; ++l) {
+    const int dw = std::max(1, m.w >> l), dh = std::max(1, m.h >> l);
+    const int shift = l + 1;
+    const int r0 = std::min(dh - 1, std::max(0, y0 >> shift));
+    const int r1 = std::min(dh, (y1 + (1 << shift) - 1) >> shift);
+    if (r1 <= r0) break;
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m.tex, l);
+    if (l == 0) {
+      glBindTexture(GL_TEXTURE_2D, o.texture);
+    } else {
+      glBindTexture(GL_TEXTURE_2D, m.tex);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, l - 1);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, l - 1);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, dw, 0, dh, -1, 1);
+    downsample_rows(dw, dh, r0, r1);
+  }
+  apply_sampling(m);
+}
+
+void panel_shader_update(const std::vector<CapturedOutput>& outs) {
+  if (!prog_sdr.prog || !mips_on) return;
+  for (auto& kv : chains) kv.second.seen = false;
+
+  GLint prev_fbo = 0;
+  bool  setup = false;
+  for (const auto& o : outs) {
+    if (!o.texture || o.tex_w < 2 || o.tex_h < 2) continue;
+    MipChain& m = chains[o.texture];
+    m.seen = true;
+    int y0 = o.dirty_y0, y1 = o.dirty_y1;
+    const int w = o.tex_w / 2, h = o.tex_h / 2;
+    const GLenum ifmt = mip_format(o.fourcc);
+    if (!m.tex || m.w != w || m.h != h || m.ifmt != ifmt) {
+      alloc_chain(m, w, h, ifmt);
+      y0 = 0; y1 = o.tex_h;
+    }
+    if (y1 <= y0) continue;
+
+    if (!setup) {
+      glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+      glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+      glMatrixMode(GL_PROJECTION); glPushMatrix();
+      glMatrixMode(GL_MODELVIEW);  glPushMatrix(); glLoadIdentity();
+      glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+      glDisable(GL_DEPTH_TEST);
+      glDisable(GL_BLEND);
+      glEnable(GL_TEXTURE_2D);
+      glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+      setup = true;
+    }
+    update_chain(o, m, y0, y1);
+  }
+  if (setup) {
+    glBindFramebuffer(GL_FRAMEBUFFER, prev_fbo);
+    glMatrixMode(GL_PROJECTION); glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);  glPopMatrix();
+    glPopAttrib();
+  }
+
+  for (auto it = chains.begin(); it != chains.end();) {
+    if (it->second.seen) { ++it; continue; }
+    glDeleteTextures(1, &it->second.tex);
+    it = chains.erase(it);
+  }
+}
+
+// ---- Drawing ----
+
+void panel_shader_begin(const CapturedOutput& o) {
+  if (!prog_sdr.prog || o.tex_w <= 0 || o.tex_h <= 0) return;
+  const PanelProgram& p = capture_format_is_float(o.fourcc) ? prog_hdr : prog_sdr;
+  auto it = mips_on ? chains.find(o.texture) : chains.end();
+  const bool have_mips = it != chains.end() && it->second.tex;
+
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, have_mips ? it->second.tex : o.texture);
+  glActiveTexture(GL_TEXTURE0);
+
+  glUseProgram(p.prog);
+  glUniform1i(p.tex, 0);
+  glUniform1i(p.mips, 1);
+  glUniform2f(p.texel, 1.0f / o.tex_w, 1.0f / o.tex_h);
+  glUniform1f(p.sharpness, cheap || reduced ? 0.0f : sharpness);
+  glUniform1f(p.use_mips, have_mips ? 1.0f : 0.0f);
+  glUniform1f(p.exposure, exposure);
+  bound = &p;
+}
+
+void panel_shader_end() {
+  if (!bound) return;
+  glUseProgram(0);
+  bound = nullptr;
+}
+
+void panel_shader_set_exposure(float e) { exposure = e; }
+float panel_shader_exposure() { return exposure; }
+
+void panel_shader_set_sharpness(float s) { sharpness = std::clamp(s, 0.0f, 1.0f); }
+float panel_shader_sharpness() { return sharpness; }
+
+void panel_shader_set_anisotropy(float a) {
+  anisotropy = std::clamp(a, 1.0f, max_aniso);
+  for (auto& kv : chains) apply_sampling(kv.second);
+}
+float panel_shader_anisotropy() { return anisotropy; }
+
+void panel_shader_set_mips(bool on) {
+  mips_on = on;
+  if (on) return;
+  for (auto& kv : chains) glDeleteTextures(1, &kv.second.tex);
+  chains.clear();
+}
+bool panel_shader_mips() { return mips_on; }
+
+void panel_shader_set_cheap(bool on) { cheap = on; }
+
+void panel_shader_set_reduced(bool on) {
+  if (on == reduced) return;
+  reduced = on;
+  for (auto& kv : chains) apply_sampling(kv.second);
+}
+bool panel_shader_reduced() { return reduced; }
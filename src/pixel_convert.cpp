@@ -0,0 +1,175 @@
+#include "pixel_convert.hpp"
+
+#include <drm_fourcc.h>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define PC_X86 1
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+  #define PC_NEON 1
+#endif
+
+// wl_shm uses DRM fourccs except for these two legacy codes
+static const uint32_t SHM_ARGB8888 = 0;
+static const uint32_t SHM_XRGB8888 = 1;
+
+bool pixel_layout_from_shm(uint32_t f, PixelLayout& out) {
+  switch (f) {
+    case SHM_ARGB8888: case SHM_XRGB8888:
+    case DRM_FORMAT_ARGB8888: case DRM_FORMAT_XRGB8888:
+      out = PixelLayout::XRGB8888; return true;
+    case DRM_FORMAT_ABGR8888: case DRM_FORMAT_XBGR8888:
+      out = PixelLayout::XBGR8888; return true;
+    case DRM_FORMAT_ARGB2101010: case DRM_FORMAT_XRGB2101010:
+      out = PixelLayout::XRGB2101010; return true;
+    case DRM_FORMAT_ABGR2101010: case DRM_FORMAT_XBGR2101010:
+      out = PixelLayout::XBGR2101010; return true;
+  }
+  return false;
+}
+
+// ---- scalar (also handles the tails of the SIMD loops) ----
+static inline uint32_t px(PixelLayout l, uint32_t p) {
+  switch (l) {
+    case PixelLayout::XRGB8888:
+      return p | 0xFF000000u;
+    case PixelLayout::XBGR8888:
+      return ((p & 0xFFu) << 16) | (p & 0xFF00u) | ((p >> 16) & 0xFFu) | 0xFF000000u;
+    case PixelLayout::XRGB2101010:
+      return ((p >> 2) & 0xFFu) | (((p >> 12) & 0xFFu) << 8) | (((p >> 22) & 0xFFu) << 16) | 0xFF000000u;
+    case PixelLayout::XBGR2101010:
+      return ((p >> 22) & 0xFFu) | (((p >> 12) & 0xFFu) << 8) | (((p >> 2) & 0xFFu) << 16) | 0xFF000000u;
+  }
+  return p;
+}
+
+static void convert_scalar(PixelLayout l, const uint32_t* s, uint32_t* d, int n) {
+  for (int i = 0; i < n; ++i) d[i] = px(l, s[i]);
+}
+
+// The SIMD versions are the scalar formulas on 32-bit lanes.
+#if PC_X86
+static void convert_sse2(PixelLayout l, const uint32_t* s, uint32_t* d, int n) {
+  const __m128i a   = _mm_set1_epi32((int)0xFF000000u);
+  const __m128i m8  = _mm_set1_epi32(0xFF);
+  const __m128i m8g = _mm_set1_epi32(0xFF00);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(s + i)), r;
+    switch (l) {
+      case PixelLayout::XRGB8888:
+        r = _mm_or_si128(p, a);
+        break;
+      case PixelLayout::XBGR8888:
+        r = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, m8), 16), _mm_and_si128(p, m8g)),
+                         _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), m8), a));
+        break;
+      case PixelLayout::XRGB2101010:
+        r = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 2), m8),
+                                      _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 12), m8), 8)),
+                         _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 22), m8), 16), a));
+        break;
+      default: // XBGR2101010
+        r = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 22), m8),
+                                      _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 12), m8), 8)),
+                         _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 2), m8), 16), a));
+        break;
+    }
+    _mm_storeu_si128((__m128i*)(d + i), r);
+  }
+  convert_scalar(l, s + i, d + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void convert_avx2(PixelLayout l, const uint32_t* s, uint32_t* d, int n) {
+  const __m256i a   = _mm256_set1_epi32((int)0xFF000000u);
+  const __m256i m8  = _mm256_set1_epi32(0xFF);
+  const __m256i m8g = _mm256_set1_epi32(0xFF00);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i*)(s + i)), r;
+    switch (l) {
+      case PixelLayout::XRGB8888:
+        r = _mm256_or_si256(p, a);
+        break;
+      case PixelLayout::XBGR8888:
+        r = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(p, m8), 16), _mm256_and_si256(p, m8g)),
+                            _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 16), m8), a));
+        break;
+      case PixelLayout::XRGB2101010:
+        r = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 2), m8),
+                                            _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(p, 12), m8), 8)),
+                            _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(p, 22), m8), 16), a));
+        break;
+      default: // XBGR2101010
+        r = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 22), m8),
+                                            _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(p, 12), m8), 8)),
+                            _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(p, 2), m8), 16), a));
+        break;
+    }
+    _mm256_storeu_si256((__m256i*)(d + i), r);
+  }
+  convert_sse2(l, s + i, d + i, n - i);
+}
+#endif
+
+#if PC_NEON
+static void convert_neon(PixelLayout l, const uint32_t* s, uint32_t* d, int n) {
+  const uint32x4_t a   = vdupq_n_u32(0xFF000000u);
+  const uint32x4_t m8  = vdupq_n_u32(0xFF);
+  const uint32x4_t m8g = vdupq_n_u32(0xFF00);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    uint32x4_t p = vld1q_u32(s + i), r;
+    switch (l) {
+      case PixelLayout::XRGB8888:
+        r = vorrq_u32(p, a);
+        break;
+      case PixelLayout::XBGR8888:
+        r = vorrq_u32(vorrq_u32(vshlq_n_u32(vandq_u32(p, m8), 16), vandq_u32(p, m8g)),
+                      vorrq_u32(vandq_u32(vshrq_n_u32(p, 16), m8), a));
+        break;
+      case PixelLayout::XRGB2101010:
+        r = vorrq_u32(vorrq_u32(vandq_u32(vshrq_n_u32(p, 2), m8),
+                                vshlq_n_u32(vandq_u32(vshrq_n_u32(p, 12), m8), 8)),
+                      vorrq_u32(vshlq_n_u32(vandq_u32(vshrq_n_u32(p, 22), m8), 16), a));
+        break;
+      default: // XBGR2101010
+        r = vorrq_u32(vorrq_u32(vandq_u32(vshrq_n_u32(p, 22), m8),
+                                vshlq_n_u32(vandq_u32(vshrq_n_u32(p, 12), m8), 8)),
+                      vorrq_u32(vshlq_n_u32(vandq_u32(vshrq_n_u32(p, 2), m8), 16), a));
+        break;
+    }
+    vst1q_u32(d + i, r);
+  }
+  convert_scalar(l, s + i, d + i, n - i);
+}
+#endif
+
+// ---- runtime dispatch ----
+using ConvertFn = void (*)(PixelLayout, const uint32_t*, uint32_t*, int);
+static ConvertFn   g_fn   = nullptr;
+static const char* g_impl = "scalar";
+
+static void pick_impl() {
+  g_fn = convert_scalar;
+#if PC_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))      { g_fn = convert_avx2; g_impl = "avx2"; }
+  else if (__builtin_cpu_supports("sse2")) { g_fn = convert_sse2; g_impl = "sse2"; }
+#elif PC_NEON
+  g_fn = convert_neon; g_impl = "neon";
+#endif
+}
+
+void pixel_convert_row(PixelLayout l, const uint32_t* src, uint32_t* dst, int width) {
+  if (!g_fn) pick_impl();
+  g_fn(l, src, dst, width);
+}
+
+const char* pixel_convert_impl() {
+  if (!g_fn) pick_impl();
+  return g_impl;
+}
@@ -0,0 +1,43 @@
+#include "platform.hpp"
+#include "platform_backend.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+static const PlatformBackend* backend = nullptr;
+
+void init_window_and_gl(int width, int height, const char* title) {
+  const char* env = std::getenv("VITURE_PLATFORM");
+  std::string name = env && *env ? env : "glfw", arg;
+  const size_t colon = name.find(':');
+  if (colon != std::string::npos) {
+    arg = name.substr(colon + 1);
+    name.resize(colon);
+  }
+
+  if (name == "glfw")     backend = platform_glfw();
+  else if (name == "kms") backend = platform_kms();
+  else if (name == "surfaceless") backend = platform_surfaceless();
+  else if (name == "gbm") backend = platform_gbm();
+  else throw std::runtime_error("VITURE_PLATFORM: unknown backend '" + name + "'");
+
+  std::fprintf(stdout, "[platform] %s%s%s\n", backend->name, arg.empty() ? "" : " ", arg.c_str());
+  backend->init(width, height, title, arg.c_str());
+}
+
+const char* platform_name() { return backend ? backend->name : "-"; }
+EGLDisplay platform_egl_display() {
+  return backend ? backend->egl_display() : EGL_NO_DISPLAY;
+}
+bool window_should_close() { return backend->should_close(); }
+void window_poll()         { backend->poll(); }
+void window_swap()         { backend->swap(); }
+void window_get_framebuffer_size(int* w, int* h) { backend->framebuffer_size(w, h); }
+int platform_refresh_hz()  { return backend ? backend->refresh_hz() : 0; }
+
+void shutdown_window() {
+  if (backend) backend->shutdown();
+  backend = nullptr;
+}
@@ -1,9 +1,11 @@
+#include "platform_backend.hpp"
+
 #include <GLFW/glfw3.h>
 #include <stdexcept>
 
 static GLFWwindow* gWin = nullptr;
 
-void init_window_and_gl(int width, int height, const char* title) {
+static void glfw_init(int width, int height, const char* title, const char*) {
   if (!glfwInit()) throw std::runtime_error("glfwInit failed");
 
   // Force EGL so we have EGLDisplay for EGLImage imports on Wayland
@@ -21,13 +23,25 @@ void init_window_and_gl(int width, int height, const char* title) {
   glfwSwapInterval(0); // no vsync
 }
 
-bool window_should_close() { return glfwWindowShouldClose(gWin); }
-void window_poll()         { glfwPollEvents(); }
-void window_swap()         { glfwSwapBuffers(gWin); }
-void window_get_framebuffer_size(int* w, int* h) { glfwGetFramebufferSize(gWin, w, h); }
+static bool glfw_should_close() { return glfwWindowShouldClose(gWin); }
+static void glfw_poll()         { glfwPollEvents(); }
+static void glfw_swap()         { glfwSwapBuffers(gWin); }
+static void glfw_framebuffer_size(int* w, int* h) { glfwGetFramebufferSize(gWin, w, h); }
+
+// GLFW_EGL_CONTEXT_API above: the context is EGL's, and current on this thread
+static EGLDisplay glfw_egl_display() { return eglGetCurrentDisplay(); }
 
-void shutdown_window() {
+static void glfw_shutdown() {
   if (gWin) { glfwDestroyWindow(gWin); gWin = nullptr; }
   glfwTerminate();
 }
 
+static int glfw_refresh_hz() { return 0; }   // swap interval 0
+
+const PlatformBackend* platform_glfw() {
+  static const PlatformBackend b = {
+    "glfw", glfw_init, glfw_should_close, glfw_poll, glfw_swap, glfw_framebuffer_size,
+    glfw_shutdown, glfw_egl_display, glfw_refresh_hz
+  };
+  return &b;
+}
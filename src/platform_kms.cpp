@@ -0,0 +1,560 @@
+// Direct scanout to the glasses: GBM surface + EGL, atomic KMS page flips.
+// The DRM fd comes from a wp_drm_lease_v1 lease of the glasses connector
+// (the compositor keeps everything else), or from opening a device directly.
+#include "platform_backend.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <gbm.h>
+#include <poll.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#ifdef HAVE_DRM_LEASE
+#include "drm-lease-v1-client-protocol.h"
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct KmsCtx {
+  int fd = -1;
+  bool leased = false;
+  bool closed = false;                 // lease revoked or display lost
+
+  uint32_t connector = 0, crtc = 0, plane = 0;
+  drmModeModeInfo mode{};
+  uint32_t mode_blob = 0;
+  drmModeCrtc* saved_crtc = nullptr;   // direct mode: restored on shutdown
+
+  // Atomic property ids
+  uint32_t conn_crtc_id = 0;
+  uint32_t crtc_mode_id = 0, crtc_active = 0;
+  uint32_t plane_fb_id = 0, plane_crtc_id = 0;
+  uint32_t plane_src_x = 0, plane_src_y = 0, plane_src_w = 0, plane_src_h = 0;
+  uint32_t plane_crtc_x = 0, plane_crtc_y = 0, plane_crtc_w = 0, plane_crtc_h = 0;
+
+  gbm_device*  gbm  = nullptr;
+  gbm_surface* surf = nullptr;
+  EGLDisplay   dpy  = EGL_NO_DISPLAY;
+  EGLContext   ctx  = EGL_NO_CONTEXT;
+  EGLSurface   egl_surf = EGL_NO_SURFACE;
+
+  // Scanout: `scanout` is on screen, `pending` committed and waiting for vblank
+  gbm_bo* scanout = nullptr;
+  gbm_bo* pending = nullptr;
+  bool    modeset = false;
+
+#ifdef HAVE_DRM_LEASE
+  wl_display*             display = nullptr;
+  wl_registry*            registry = nullptr;
+  wp_drm_lease_device_v1* lease_device = nullptr;
+  wp_drm_lease_v1*        lease = nullptr;
+#endif
+};
+static KmsCtx K;
+
+// ---- Lease (wp_drm_lease_v1) ----
+#ifdef HAVE_DRM_LEASE
+struct LeaseConnector {
+  wp_drm_lease_device_v1*    device = nullptr;
+  wp_drm_lease_connector_v1* conn = nullptr;
+  std::string name, description;
+  uint32_t id = 0;
+  bool withdrawn = false;
+};
+static std::vector<wp_drm_lease_device_v1*> lease_devices;
+static std::vector<LeaseConnector*> lease_connectors;
+
+static void lc_name(void* data, wp_drm_lease_connector_v1*, const char* name) {
+  static_cast<LeaseConnector*>(data)->name = name ? name : "";
+}
+static void lc_description(void* data, wp_drm_lease_connector_v1*, const char* d) {
+  static_cast<LeaseConnector*>(data)->description = d ? d : "";
+}
+static void lc_connector_id(void* data, wp_drm_lease_connector_v1*, uint32_t id) {
+  static_cast<LeaseConnector*>(data)->id = id;
+}
+static void lc_done(void*, wp_drm_lease_connector_v1*) {}
+static void lc_withdrawn(void* data, wp_drm_lease_connector_v1*) {
+  static_cast<LeaseConnector*>(data)->withdrawn = true;
+}
+static const wp_drm_lease_connector_v1_listener LC_LST = {
+  lc_name, lc_description, lc_connector_id, lc_done, lc_withdrawn
+};
+
+// The device's own (non-master) fd is not needed; the lease brings its own
+static void ld_drm_fd(void*, wp_drm_lease_device_v1*, int32_t fd) { close(fd); }
+static void ld_connector(void*, wp_drm_lease_device_v1* dev, wp_drm_lease_connector_v1* c) {
+  auto* lc = new LeaseConnector();
+  lc->device = dev;
+  lc->conn = c;
+  wp_drm_lease_connector_v1_add_listener(c, &LC_LST, lc);
+  lease_connectors.push_back(lc);
+}
+static void ld_done(void*, wp_drm_lease_device_v1*) {}
+static void ld_released(void*, wp_drm_lease_device_v1*) {}
+static const wp_drm_lease_device_v1_listener LD_LST = {
+  ld_drm_fd, ld_connector, ld_done, ld_released
+};
+
+static void lease_fd(void*, wp_drm_lease_v1*, int32_t fd) { K.fd = fd; }
+static void lease_finished(void*, wp_drm_lease_v1*) {
+  if (!K.closed) fprintf(stderr, "[kms] lease revoked by the compositor\n");
+  K.closed = true;
+}
+static const wp_drm_lease_v1_listener LEASE_LST = { lease_fd, lease_finished };
+
+static void reg_global(void*, wl_registry* reg, uint32_t name, const char* iface, uint32_t) {
+  if (std::strcmp(iface, wp_drm_lease_device_v1_interface.name) == 0) {
+    auto* dev = static_cast<wp_drm_lease_device_v1*>(
+        wl_registry_bind(reg, name, &wp_drm_lease_device_v1_interface, 1));
+    wp_drm_lease_device_v1_add_listener(dev, &LD_LST, nullptr);
+    lease_devices.push_back(dev);
+  }
+}
+static void reg_remove(void*, wl_registry*, uint32_t) {}
+static const wl_registry_listener REG_LST = { reg_global, reg_remove };
+
+static void free_lease_connectors() {
+  for (LeaseConnector* c : lease_connectors) {
+    wp_drm_lease_connector_v1_destroy(c->conn);
+    delete c;
+  }
+  lease_connectors.clear();
+}
+
+// $VITURE_KMS_CONNECTOR by name, else one that says it is the glasses, else
+// the first offered (compositors only offer non-desktop outputs, i.e. HMDs).
+static LeaseConnector* pick_lease_connector(const char* want) {
+  LeaseConnector* first = nullptr;
+  for (LeaseConnector* lc : lease_connectors) {
+    if (lc->withdrawn) continue;
+    fprintf(stdout, "[kms] leasable: %s (%s)\n", lc->name.c_str(), lc->description.c_str());
+    if (want && *want) {
+      if (lc->name == want) return lc;
+      continue;
+    }
+    if (lc->description.find("VITURE") != std::string::npos ||
+        lc->description.find("Viture") != std::string::npos)
+      return lc;
+    if (!first) first = lc;
+  }
+  return first;
+}
+
+static void acquire_lease(const char* want, uint32_t& connector_id) {
+  K.display = wl_display_connect(nullptr);
+  if (!K.display) throw std::runtime_error("kms: no Wayland display to request a DRM lease from");
+  K.registry = wl_display_get_registry(K.display);
+  wl_registry_add_listener(K.registry, &REG_LST, nullptr);
+  wl_display_roundtrip(K.display);   // globals
+  wl_display_roundtrip(K.display);   // devices' connectors
+  if (lease_devices.empty())
+    throw std::runtime_error("kms: compositor does not offer wp_drm_lease_device_v1");
+
+  LeaseConnector* lc = pick_lease_connector(want);
+  if (!lc) throw std::runtime_error(want && *want ? std::string("kms: connector ") + want + " not leasable"
+                                                  : "kms: no leasable connector");
+
+  wp_drm_lease_request_v1* req = wp_drm_lease_device_v1_create_lease_request(lc->device);
+  wp_drm_lease_request_v1_request_connector(req, lc->conn);
+  K.lease = wp_drm_lease_request_v1_submit(req);
+  wp_drm_lease_v1_add_listener(K.lease, &LEASE_LST, nullptr);
+  while (K.fd < 0 && !K.closed)
+    if (wl_display_dispatch(K.display) < 0) break;
+  if (K.fd < 0) throw std::runtime_error("kms: lease of " + lc->name + " refused");
+
+  connector_id = lc->id;
+  K.lease_device = lc->device;
+  K.leased = true;
+  fprintf(stdout, "[kms] leased %s (connector %u)\n", lc->name.c_str(), lc->id);
+  free_lease_connectors();
+}
+
+// Also the error path of acquire_lease (via kms_shutdown): frees whatever it
+// got to
+static void release_lease() {
+  if (K.lease) { wp_drm_lease_v1_destroy(K.lease); K.lease = nullptr; }
+  free_lease_connectors();
+  for (wp_drm_lease_device_v1* dev : lease_devices) wp_drm_lease_device_v1_release(dev);
+  lease_devices.clear();
+  K.lease_device = nullptr;
+  if (K.registry) { wl_registry_destroy(K.registry); K.registry = nullptr; }
+  if (K.display) { wl_display_roundtrip(K.display); wl_display_disconnect(K.display); K.display = nullptr; }
+}
+#endif
+
+// ---- KMS objects ----
+static uint32_t prop_id(uint32_t obj, uint32_t type, const char* name, uint64_t* value = nullptr) {
+  drmModeObjectProperties* props = drmModeObjectGetProperties(K.fd, obj, type);
+  if (!props) return 0;
+  uint32_t id = 0;
+  for (uint32_t i = 0; i < props->count_props && !id; ++i) {
+    drmModePropertyRes* p = drmModeGetProperty(K.fd, props->props[i]);
+    if (!p) continue;
+    if (std::strcmp(p->name, name) == 0) {
+      id = p->prop_id;
+      if (value) *value = props->prop_values[i];
+    }
+    drmModeFreeProperty(p);
+  }
+  drmModeFreeObjectProperties(props);
+  return id;
+}
+
+static std::string connector_name(const drmModeConnector* c) {
+  const char* type = drmModeGetConnectorTypeName(c->connector_type);
+  return std::string(type ? type : "Unknown") + "-" + std::to_string(c->connector_type_id);
+}
+
+// Preferred mode size at its highest refresh: less latency, same pixels
+static drmModeModeInfo pick_mode(const drmModeConnector* c) {
+  drmModeModeInfo best = c->modes[0];
+  for (int i = 0; i < c->count_modes; ++i)
+    if (c->modes[i].type & DRM_MODE_TYPE_PREFERRED) { best = c->modes[i]; break; }
+  for (int i = 0; i < c->count_modes; ++i) {
+    const drmModeModeInfo& m = c->modes[i];
+    if (m.hdisplay == best.hdisplay && m.vdisplay == best.vdisplay && m.vrefresh > best.vrefresh)
+      best = m;
+  }
+  return best;
+}
+
+// Connector (by lease id, name or first connected), its CRTC and primary plane
+static void setup_kms(uint32_t want_id, const char* want_name) {
+  if (drmSetClientCap(K.fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0 ||
+      drmSetClientCap(K.fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0)
+    throw std::runtime_error("kms: device has no atomic modesetting");
+
+  drmModeRes* res = drmModeGetResources(K.fd);
+  if (!res) throw std::runtime_error("kms: drmModeGetResources failed");
+
+  drmModeConnector* conn = nullptr;
+  for (int i = 0; i < res->count_connectors && !conn; ++i) {
+    drmModeConnector* c = drmModeGetConnector(K.fd, res->connectors[i]);
+    if (!c) continue;
+    const bool match = want_id ? c->connector_id == want_id
+                     : want_name && *want_name ? connector_name(c) == want_name
+                     : true;
+    if (match && c->connection == DRM_MODE_CONNECTED && c->count_modes > 0) conn = c;
+    else drmModeFreeConnector(c);
+  }
+  if (!conn) {
+    drmModeFreeResources(res);
+    throw std::runtime_error("kms: no connected connector");
+  }
+  K.connector = conn->connector_id;
+  K.mode = pick_mode(conn);
+
+  int crtc_index = -1;
+  for (int e = 0; e < conn->count_encoders && crtc_index < 0; ++e) {
+    drmModeEncoder* enc = drmModeGetEncoder(K.fd, conn->encoders[e]);
+    if (!enc) continue;
+    for (int i = 0; i < res->count_crtcs; ++i)
+      if (enc->possible_crtcs & (1u << i)) { crtc_index = i; break; }
+    drmModeFreeEncoder(enc);
+  }
+  const std::string cname = connector_name(conn);
+  drmModeFreeConnector(conn);
+  if (crtc_index < 0) {
+    drmModeFreeResources(res);
+    throw std::runtime_error("kms: no CRTC for " + cname);
+  }
+  K.crtc = res->crtcs[crtc_index];
+  drmModeFreeResources(res);
+
+  drmModePlaneRes* planes = drmModeGetPlaneResources(K.fd);
+  for (uint32_t i = 0; planes && i < planes->count_planes && !K.plane; ++i) {
+    drmModePlane* p = drmModeGetPlane(K.fd, planes->planes[i]);
+    if (!p) continue;
+    uint64_t type = 0;
+    if ((p->possible_crtcs & (1u << crtc_index)) &&
+        prop_id(p->plane_id, DRM_MODE_OBJECT_PLANE, "type", &type) && type == DRM_PLANE_TYPE_PRIMARY)
+      K.plane = p->plane_id;
+    drmModeFreePlane(p);
+  }
+  if (planes) drmModeFreePlaneResources(planes);
+  if (!K.plane) throw std::runtime_error("kms: no primary plane for " + cname);
+
+  K.conn_crtc_id  = prop_id(K.connector, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID");
+  K.crtc_mode_id  = prop_id(K.crtc, DRM_MODE_OBJECT_CRTC, "MODE_ID");
+  K.crtc_active   = prop_id(K.crtc, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+  K.plane_fb_id   = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "FB_ID");
+  K.plane_crtc_id = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "CRTC_ID");
+  K.plane_src_x   = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "SRC_X");
+  K.plane_src_y   = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+  K.plane_src_w   = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "SRC_W");
+  K.plane_src_h   = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "SRC_H");
+  K.plane_crtc_x  = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+  K.plane_crtc_y  = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+  K.plane_crtc_w  = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+  K.plane_crtc_h  = prop_id(K.plane, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+  if (!K.conn_crtc_id || !K.crtc_mode_id || !K.crtc_active || !K.plane_fb_id || !K.plane_crtc_id)
+    throw std::runtime_error("kms: missing atomic properties");
+  if (drmModeCreatePropertyBlob(K.fd, &K.mode, sizeof(K.mode), &K.mode_blob) != 0)
+    throw std::runtime_error("kms: mode blob failed");
+
+  if (!K.leased) K.saved_crtc = drmModeGetCrtc(K.fd, K.crtc);
+  fprintf(stdout, "[kms] %s: %ux%u@%u, crtc %u, plane %u\n", cname.c_str(), K.mode.hdisplay,
+          K.mode.vdisplay, K.mode.vrefresh, K.crtc, K.plane);
+}
+
+// ---- GBM + EGL ----
+static void setup_egl() {
+  K.gbm = gbm_create_device(K.fd);
+  if (!K.gbm) throw std::runtime_error("kms: gbm_create_device failed");
+  K.surf = gbm_surface_create(K.gbm, K.mode.hdisplay, K.mode.vdisplay, GBM_FORMAT_XRGB8888,
+                              GBM_BO_USE_SCANOUT | GBM_BO_USE_RENDERING);
+  if (!K.surf) throw std::runtime_error("kms: gbm_surface_create failed");
+
+  // Extension entry points: libglvnd's libEGL does not export them
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  auto create_surface =
+      (PFNEGLCREATEPLATFORMWINDOWSURFACEEXTPROC)eglGetProcAddress("eglCreatePlatformWindowSurfaceEXT");
+  if (!get_display || !create_surface) throw std::runtime_error("kms: EGL_EXT_platform_base missing");
+  K.dpy = get_display(EGL_PLATFORM_GBM_KHR, K.gbm, nullptr);
+  if (K.dpy == EGL_NO_DISPLAY || !eglInitialize(K.dpy, nullptr, nullptr))
+    throw std::runtime_error("kms: EGL on GBM unavailable");
+  if (!eglBindAPI(EGL_OPENGL_API)) throw std::runtime_error("kms: desktop GL unavailable");
+
+  const EGLint cfg_attrs[] = {
+    EGL_SURFACE_TYPE, EGL_WINDOW_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24,
+    EGL_NONE
+  };
+  EGLint n = 0;
+  eglChooseConfig(K.dpy, cfg_attrs, nullptr, 0, &n);
+  std::vector<EGLConfig> cfgs(n > 0 ? n : 0);
+  if (n > 0) eglChooseConfig(K.dpy, cfg_attrs, cfgs.data(), n, &n);
+  EGLConfig cfg = nullptr;
+  for (EGLConfig c : cfgs) {
+    EGLint visual = 0;
+    if (eglGetConfigAttrib(K.dpy, c, EGL_NATIVE_VISUAL_ID, &visual) && visual == GBM_FORMAT_XRGB8888) {
+      cfg = c;
+      break;
+    }
+  }
+  if (!cfg) throw std::runtime_error("kms: no EGL config for XRGB8888 scanout");
+
+  // Same context as the GLFW backend: 3.3 compatibility (fixed-function bits)
+  const EGLint ctx_attrs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_NONE
+  };
+  K.ctx = eglCreateContext(K.dpy, cfg, EGL_NO_CONTEXT, ctx_attrs);
+  if (K.ctx == EGL_NO_CONTEXT) throw std::runtime_error("kms: eglCreateContext failed");
+  K.egl_surf = create_surface(K.dpy, cfg, K.surf, nullptr);
+  if (K.egl_surf == EGL_NO_SURFACE) throw std::runtime_error("kms: EGL window surface failed");
+  if (!eglMakeCurrent(K.dpy, K.egl_surf, K.egl_surf, K.ctx))
+    throw std::runtime_error("kms: eglMakeCurrent failed");
+}
+
+// ---- Page flips ----
+static void destroy_fb(gbm_bo*, void* data) {
+  const uint32_t fb = uint32_t(uintptr_t(data));
+  if (fb && K.fd >= 0) drmModeRmFB(K.fd, fb);
+}
+
+// KMS framebuffer for a surface buffer, created once and kept on the bo
+static uint32_t bo_fb(gbm_bo* bo) {
+  if (void* d = gbm_bo_get_user_data(bo)) return uint32_t(uintptr_t(d));
+  uint32_t handles[4] = {}, pitches[4] = {}, offsets[4] = {};
+  uint64_t mods[4] = {};
+  const uint64_t mod = gbm_bo_get_modifier(bo);
+  const int planes = gbm_bo_get_plane_count(bo);
+  for (int i = 0; i < planes && i < 4; ++i) {
+    handles[i] = gbm_bo_get_handle_for_plane(bo, i).u32;
+    pitches[i] = gbm_bo_get_stride_for_plane(bo, i);
+    offsets[i] = gbm_bo_get_offset(bo, i);
+    mods[i] = mod;
+  }
+  uint32_t fb = 0;
+  const int r = mod != DRM_FORMAT_MOD_INVALID
+    ? drmModeAddFB2WithModifiers(K.fd, gbm_bo_get_width(bo), gbm_bo_get_height(bo),
+                                 gbm_bo_get_format(bo), handles, pitches, offsets, mods, &fb,
+                                 DRM_MODE_FB_MODIFIERS)
+    : drmModeAddFB2(K.fd, gbm_bo_get_width(bo), gbm_bo_get_height(bo), gbm_bo_get_format(bo),
+                    handles, pitches, offsets, &fb, 0);
+  if (r != 0) {
+    fprintf(stderr, "[kms] drmModeAddFB2: %s\n", std::strerror(errno));
+    return 0;
+  }
+  gbm_bo_set_user_data(bo, (void*)uintptr_t(fb), destroy_fb);
+  return fb;
+}
+
+static void on_flip(int, unsigned, unsigned, unsigned, unsigned, void*) {
+  if (K.scanout) gbm_surface_release_buffer(K.surf, K.scanout);
+  K.scanout = K.pending;
+  K.pending = nullptr;
+}
+
+// Handle flip events for up to timeout_ms (< 0: until the pending flip lands)
+static void wait_flip(int timeout_ms) {
+  drmEventContext ev{};
+  ev.version = DRM_EVENT_CONTEXT_VERSION;
+  ev.page_flip_handler2 = on_flip;
+  while (K.pending) {
+    pollfd pfd{ K.fd, POLLIN, 0 };
+    const int r = poll(&pfd, 1, timeout_ms < 0 ? 1000 : timeout_ms);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) {
+      if (timeout_ms < 0) {
+        // No vblank for a second: the display is gone, don't hang the loop
+        fprintf(stderr, "[kms] page flip timed out\n");
+        K.closed = true;
+        on_flip(0, 0, 0, 0, 0, nullptr);
+      }
+      return;
+    }
+    drmHandleEvent(K.fd, &ev);
+  }
+}
+
+static void add_prop(drmModeAtomicReq* req, uint32_t obj, uint32_t prop, uint64_t value) {
+  if (prop) drmModeAtomicAddProperty(req, obj, prop, value);
+}
+
+// ---- Backend ----
+static void kms_shutdown();
+
+static void kms_init(int, int, const char*, const char* arg) {
+  const char* want = std::getenv("VITURE_KMS_CONNECTOR");
+  uint32_t connector_id = 0;
+  try {
+    if (arg && *arg) {
+      K.fd = open(arg, O_RDWR | O_CLOEXEC);
+      if (K.fd < 0) throw std::runtime_error(std::string("kms: ") + arg + ": " + std::strerror(errno));
+    } else {
+#ifdef HAVE_DRM_LEASE
+      acquire_lease(want, connector_id);
+#else
+      throw std::runtime_error("kms: built without drm-lease-v1; use kms:/dev/dri/cardN");
+#endif
+    }
+    setup_kms(connector_id, want);
+    setup_egl();
+  } catch (...) {
+    kms_shutdown();
+    throw;
+  }
+}
+
+static bool kms_should_close() { return K.closed; }
+
+static void kms_poll() {
+  wait_flip(0);
+#ifdef HAVE_DRM_LEASE
+  if (!K.display) return;
+  while (wl_display_prepare_read(K.display) != 0)
+    wl_display_dispatch_pending(K.display);
+  wl_display_flush(K.display);
+  pollfd pfd{ wl_display_get_fd(K.display), POLLIN, 0 };
+  if (poll(&pfd, 1, 0) > 0) wl_display_read_events(K.display);
+  else wl_display_cancel_read(K.display);
+  if (wl_display_dispatch_pending(K.display) < 0) K.closed = true;
+#endif
+}
+
+// One flip in flight: the previous one must land (at vblank) before the next
+// commit, which paces the loop to the display refresh.
+static void kms_swap() {
+  if (K.closed) return;
+  if (!eglSwapBuffers(K.dpy, K.egl_surf)) {
+    fprintf(stderr, "[kms] eglSwapBuffers failed (0x%x)\n", eglGetError());
+    return;
+  }
+  gbm_bo* bo = gbm_surface_lock_front_buffer(K.surf);
+  if (!bo) return;
+  const uint32_t fb = bo_fb(bo);
+  if (!fb) { gbm_surface_release_buffer(K.surf, bo); return; }
+  wait_flip(-1);
+
+  drmModeAtomicReq* req = drmModeAtomicAlloc();
+  uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK;
+  if (!K.modeset) {
+    const uint32_t w = K.mode.hdisplay, h = K.mode.vdisplay;
+    add_prop(req, K.connector, K.conn_crtc_id, K.crtc);
+    add_prop(req, K.crtc, K.crtc_mode_id, K.mode_blob);
+    add_prop(req, K.crtc, K.crtc_active, 1);
+    add_prop(req, K.plane, K.plane_crtc_id, K.crtc);
+    add_prop(req, K.plane, K.plane_src_x, 0);
+    add_prop(req, K.plane, K.plane_src_y, 0);
+    add_prop(req, K.plane, K.plane_src_w, uint64_t(w) << 16);
+    add_prop(req, K.plane, K.plane_src_h, uint64_t(h) << 16);
+    add_prop(req, K.plane, K.plane_crtc_x, 0);
+    add_prop(req, K.plane, K.plane_crtc_y, 0);
+    add_prop(req, K.plane, K.plane_crtc_w, w);
+    add_prop(req, K.plane, K.plane_crtc_h, h);
+    flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_ALLOW_MODESET;
+  }
+  add_prop(req, K.plane, K.plane_fb_id, fb);
+  const int r = drmModeAtomicCommit(K.fd, req, flags, nullptr);
+  drmModeAtomicFree(req);
+  if (r != 0) {
+    fprintf(stderr, "[kms] atomic commit: %s\n", std::strerror(errno));
+    gbm_surface_release_buffer(K.surf, bo);
+    if (!K.modeset) K.closed = true;   // the mode itself was refused
+    return;
+  }
+  K.modeset = true;
+  K.pending = bo;
+}
+
+static void kms_framebuffer_size(int* w, int* h) {
+  *w = K.mode.hdisplay;
+  *h = K.mode.vdisplay;
+}
+
+static void kms_shutdown() {
+  if (K.fd >= 0 && K.pending) wait_flip(-1);
+  if (K.saved_crtc) {
+    // Direct mode: give the CRTC back the way we found it
+    drmModeSetCrtc(K.fd, K.saved_crtc->crtc_id, K.saved_crtc->buffer_id, K.saved_crtc->x,
+                   K.saved_crtc->y, &K.connector, 1, &K.saved_crtc->mode);
+    drmModeFreeCrtc(K.saved_crtc);
+    K.saved_crtc = nullptr;
+  }
+  if (K.dpy != EGL_NO_DISPLAY) {
+    eglMakeCurrent(K.dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (K.egl_surf != EGL_NO_SURFACE) eglDestroySurface(K.dpy, K.egl_surf);
+    if (K.ctx != EGL_NO_CONTEXT) eglDestroyContext(K.dpy, K.ctx);
+    eglTerminate(K.dpy);
+  }
+  K.dpy = EGL_NO_DISPLAY; K.ctx = EGL_NO_CONTEXT; K.egl_surf = EGL_NO_SURFACE;
+  if (K.surf) {
+    if (K.scanout) gbm_surface_release_buffer(K.surf, K.scanout);
+    gbm_surface_destroy(K.surf);   // frees the bos and with them their fbs
+  }
+  K.scanout = K.pending = nullptr;
+  K.surf = nullptr;
+  if (K.gbm) { gbm_device_destroy(K.gbm); K.gbm = nullptr; }
+  if (K.mode_blob) { drmModeDestroyPropertyBlob(K.fd, K.mode_blob); K.mode_blob = 0; }
+  if (K.fd >= 0) { close(K.fd); K.fd = -1; }
+#ifdef HAVE_DRM_LEASE
+  release_lease();   // revokes the lease: the compositor takes the connector back
+#endif
+  K.modeset = false;
+}
+
+static EGLDisplay kms_egl_display() { return K.dpy; }
+static int kms_refresh_hz() { return int(K.mode.vrefresh); }
+
+const PlatformBackend* platform_kms() {
+  static const PlatformBackend b = {
+    "kms", kms_init, kms_should_close, kms_poll, kms_swap, kms_framebuffer_size, kms_shutdown,
+    kms_egl_display, kms_refresh_hz
+  };
+  return &b;
+}
@@ -0,0 +1,154 @@
+// Headless backends: no window, the frame goes to an FBO that stands in for
+// the default framebuffer. "surfaceless" uses EGL_MESA_platform_surfaceless
+// (any Mesa driver, llvmpipe included); "gbm" uses EGL on a GBM render node,
+// i.e. a specific GPU. Swap waits for the GPU (glFinish), so frame times are
+// the full render cost without compositor or vblank interference.
+#include "platform_backend.hpp"
+#include "offscreen_target.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <fcntl.h>
+#include <gbm.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+struct OffscreenCtx {
+  int          fd  = -1;        // gbm: render node
+  gbm_device*  gbm = nullptr;
+  EGLDisplay   dpy = EGL_NO_DISPLAY;
+  EGLContext   ctx = EGL_NO_CONTEXT;
+  OffscreenTarget target;       // stands in for the default framebuffer
+  long         frames = 0, max_frames = 0;   // $VITURE_HEADLESS_FRAMES, 0 = unlimited
+};
+static OffscreenCtx O;
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) { stop_requested = 1; }
+
+static void make_context(EGLenum platform, void* native) {
+  // Extension entry point: libglvnd's libEGL does not export it
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (!get_display) throw std::runtime_error("offscreen: EGL_EXT_platform_base missing");
+  O.dpy = get_display(platform, native, nullptr);
+  if (O.dpy == EGL_NO_DISPLAY || !eglInitialize(O.dpy, nullptr, nullptr))
+    throw std::runtime_error("offscreen: eglInitialize failed");
+  const char* exts = eglQueryString(O.dpy, EGL_EXTENSIONS);
+  if (!exts || !std::strstr(exts, "EGL_KHR_surfaceless_context"))
+    throw std::runtime_error("offscreen: EGL_KHR_surfaceless_context missing");
+  if (!eglBindAPI(EGL_OPENGL_API)) throw std::runtime_error("offscreen: desktop GL unavailable");
+
+  const EGLint cfg_attrs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+  EGLConfig cfg = nullptr;
+  EGLint n = 0;
+  eglChooseConfig(O.dpy, cfg_attrs, &cfg, 1, &n);   // may be none: no-config context below
+  const EGLint ctx_attrs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_NONE
+  };
+  O.ctx = eglCreateContext(O.dpy, n > 0 ? cfg : (EGLConfig)nullptr, EGL_NO_CONTEXT, ctx_attrs);
+  if (O.ctx == EGL_NO_CONTEXT) throw std::runtime_error("offscreen: eglCreateContext failed");
+  if (!eglMakeCurrent(O.dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, O.ctx))
+    throw std::runtime_error("offscreen: eglMakeCurrent failed");
+}
+
+// Colour + depth target bound in place of the default framebuffer
+static void make_target(int w, int h) {
+  if (!target_ensure(O.target, w, h)) throw std::runtime_error("offscreen: framebuffer incomplete");
+  target_bind(O.target);
+}
+
+static void offscreen_shutdown();
+
+static void offscreen_setup(int w, int h, EGLenum platform, void* native) {
+  try {
+    make_context(platform, native);
+    make_target(w, h);
+  } catch (...) {
+    offscreen_shutdown();
+    throw;
+  }
+  const char* frames = std::getenv("VITURE_HEADLESS_FRAMES");
+  O.max_frames = frames ? std::atol(frames) : 0;
+  O.frames = 0;
+  stop_requested = 0;
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+  fprintf(stdout, "[platform] offscreen %dx%d on %s\n", w, h,
+          reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+static void surfaceless_init(int w, int h, const char*, const char*) {
+  offscreen_setup(w, h, EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY);
+}
+
+// arg: render node, default the first one
+static void gbm_init(int w, int h, const char*, const char* arg) {
+  const char* path = arg && *arg ? arg : "/dev/dri/renderD128";
+  O.fd = open(path, O_RDWR | O_CLOEXEC);
+  if (O.fd < 0) throw std::runtime_error(std::string("gbm: ") + path + ": " + std::strerror(errno));
+  O.gbm = gbm_create_device(O.fd);
+  if (!O.gbm) {
+    offscreen_shutdown();
+    throw std::runtime_error(std::string("gbm: gbm_create_device failed on ") + path);
+  }
+  offscreen_setup(w, h, EGL_PLATFORM_GBM_KHR, O.gbm);
+}
+
+static bool offscreen_should_close() {
+  return stop_requested || (O.max_frames > 0 && O.frames >= O.max_frames);
+}
+static void offscreen_poll() {}
+
+static void offscreen_swap() {
+  glFinish();
+  ++O.frames;
+}
+
+static void offscreen_framebuffer_size(int* w, int* h) { *w = O.target.w; *h = O.target.h; }
+
+static void offscreen_shutdown() {
+  if (O.ctx != EGL_NO_CONTEXT) {
+    target_free(O.target);
+    eglMakeCurrent(O.dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(O.dpy, O.ctx);
+  }
+  O.target = OffscreenTarget{};
+  O.ctx = EGL_NO_CONTEXT;
+  if (O.dpy != EGL_NO_DISPLAY) eglTerminate(O.dpy);
+  O.dpy = EGL_NO_DISPLAY;
+  if (O.gbm) { gbm_device_destroy(O.gbm); O.gbm = nullptr; }
+  if (O.fd >= 0) { close(O.fd); O.fd = -1; }
+}
+
+static EGLDisplay offscreen_egl_display() { return O.dpy; }
+static int offscreen_refresh_hz() { return 0; }
+
+const PlatformBackend* platform_surfaceless() {
+  static const PlatformBackend b = {
+    "surfaceless", surfaceless_init, offscreen_should_close, offscreen_poll, offscreen_swap,
+    offscreen_framebuffer_size, offscreen_shutdown, offscreen_egl_display, offscreen_refresh_hz
+  };
+  return &b;
+}
+
+const PlatformBackend* platform_gbm() {
+  static const PlatformBackend b = {
+    "gbm", gbm_init, offscreen_should_close, offscreen_poll, offscreen_swap,
+    offscreen_framebuffer_size, offscreen_shutdown, offscreen_egl_display, offscreen_refresh_hz
+  };
+  return &b;
+}
@@ -0,0 +1,115 @@
+#include "png_io.hpp"
+
+#include <zlib.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+static void put_be32(std::vector<uint8_t>& b, uint32_t v) {
+  const uint8_t x[4] = { uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v) };
+  b.insert(b.end(), x, x + 4);
+}
+static uint32_t be32(const uint8_t* p) {
+  return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+}
+
+static void chunk(std::vector<uint8_t>& png, const char* type, const uint8_t* data, size_t len) {
+  put_be32(png, uint32_t(len));
+  const size_t start = png.size();
+  png.insert(png.end(), type, type + 4);
+  if (len) png.insert(png.end(), data, data + len);
+  put_be32(png, uint32_t(crc32(0L, &png[start], uInt(len + 4))));
+}
+
+bool png_write_rgba(const std::string& path, const uint8_t* px, int w, int h, bool bottom_up) {
+  if (w <= 0 || h <= 0) return false;
+  const size_t row = size_t(w) * 4;
+  std::vector<uint8_t> filtered((row + 1) * h);
+  for (int y = 0; y < h; ++y) {
+    uint8_t* dst = &filtered[(row + 1) * y];
+    dst[0] = 0;   // filter: none
+    std::memcpy(dst + 1, px + row * (bottom_up ? h - 1 - y : y), row);
+  }
+  uLongf zlen = compressBound(uLong(filtered.size()));
+  std::vector<uint8_t> z(zlen);
+  if (compress2(z.data(), &zlen, filtered.data(), uLong(filtered.size()), 6) != Z_OK)
+    return false;
+
+  std::vector<uint8_t> png(SIGNATURE, SIGNATURE + 8);
+  std::vector<uint8_t> ihdr;
+  put_be32(ihdr, uint32_t(w));
+  put_be32(ihdr, uint32_t(h));
+  const uint8_t rest[5] = { 8, 6, 0, 0, 0 };   // 8 bit, RGBA, deflate, filter 0, no interlace
+  ihdr.insert(ihdr.end(), rest, rest + 5);
+  chunk(png, "IHDR", ihdr.data(), ihdr.size());
+  chunk(png, "IDAT", z.data(), zlen);
+  chunk(png, "IEND", nullptr, 0);
+
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = std::fwrite(png.data(), 1, png.size(), f) == png.size();
+  return std::fclose(f) == 0 && ok;
+}
+
+static uint8_t paeth(int a, int b, int c) {
+  const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  return uint8_t(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+bool png_read_rgba(const std::string& path, std::vector<uint8_t>& px, int& w, int& h) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) return false;
+  std::vector<uint8_t> file;
+  uint8_t buf[65536];
+  for (size_t n; (n = std::fread(buf, 1, sizeof buf, f)) > 0;) file.insert(file.end(), buf, buf + n);
+  std::fclose(f);
+  if (file.size() < 8 || std::memcmp(file.data(), SIGNATURE, 8) != 0) return false;
+
+  std::vector<uint8_t> z;
+  w = h = 0;
+  for (size_t p = 8; p + 12 <= file.size();) {
+    const uint32_t len = be32(&file[p]);
+    if (p + 12 + len > file.size()) return false;
+    const uint8_t* type = &file[p + 4];
+    const uint8_t* data = &file[p + 8];
+    if (!std::memcmp(type, "IHDR", 4)) {
+      if (len < 13 || data[8] != 8 || data[9] != 6 || data[12] != 0) return false;
+      w = int(be32(data));
+      h = int(be32(data + 4));
+    } else if (!std::memcmp(type, "IDAT", 4)) {
+      z.insert(z.end(), data, data + len);
+    } else if (!std::memcmp(type, "IEND", 4)) {
+      break;
+    }
+    p += 12 + len;
+  }
+  if (w <= 0 || h <= 0) return false;
+
+  const size_t row = size_t(w) * 4;
+  std::vector<uint8_t> raw((row + 1) * h);
+  uLongf raw_len = uLongf(raw.size());
+  if (uncompress(raw.data(), &raw_len, z.data(), uLong(z.size())) != Z_OK || raw_len != raw.size())
+    return false;
+
+  px.resize(row * h);
+  for (int y = 0; y < h; ++y) {
+    const uint8_t* in = &raw[(row + 1) * y];
+    uint8_t* out = &px[row * y];
+    const uint8_t* up = y ? out - row : nullptr;
+    for (size_t x = 0; x < row; ++x) {
+      const int a = x >= 4 ? out[x - 4] : 0, b = up ? up[x] : 0, c = up && x >= 4 ? up[x - 4] : 0;
+      const uint8_t v = in[1 + x];
+      switch (in[0]) {
+        case 0: out[x] = v; break;
+        case 1: out[x] = uint8_t(v + a); break;
+        case 2: out[x] = uint8_t(v + b); break;
+        case 3: out[x] = uint8_t(v + (a + b) / 2); break;
+        case 4: out[x] = uint8_t(v + paeth(a, b, c)); break;
+        default: return false;
+      }
+    }
+  }
+  return true;
+}
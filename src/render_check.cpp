@@ -0,0 +1,187 @@
+#include "render_check.hpp"
+#include "pixel_convert.hpp"
+#include "png_io.hpp"
+
+#include <GL/gl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+static const int    CHANNEL_TOLERANCE = 8;      // levels of 255
+static const long   BAD_PIXELS_PER_MILLE = 1;   // of the frame
+static const double TIME_SLACK = 1.5;
+
+static const uint32_t palette[] = {
+  0xd04040, 0x40a040, 0x4060d0, 0xd0a030, 0x9040c0, 0x30b0b0, 0xc06090
+};
+
+// Output i: a checkerboard in its own colour, a 1 px white grid every 128 px,
+// i+1 white bars top left and a grey ramp along the bottom, so panel order,
+// orientation, cropping and minification all show in the frame. 0x00RRGGBB.
+static uint32_t pattern(int i, int x, int y, int w, int h) {
+  if (y >= h - h / 8) {
+    const uint32_t g = uint32_t(255 * x / std::max(1, w - 1));
+    return g << 16 | g << 8 | g;
+  }
+  if (x % 128 == 0 || y % 128 == 0) return 0xffffff;
+  if (y >= 32 && y < 96 && x >= 32 && x < 32 + 48 * (i + 1) && (x - 32) % 48 < 32)
+    return 0xffffff;
+  const uint32_t c = palette[i % 7];
+  return ((x / 64 + y / 64) & 1) ? c : (c >> 1) & 0x7f7f7f;
+}
+
+static uint32_t swap_rb(uint32_t c) {
+  return (c & 0xff00ff00) | (c & 0xff) << 16 | (c >> 16 & 0xff);
+}
+
+double rcheck_make_outputs(int n, int w, int h, std::vector<CapturedOutput>& outs) {
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<uint32_t> src(size_t(w) * h), dst(size_t(w) * h);
+  outs.clear();
+  for (int i = 0; i < n; ++i) {
+    // Alternate the two 8-bit channel orders compositors hand out
+    const bool bgr = i % 2;
+    for (int y = 0; y < h; ++y)
+      for (int x = 0; x < w; ++x) {
+        const uint32_t c = pattern(i, x, y, w, h);
+        src[size_t(y) * w + x] = bgr ? swap_rb(c) : c;
+      }
+    const PixelLayout layout = bgr ? PixelLayout::XBGR8888 : PixelLayout::XRGB8888;
+    for (int y = 0; y < h; ++y)
+      pixel_convert_row(layout, &src[size_t(y) * w], &dst[size_t(y) * w], w);
+
+    CapturedOutput o;
+    glGenTextures(1, &o.texture);
+    glBindTexture(GL_TEXTURE_2D, o.texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_BGRA, GL_UNSIGNED_BYTE, dst.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    o.width = o.tex_w = o.src_w = w;
+    o.height = o.tex_h = o.src_h = h;
+    o.x = i * w;
+    o.dirty_y0 = 0;
+    o.dirty_y1 = h;
+    o.name = "check-" + std::to_string(i);
+    outs.push_back(o);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glFinish();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void rcheck_free_outputs(std::vector<CapturedOutput>& outs) {
+  for (CapturedOutput& o : outs)
+    if (o.texture) glDeleteTextures(1, &o.texture);
+  outs.clear();
+}
+
+bool rcheck_compare(const std::string& dir, const std::string& name, int w, int h,
+                    bool update, std::string& msg) {
+  std::vector<uint8_t> px(size_t(w) * h * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, px.data());
+
+  const std::string golden = dir + "/" + name + ".png";
+  std::vector<uint8_t> ref;
+  int gw = 0, gh = 0;
+  if (update) {
+    if (!png_write_rgba(golden, px.data(), w, h, true)) {
+      msg = "cannot write " + golden;
+      return false;
+    }
+    msg = "golden written";
+    return true;
+  }
+  if (access(golden.c_str(), F_OK) != 0) {
+    // A missing golden is a failure, not a silent pass: it would otherwise
+    // hide a renamed scenario or a checkout without the goldens
+    const std::string actual = dir + "/" + name + ".actual.png";
+    msg = "no golden " + golden;
+    if (png_write_rgba(actual, px.data(), w, h, true)) msg += ", frame kept as " + actual;
+    msg += " (VITURE_RENDER_CHECK_UPDATE=1 records it)";
+    return false;
+  }
+  if (!png_read_rgba(golden, ref, gw, gh)) {
+    msg = "cannot read " + golden;
+    return false;
+  }
+
+  char buf[128];
+  bool ok = false;
+  if (gw != w || gh != h) {
+    snprintf(buf, sizeof buf, "size %dx%d, golden %dx%d", w, h, gw, gh);
+  } else {
+    const size_t row = size_t(w) * 4;
+    long bad = 0;
+    int worst = 0;
+    for (int y = 0; y < h; ++y) {
+      const uint8_t* a = &px[row * (h - 1 - y)];   // glReadPixels is bottom-up
+      const uint8_t* b = &ref[row * y];
+      for (int x = 0; x < w; ++x, a += 4, b += 4) {
+        int d = 0;
+        for (int c = 0; c < 3; ++c) d = std::max(d, std::abs(int(a[c]) - int(b[c])));
+        worst = std::max(worst, d);
+        bad += d > CHANNEL_TOLERANCE;
+      }
+    }
+    ok = bad <= long(w) * h * BAD_PIXELS_PER_MILLE / 1000;
+    snprintf(buf, sizeof buf, "%ld pixels off, largest difference %d", bad, worst);
+  }
+  msg = buf;
+  if (!ok) {
+    const std::string actual = dir + "/" + name + ".actual.png";
+    if (png_write_rgba(actual, px.data(), w, h, true)) msg += ", see " + actual;
+  }
+  return ok;
+}
+
+static std::map<std::string, double> baselines;
+static bool baselines_loaded = false, baselines_dirty = false;
+
+bool rcheck_time(const std::string& dir, const std::string& name, double us, double ref_us,
+                 bool gate, bool update, std::string& msg) {
+  if (!baselines_loaded) {
+    std::ifstream in(dir + "/timings");
+    std::string key;
+    double v;
+    while (in >> key >> v) baselines[key] = v;
+    baselines_loaded = true;
+  }
+  // Relative to the reference scenario of the same run: absolute times say
+  // more about the machine (and llvmpipe's vector width) than the renderer
+  const double ratio = ref_us > 0 ? us / ref_us : 0;
+  char buf[160];
+  auto it = baselines.find(name);
+  if (update) {
+    baselines[name] = ratio;
+    baselines_dirty = true;
+    snprintf(buf, sizeof buf, "%.0f us, %.2fx, baseline recorded", us, ratio);
+    msg = buf;
+    return true;
+  }
+  if (it == baselines.end()) {
+    snprintf(buf, sizeof buf, "%.0f us, %.2fx, no baseline (VITURE_RENDER_CHECK_UPDATE=1 records it)",
+             us, ratio);
+    msg = buf;
+    return !gate;
+  }
+  snprintf(buf, sizeof buf, "%.0f us, %.2fx, baseline %.2fx", us, ratio, it->second);
+  msg = buf;
+  return !gate || ratio <= it->second * TIME_SLACK;
+}
+
+void rcheck_finish(const std::string& dir) {
+  if (!baselines_dirty) return;
+  std::ofstream out(dir + "/timings");
+  out << std::fixed << std::setprecision(3);
+  for (const auto& b : baselines) out << b.first << ' ' << b.second << '\n';
+  if (!out) fprintf(stderr, "[check] cannot write %s/timings\n", dir.c_str());
+  baselines_dirty = false;
+}
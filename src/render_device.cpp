@@ -0,0 +1,110 @@
+#include "render_device.hpp"
+#include "platform.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <fcntl.h>
+#include <gbm.h>
+#include <unistd.h>
+#include <xf86drm.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static bool        have_main = false;
+static dev_t       main_dev  = 0;
+static int         fd   = -1;
+static gbm_device* gbm  = nullptr;
+static int         refs = 0;
+static std::string path;
+
+void render_device_set_main(dev_t dev) {
+  main_dev = dev;
+  have_main = true;
+}
+
+static std::string render_node_of(drmDevice* d) {
+  return d && (d->available_nodes & (1 << DRM_NODE_RENDER)) ? d->nodes[DRM_NODE_RENDER] : "";
+}
+
+static std::string node_for_dev(dev_t dev) {
+  drmDevice* d = nullptr;
+  if (drmGetDeviceFromDevId(dev, 0, &d) != 0) return "";
+  std::string p = render_node_of(d);
+  drmFreeDevice(&d);
+  return p;
+}
+
+// Render node of the device the GL context runs on
+static std::string egl_node() {
+  EGLDisplay dpy = platform_egl_display();
+  auto query_display = (PFNEGLQUERYDISPLAYATTRIBEXTPROC)eglGetProcAddress("eglQueryDisplayAttribEXT");
+  auto query_string = (PFNEGLQUERYDEVICESTRINGEXTPROC)eglGetProcAddress("eglQueryDeviceStringEXT");
+  if (dpy == EGL_NO_DISPLAY || !query_display || !query_string) return "";
+  EGLAttrib dev = 0;
+  if (!query_display(dpy, EGL_DEVICE_EXT, &dev) || !dev) return "";
+  const char* p = query_string((EGLDeviceEXT)dev, EGL_DRM_RENDER_NODE_FILE_EXT);
+  return p ? p : "";
+}
+
+static std::string first_node() {
+  drmDevice* devs[16];
+  const int n = drmGetDevices2(0, devs, 16);
+  std::string p;
+  for (int i = 0; i < n && p.empty(); ++i) p = render_node_of(devs[i]);
+  if (n > 0) drmFreeDevices(devs, n);
+  return p;
+}
+
+static bool open_device() {
+  const char* env = std::getenv("VITURE_RENDER_NODE");
+  const std::string gl = egl_node();
+  std::string p, why;
+  if (env && *env)                                      { p = env; why = "VITURE_RENDER_NODE"; }
+  else if (have_main && !(p = node_for_dev(main_dev)).empty()) why = "compositor main device";
+  else if (!(p = gl).empty())                           why = "GL device";
+  else if (!(p = first_node()).empty())                 why = "first render node";
+  if (p.empty()) {
+    fprintf(stderr, "[capture] no DRM render node found\n");
+    return false;
+  }
+
+  fd = open(p.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "[capture] %s: %s\n", p.c_str(), std::strerror(errno));
+    return false;
+  }
+  gbm = gbm_create_device(fd);
+  if (!gbm) {
+    fprintf(stderr, "[capture] gbm_create_device failed on %s\n", p.c_str());
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  path = p;
+  fprintf(stdout, "[capture] render node %s (%s)\n", p.c_str(), why.c_str());
+  if (!gl.empty() && gl != p)
+    fprintf(stderr, "[capture] GL renders on %s, not %s: dma-bufs cross devices "
+                    "(copies or failed imports; set VITURE_RENDER_NODE)\n", gl.c_str(), p.c_str());
+  return true;
+}
+
+gbm_device* render_device_acquire() {
+  if (!gbm && !open_device()) return nullptr;
+  ++refs;
+  return gbm;
+}
+
+void render_device_release() {
+  if (refs <= 0 || --refs > 0) return;
+  gbm_device_destroy(gbm);
+  gbm = nullptr;
+  close(fd);
+  fd = -1;
+  path.clear();
+}
+
+const char* render_device_path() { return path.c_str(); }
@@ -0,0 +1,57 @@
+#include "render_scale.hpp"
+#include "offscreen_target.hpp"
+
+#include <GL/gl.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static float scale = 1.0f;
+static float load_factor = 1.0f;
+
+static OffscreenTarget target;   // scene
+
+// Current frame
+static int    win_w = 0, win_h = 0;
+static bool   active = false;
+
+void  rscale_set(float s) { scale = std::clamp(s, 0.5f, 2.0f); }
+float rscale() { return scale; }
+void  rscale_set_load_factor(float f) { load_factor = std::clamp(f, 0.25f, 1.0f); }
+float rscale_effective() { return std::max(0.5f, scale * load_factor); }
+
+bool rscale_begin(int w, int h, int& sw, int& sh) {
+  active = false;
+  sw = w; sh = h;
+  const float s = rscale_effective();
+  if (std::fabs(s - 1.0f) < 0.01f || w <= 0 || h <= 0) {
+    // Nothing to resolve: free the target instead of keeping it around
+    if (target.fbo) target_free(target);
+    return false;
+  }
+  const int tw = std::max(1, int(w * s + 0.5f)), th = std::max(1, int(h * s + 0.5f));
+  if (tw != target.w || th != target.h) {
+    if (!target_ensure(target, tw, th)) {
+      fprintf(stderr, "[rscale] no %dx%d scene target (size limit or incomplete), scale 1\n", tw, th);
+      scale = 1.0f;
+      return false;
+    }
+    fprintf(stdout, "[rscale] scene target %dx%d\n", tw, th);
+  }
+  win_w = w; win_h = h;
+  sw = tw; sh = th;
+  active = true;
+  target_bind(target);
+  return true;
+}
+
+// Linear blit: a bilinear upscale below 1; at 2 every window pixel lands on
+// the centre of a 2x2 block, so it is a box filter. Between 1 and 2 it
+// undersamples slightly, which is still sharper than drawing at 1.
+void rscale_end() {
+  if (!active) return;
+  target_blit_to_prev(target, win_w, win_h);
+  active = false;
+}
+
+void rscale_shutdown() { target_free(target); }
@@ -0,0 +1,190 @@
+#include "session_state.hpp"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using Section = std::map<std::string, std::string>;
+using StateFile = std::map<std::string, Section>;
+
+// ---- helpers ----
+static std::string state_dir() {
+  const char* xdg = std::getenv("XDG_STATE_HOME");
+  if (xdg && *xdg) return std::string(xdg) + "/viture";
+  const char* home = std::getenv("HOME");
+  if (home && *home) return std::string(home) + "/.local/state/viture";
+  return std::string();
+}
+
+static std::string state_path() {
+  std::string d = state_dir();
+  return d.empty() ? d : d + "/state";
+}
+
+// mkdir -p
+static bool make_dirs(const std::string& dir) {
+  for (size_t p = 1; p <= dir.size(); ++p) {
+    if (p != dir.size() && dir[p] != '/') continue;
+    std::string sub = dir.substr(0, p);
+    if (::mkdir(sub.c_str(), 0700) < 0 && errno != EEXIST) return false;
+  }
+  return true;
+}
+
+static StateFile read_file() {
+  StateFile f;
+  std::ifstream in(state_path());
+  std::string line, section;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    if (line.front() == '[' && line.back() == ']') {
+      section = line.substr(1, line.size() - 2);
+      continue;
+    }
+    size_t eq = line.find('=');
+    if (eq == std::string::npos || section.empty()) continue;
+    f[section][line.substr(0, eq)] = line.substr(eq + 1);
+  }
+  return f;
+}
+
+static bool write_file(const StateFile& f) {
+  const std::string path = state_path();
+  if (path.empty() || !make_dirs(state_dir())) {
+    std::fprintf(stderr, "[state] no usable state directory\n");
+    return false;
+  }
+
+  std::string body;
+  for (const auto& s : f) {
+    body += "[" + s.first + "]\n";
+    for (const auto& kv : s.second) body += kv.first + "=" + kv.second + "\n";
+  }
+
+  // Write a temp file and rename over the old one so a crash never leaves a torn file
+  const std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) { perror("[state] open"); return false; }
+  bool ok = ::write(fd, body.data(), body.size()) == (ssize_t)body.size();
+  ok = ::fsync(fd) == 0 && ok;
+  ::close(fd);
+  if (!ok || ::rename(tmp.c_str(), path.c_str()) < 0) {
+    perror("[state] write");
+    ::unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+static float get_f(const Section& s, const char* k, float def) {
+  auto it = s.find(k);
+  return it == s.end() ? def : std::strtof(it->second.c_str(), nullptr);
+}
+
+// ---- public API ----
+std::string session_layout_key(std::vector<std::string> output_names) {
+  std::sort(output_names.begin(), output_names.end());
+  std::string key;
+  for (const auto& n : output_names) {
+    if (!key.empty()) key += ',';
+    key += n;
+  }
+  return key;
+}
+
+bool session_load(const std::string& layout_key, SessionState& st) {
+  StateFile f = read_file();
+  auto it = f.find("layout " + layout_key);
+  if (it == f.end()) return false;
+  const Section& s = it->second;
+
+  st.fov          = get_f(s, "fov", float(st.fov));
+  st.zoom         = get_f(s, "zoom", st.zoom);
+  st.angle_offset = get_f(s, "angle-offset", st.angle_offset);
+  st.center_dot   = get_f(s, "center-dot", st.center_dot ? 1.f : 0.f) != 0.f;
+  st.roi          = get_f(s, "roi", st.roi ? 1.f : 0.f) != 0.f;
+  st.oroll        = get_f(s, "oroll", st.oroll);
+  st.opitch       = get_f(s, "opitch", st.opitch);
+  st.oyaw         = get_f(s, "oyaw", st.oyaw);
+
+  st.focus.clear();
+  auto fit = s.find("focus");
+  if (fit != s.end()) {
+    std::stringstream ss(fit->second);
+    std::string name;
+    while (std::getline(ss, name, ',')) st.focus.push_back(name);
+  }
+  return true;
+}
+
+bool session_save(const std::string& layout_key, const SessionState& st) {
+  StateFile f = read_file();
+  Section& s = f["layout " + layout_key];
+  char buf[64];
+  auto put = [&](const char* k, double v) {
+    std::snprintf(buf, sizeof(buf), "%.4f", v);
+    s[k] = buf;
+  };
+  put("fov", st.fov);
+  put("zoom", st.zoom);
+  put("angle-offset", st.angle_offset);
+  s["center-dot"] = st.center_dot ? "1" : "0";
+  s["roi"]        = st.roi ? "1" : "0";
+  put("oroll", st.oroll);
+  put("opitch", st.opitch);
+  put("oyaw", st.oyaw);
+
+  std::string focus;
+  for (size_t i = 0; i < st.focus.size(); ++i) {
+    if (i) focus += ',';
+    focus += st.focus[i];
+  }
+  s["focus"] = focus;
+  return write_file(f);
+}
+
+std::vector<OutputCache> session_load_outputs() {
+  std::vector<OutputCache> outs;
+  for (const auto& s : read_file()) {
+    if (s.first.compare(0, 7, "output ") != 0) continue;
+    OutputCache oc;
+    oc.name   = s.first.substr(7);
+    oc.width  = (int)get_f(s.second, "width", 0);
+    oc.height = (int)get_f(s.second, "height", 0);
+    auto it = s.second.find("fourcc");
+    if (it != s.second.end()) oc.fourcc = (uint32_t)std::strtoul(it->second.c_str(), nullptr, 0);
+    if (oc.width > 0 && oc.height > 0 && oc.fourcc) outs.push_back(oc);
+  }
+  return outs;
+}
+
+bool session_save_outputs(const std::vector<OutputCache>& outs) {
+  StateFile f = read_file();
+  bool changed = false;
+  for (const auto& oc : outs) {
+    Section s;
+    s["width"]  = std::to_string(oc.width);
+    s["height"] = std::to_string(oc.height);
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "0x%08x", oc.fourcc);
+    s["fourcc"] = buf;
+    Section& cur = f["output " + oc.name];
+    if (cur != s) { cur = s; changed = true; }
+  }
+  return changed ? write_file(f) : true;
+}
+
+std::string session_state_subdir(const std::string& sub) {
+  const std::string d = state_dir();
+  if (d.empty()) return d;
+  const std::string dir = d + "/" + sub;
+  return make_dirs(dir) ? dir : std::string();
+}
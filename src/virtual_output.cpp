@@ -0,0 +1,165 @@
+#include "virtual_output.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// i3/sway IPC: "i3-ipc" magic, u32 payload length, u32 type, payload (native endian)
+static const char     IPC_MAGIC[] = {'i', '3', '-', 'i', 'p', 'c'};
+static const uint32_t IPC_RUN_COMMAND = 0;
+static const uint32_t IPC_GET_OUTPUTS = 3;
+
+static std::vector<std::string> created;
+
+// ---- IPC ----
+static bool write_all(int fd, const char* p, size_t n) {
+  while (n > 0) {
+    ssize_t k = ::write(fd, p, n);
+    if (k <= 0) return false;
+    p += k; n -= size_t(k);
+  }
+  return true;
+}
+
+static bool read_all(int fd, char* p, size_t n) {
+  while (n > 0) {
+    ssize_t k = ::read(fd, p, n);
+    if (k <= 0) return false;
+    p += k; n -= size_t(k);
+  }
+  return true;
+}
+
+static bool ipc_call(uint32_t type, const std::string& payload, std::string& reply) {
+  const char* path = std::getenv("SWAYSOCK");
+  if (!path || !*path) return false;
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+  if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    std::fprintf(stderr, "[vout] connect %s: %s\n", path, std::strerror(errno));
+    ::close(fd);
+    return false;
+  }
+
+  char hdr[14];
+  uint32_t len = uint32_t(payload.size());
+  std::memcpy(hdr, IPC_MAGIC, 6);
+  std::memcpy(hdr + 6, &len, 4);
+  std::memcpy(hdr + 10, &type, 4);
+  bool ok = write_all(fd, hdr, sizeof(hdr)) && write_all(fd, payload.data(), payload.size()) &&
+            read_all(fd, hdr, sizeof(hdr)) && std::memcmp(hdr, IPC_MAGIC, 6) == 0;
+  if (ok) {
+    std::memcpy(&len, hdr + 6, 4);
+    reply.assign(len, '\0');
+    ok = read_all(fd, &reply[0], len);
+  }
+  ::close(fd);
+  return ok;
+}
+
+// Value of every string field `key` in a JSON reply, in order. Enough for the
+// flat objects sway returns; not a JSON parser.
+static std::vector<std::string> json_strings(const std::string& js, const char* key) {
+  std::vector<std::string> vals;
+  const std::string k = std::string("\"") + key + "\"";
+  for (size_t p = js.find(k); p != std::string::npos; p = js.find(k, p + 1)) {
+    size_t q = p + k.size();
+    while (q < js.size() && (js[q] == ' ' || js[q] == ':')) ++q;
+    if (q >= js.size() || js[q] != '"') continue;
+    size_t e = js.find('"', q + 1);
+    if (e == std::string::npos) break;
+    vals.push_back(js.substr(q + 1, e - q - 1));
+  }
+  return vals;
+}
+
+// Run a sway command; false with the compositor's error in `err` on failure.
+static bool run_command(const std::string& cmd, std::string& err) {
+  std::string reply;
+  if (!ipc_call(IPC_RUN_COMMAND, cmd, reply)) {
+    err = "sway ipc unavailable";
+    return false;
+  }
+  if (reply.find("\"success\": false") == std::string::npos &&
+      reply.find("\"success\":false") == std::string::npos)
+    return true;
+  std::vector<std::string> e = json_strings(reply, "error");
+  err = e.empty() ? "command failed" : e[0];
+  std::fprintf(stderr, "[vout] '%s': %s\n", cmd.c_str(), err.c_str());
+  return false;
+}
+
+static bool output_names(std::vector<std::string>& names) {
+  std::string reply;
+  if (!ipc_call(IPC_GET_OUTPUTS, "", reply)) return false;
+  names = json_strings(reply, "name");
+  return true;
+}
+
+// ---- API ----
+bool vout_available() {
+  const char* path = std::getenv("SWAYSOCK");
+  return path && *path;
+}
+
+std::string vout_create(int w, int h, int refresh_hz, std::string& err) {
+  std::vector<std::string> before, after;
+  if (!output_names(before)) { err = "sway ipc unavailable"; return ""; }
+  if (!run_command("create_output", err)) return "";
+  if (!output_names(after)) { err = "sway ipc unavailable"; return ""; }
+
+  std::string name;
+  for (const std::string& n : after)
+    if (std::find(before.begin(), before.end(), n) == before.end()) name = n;
+  if (name.empty()) { err = "new output not found"; return ""; }
+  created.push_back(name);
+
+  char cmd[160];
+  std::snprintf(cmd, sizeof(cmd), "output %s mode --custom %dx%d@%dHz", name.c_str(), w, h,
+                refresh_hz);
+  if (!run_command(cmd, err)) {
+    std::string ignored;
+    vout_destroy(name, ignored);
+    return "";
+  }
+  std::fprintf(stdout, "[vout] created %s %dx%d@%d\n", name.c_str(), w, h, refresh_hz);
+  return name;
+}
+
+bool vout_destroy(const std::string& name, std::string& err) {
+  auto it = std::find(created.begin(), created.end(), name);
+  if (it == created.end()) { err = "not a virtual output"; return false; }
+  if (!run_command("output " + name + " unplug", err)) return false;
+  created.erase(it);
+  std::fprintf(stdout, "[vout] removed %s\n", name.c_str());
+  return true;
+}
+
+void vout_destroy_all() {
+  std::string err;
+  while (!created.empty())
+    if (!vout_destroy(created.back(), err)) created.pop_back();
+}
+
+const std::vector<std::string>& vout_list() { return created; }
+
+void vout_match_density(float panel_w, float distance, double vfov_deg, int fb_h,
+                        float aspect, int& w, int& h) {
+  // Focal length in glasses pixels, then the panel's projected width
+  const double f = 0.5 * fb_h / std::tan(vfov_deg * M_PI / 360.0);
+  double px = distance > 0 ? f * panel_w / distance : 1920.0;
+  px = std::min(std::max(px, 320.0), 7680.0);
+  w = (int(px) + 7) / 8 * 8;
+  h = (int(px * aspect) + 7) / 8 * 8;
+}
@@ -0,0 +1,104 @@
+#!/usr/bin/env bash
+# Capture under a misbehaving compositor: runs capture_bench against
+# mock_compositor for each scenario below, on the dma-buf and the wl_shm path,
+# and fails if the capture throws, hangs, delivers nothing, or does not recover
+# from an output change: nothing delivered after the last change capture_bench
+# saw, or the mock rejecting more buffers than it made changes (a capture
+# stuck on a stale buffer keeps copying into it).
+#
+#   tools/capture-robustness.sh [scenario...]      (BIN=build dir, default ./build;
+#                                                   PATHS="dmabuf shm" by default)
+
+set -euo pipefail
+BIN="${BIN:-./build}"
+FRAMES="${FRAMES:-600}"
+PATHS="${PATHS:-dmabuf shm}"
+for exe in mock_compositor capture_bench; do
+  if [[ ! -x "$BIN/$exe" ]]; then
+    echo "$BIN/$exe not found (set BIN to the build directory)" >&2
+    exit 1
+  fi
+done
+
+if [[ -z "${XDG_RUNTIME_DIR:-}" ]]; then
+  XDG_RUNTIME_DIR="$(mktemp -d)"
+  export XDG_RUNTIME_DIR
+fi
+export VITURE_PLATFORM="${VITURE_PLATFORM:-surfaceless}"
+
+declare -A scenarios=(
+  [baseline]="--output 1920x1080"
+  [three-outputs]="--output 1920x1080 --output 2560x1440 --output 1280x720@144"
+  [slow-ready]="--latency 5:5 --slow-every 20:120"
+  [failures]="--fail 0.05 --fail-every 17"
+  [resize]="--resize-every 50"
+  [reformat]="--reformat-every 40"
+  [hotplug]="--output 1920x1080 --output 1920x1080 --hotplug-every 700"
+  [static-screen]="--damage static"
+)
+order=(baseline three-outputs slow-ready failures resize reformat hotplug static-screen)
+[[ $# -gt 0 ]] && order=("$@")
+
+failed=0
+for name in "${order[@]}"; do
+  if [[ -z "${scenarios[$name]+x}" ]]; then
+    echo "unknown scenario: $name" >&2
+    exit 1
+  fi
+  for path in $PATHS; do
+    sock="viture-mock-$$-$name-$path"
+    log="$XDG_RUNTIME_DIR/$sock.log"
+    # shellcheck disable=SC2086
+    "$BIN/mock_compositor" --socket "$sock" ${scenarios[$name]} >"$log.mock" 2>&1 &
+    mock=$!
+    for _ in $(seq 50); do
+      [[ -S "$XDG_RUNTIME_DIR/$sock" ]] && break
+      sleep 0.1
+    done
+
+    capture=""
+    [[ $path == shm ]] && capture=shm
+    rc=0
+    WAYLAND_DISPLAY="$sock" VITURE_CAPTURE="$capture" \
+      timeout 120 "$BIN/capture_bench" --frames "$FRAMES" --budget-us 4000 --hz 120 >"$log" 2>&1 || rc=$?
+    kill -INT "$mock" 2>/dev/null || true
+    wait "$mock" 2>/dev/null || true
+
+    delivered="$(sed -n 's/.* \([0-9.]*\) output frames\/s delivered.*/\1/p' "$log")"
+    p99="$(sed -n 's/^\[bench\] next_frame.* p99 \([0-9]*\).*/\1/p' "$log")"
+    last_change="$(sed -n 's/^\[bench\] last output change at frame \(-\{0,1\}[0-9]*\),.*/\1/p' "$log")"
+    after="$(sed -n 's/.*, \([0-9]*\) output frames delivered after it.*/\1/p' "$log")"
+    mismatched="$(sed -n 's/.*mismatched buffer \([0-9]*\).*/\1/p' "$log.mock")"
+    changes="$(sed -n 's/.*output changes \([0-9]*\).*/\1/p' "$log.mock")"
+    # A static screen delivers nothing on the damage path; the loop must
+    # still run at the display rate instead of sitting in a copy.
+    ok=1
+    why="exit $rc"
+    if [[ $rc -ne 0 || -z "$delivered" || -z "$changes" ]]; then
+      ok=0
+    elif [[ $name == static-screen ]]; then
+      [[ ${p99:-99999} -lt 20000 ]] || ok=0
+    elif [[ "$delivered" == "0.0" ]]; then
+      ok=0
+    elif [[ ${mismatched:-0} -gt $((2 * changes)) ]]; then
+      # Each change costs at most a copy or two into the old buffer
+      ok=0
+      why="$mismatched mismatched buffers for $changes output changes"
+    elif [[ ${last_change:--1} -ge 0 && $((FRAMES - last_change)) -gt 60 && ${after:-0} -eq 0 ]]; then
+      # Allow a change in the last few frames to be still settling
+      ok=0
+      why="nothing delivered after the output change at frame $last_change"
+    fi
+    if [[ $ok -eq 0 ]]; then
+      printf '%-14s %-6s FAIL (%s)\n' "$name" "$path" "$why"
+      sed 's/^/    /' "$log" "$log.mock" | tail -n 20
+      failed=$((failed + 1))
+    else
+      printf '%-14s %-6s ok    %s\n' "$name" "$path" "$(grep '^\[bench\] next_frame' "$log" | cut -d' ' -f2-)"
+    fi
+    rm -f "$log" "$log.mock"
+  done
+done
+
+echo "$failed failed"
+[[ $failed -eq 0 ]]
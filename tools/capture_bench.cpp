@@ -0,0 +1,120 @@
+// Capture loop without the renderer: wlr_multi_next_frame against whatever
+// compositor $WAYLAND_DISPLAY names (tools/mock_compositor for reproducible
+// runs), on a headless GL context ($VITURE_PLATFORM, default surfaceless).
+//
+//   capture_bench [--frames N] [--budget-us N] [--interval N] [--hz N]
+//
+// Reports delivered frames per second, next_frame and wait percentiles, the
+// output changes seen and what was delivered after the last one (capture that
+// never recovers from a change delivers nothing there). Exits non-zero if the
+// capture throws.
+#include "capture_multi.hpp"
+#include "platform.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double pct(std::vector<double>& v, double p) {
+  if (v.empty()) return 0;
+  const size_t i = std::min(v.size() - 1, size_t(p * v.size()));
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+static void usage() {
+  fprintf(stderr, "usage: capture_bench [--frames N] [--budget-us N] [--interval N] [--hz N]\n"
+                  "  --frames N     loop iterations (default 1000)\n"
+                  "  --budget-us N  wlr_multi_set_wait_budget (default -1, wait for all copies)\n"
+                  "  --interval N   capture every output every N-th frame (default 1)\n"
+                  "  --hz N         pace the loop like a display at N Hz (default: free running)\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  int frames = 1000, budget = -1, interval = 1, hz = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) usage();
+    const char* v = argv[++i];
+    if (!strcmp(argv[i - 1], "--frames"))         frames = atoi(v);
+    else if (!strcmp(argv[i - 1], "--budget-us")) budget = atoi(v);
+    else if (!strcmp(argv[i - 1], "--interval"))  interval = atoi(v);
+    else if (!strcmp(argv[i - 1], "--hz"))        hz = atoi(v);
+    else usage();
+  }
+  if (frames <= 0 || interval < 1 || hz < 0) usage();
+
+  setenv("VITURE_PLATFORM", "surfaceless", 0);
+  init_window_and_gl(64, 64, "capture bench");
+
+  std::vector<CapturedOutput> outs;
+  std::vector<double> next_us, wait_us;
+  long delivered = 0, changes = 0;
+  long delivered_after_change = 0;   // since the last output change
+  int last_change = -1;              // loop iteration of that change
+  int rc = 0;
+  const auto period = std::chrono::microseconds(hz ? 1000000 / hz : 0);
+  std::chrono::duration<double> elapsed{};
+  try {
+    int w = 0, h = 0;
+    const auto t_init = std::chrono::steady_clock::now();
+    wlr_multi_capture_init(outs, &w, &h);
+    fprintf(stdout, "[bench] %zu outputs, %dx%d, init %.1f ms\n", outs.size(), w, h,
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_init).count());
+    wlr_multi_set_wait_budget(budget);
+    auto set_interval = [&] {
+      for (size_t i = 0; i < outs.size(); ++i) wlr_multi_set_interval(i, interval);
+    };
+    set_interval();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    auto tick = t0;
+    for (int f = 0; f < frames; ++f) {
+      const auto a = std::chrono::steady_clock::now();
+      wlr_multi_next_frame(outs);
+      glFinish();
+      next_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - a).count());
+      wait_us.push_back(double(wlr_multi_last_wait_us()));
+      for (const CapturedOutput& o : outs) {
+        delivered += o.dirty_y1 > o.dirty_y0;
+        delivered_after_change += o.dirty_y1 > o.dirty_y0;
+      }
+      if (wlr_multi_update_outputs(outs)) {
+        ++changes;
+        last_change = f;
+        delivered_after_change = 0;
+        set_interval();
+        fprintf(stdout, "[bench] frame %d: now %zu outputs\n", f, outs.size());
+      }
+      if (hz) {
+        tick += period;
+        std::this_thread::sleep_until(tick);
+      }
+    }
+    elapsed = std::chrono::steady_clock::now() - t0;
+  } catch (const std::exception& e) {
+    fprintf(stderr, "[bench] capture failed: %s\n", e.what());
+    rc = 1;
+  }
+
+  const int n = int(next_us.size());
+  const double secs = elapsed.count();
+  fprintf(stdout,
+          "[bench] %d frames in %.2f s: %.1f loops/s, %.1f output frames/s delivered, %ld output changes\n"
+          "[bench] next_frame us: p50 %.0f  p95 %.0f  p99 %.0f  max %.0f\n"
+          "[bench] wait us:       p50 %.0f  p99 %.0f\n"
+          "[bench] last output change at frame %d, %ld output frames delivered after it\n",
+          n, secs, secs > 0 ? n / secs : 0.0, secs > 0 ? delivered / secs : 0.0, changes,
+          pct(next_us, 0.50), pct(next_us, 0.95), pct(next_us, 0.99), pct(next_us, 1.0),
+          pct(wait_us, 0.50), pct(wait_us, 0.99), last_change, delivered_after_change);
+
+  wlr_multi_shutdown();
+  shutdown_window();
+  return rc;
+}
@@ -0,0 +1,789 @@
+// Stand-in compositor for capture tests and benchmarks. Offers wl_output,
+// wl_shm, zwlr_screencopy_manager_v1 (v3) and zwp_linux_dmabuf_v1 (v4) and
+// answers copies itself: the buffer (wl_shm, or the client's dma-buf, mapped)
+// gets a test pattern with a band that moves one step per frame. Latency,
+// damage, failures, mode/format changes and hotplug are scripted from the
+// command line, so capture behaviour is reproducible on any Linux box:
+//
+//   mock_compositor --socket mock-0 --output 1920x1080 --latency 4:2 --fail 0.01 &
+//   WAYLAND_DISPLAY=mock-0 capture_bench
+//
+// Prints a summary of the copies it served on SIGINT/SIGTERM.
+#include "linux-dmabuf-unstable-v1-server-protocol.h"
+#include "wlr-screencopy-unstable-v1-server-protocol.h"
+
+#include <drm_fourcc.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Fmt {
+  const char* name;
+  uint32_t    shm, drm;
+  bool        bgr;
+};
+static const Fmt FORMATS[] = {
+  {"xrgb8888", WL_SHM_FORMAT_XRGB8888, DRM_FORMAT_XRGB8888, false},
+  {"xbgr8888", WL_SHM_FORMAT_XBGR8888, DRM_FORMAT_XBGR8888, true},
+};
+static const int N_FORMATS = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+enum class Damage { Band, Full, Static };
+
+struct Config {
+  std::string socket;
+  const Fmt*  fmt = &FORMATS[0];
+  double latency_ms = 0, jitter_ms = 0;
+  bool   paced = false;
+  int    slow_every = 0;
+  double slow_ms = 0;
+  Damage damage = Damage::Band;
+  double fail_p = 0;
+  int    fail_every = 0;
+  int    resize_every = 0, reformat_every = 0;
+  int    hotplug_ms = 0;
+  bool   dmabuf = true;
+  bool   strict = false;
+  std::string main_device = "/dev/dri/renderD128";
+  unsigned seed = 1;
+};
+static Config cfg;
+
+struct Output {
+  int         id = 0;
+  std::string name;
+  int         base_w = 0, base_h = 0, w = 0, h = 0, hz = 60;
+  const Fmt*  fmt = nullptr;
+  wl_global*  global = nullptr;
+  std::vector<wl_resource*> resources;
+  bool        alive = true;
+  uint64_t    copies = 0, frames = 0;
+  int         band = 0, prev_band = -1;   // 16 bands over the height
+};
+
+// Client dma-buf wrapped in a wl_buffer (zwp_linux_buffer_params_v1)
+struct DmaBuffer {
+  int      fd = -1;
+  uint32_t offset = 0, stride = 0, w = 0, h = 0, format = 0;
+  uint8_t* map = nullptr;
+  size_t   map_len = 0;
+};
+struct Params {
+  int      fd = -1;
+  uint32_t offset = 0, stride = 0;
+  uint64_t modifier = 0;
+  bool     used = false;
+};
+
+struct Frame {
+  wl_resource*     res = nullptr;
+  Output*          out = nullptr;
+  int              x = 0, y = 0, w = 0, h = 0;
+  const Fmt*       fmt = nullptr;
+  bool             used = false, with_damage = false;
+  wl_resource*     buffer = nullptr;
+  wl_listener      buffer_gone;
+  wl_event_source* timer = nullptr;   // idle source or timer until completion
+  timespec         issued{};
+};
+
+struct Stats {
+  uint64_t copies = 0, ready = 0, failed = 0, injected = 0, gone = 0, mismatched = 0, unmapped = 0;
+  uint64_t changes = 0;   // mode/format changes, unplugs and plugs
+  double   latency_sum_ms = 0, latency_max_ms = 0;
+};
+static Stats stats;
+
+static wl_display*    display = nullptr;
+static wl_event_loop* loop = nullptr;
+static std::vector<std::unique_ptr<Output>> outputs;   // never freed: frames point at them
+static Output*        unplugged = nullptr;
+static std::vector<Frame*> pending;                    // copies waiting to complete
+static std::mt19937   rng;
+static timespec       start_time;
+static dev_t          main_dev = 0;
+
+static double since_ms(const timespec& a, const timespec& b) {
+  return (b.tv_sec - a.tv_sec) * 1e3 + (b.tv_nsec - a.tv_nsec) / 1e6;
+}
+static timespec now() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t;
+}
+static double uniform(double hi) { return std::uniform_real_distribution<double>(0, hi)(rng); }
+
+// ---------------- wl_output ----------------
+static void send_mode(Output* o, wl_resource* r) {
+  wl_output_send_geometry(r, 0, 0, 600, 340, WL_OUTPUT_SUBPIXEL_UNKNOWN, "mock",
+                          o->name.c_str(), WL_OUTPUT_TRANSFORM_NORMAL);
+  wl_output_send_mode(r, WL_OUTPUT_MODE_CURRENT | WL_OUTPUT_MODE_PREFERRED, o->w, o->h, o->hz * 1000);
+  if (wl_resource_get_version(r) >= WL_OUTPUT_DONE_SINCE_VERSION) wl_output_send_done(r);
+}
+
+static void output_release(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static const struct wl_output_interface OUTPUT_IMPL = { output_release };
+
+static void output_resource_destroy(wl_resource* r) {
+  auto* o = static_cast<Output*>(wl_resource_get_user_data(r));
+  o->resources.erase(std::remove(o->resources.begin(), o->resources.end(), r), o->resources.end());
+}
+
+static void output_bind(wl_client* client, void* data, uint32_t version, uint32_t id) {
+  auto* o = static_cast<Output*>(data);
+  wl_resource* r = wl_resource_create(client, &wl_output_interface, int(version), id);
+  if (!r) { wl_client_post_no_memory(client); return; }
+  wl_resource_set_implementation(r, &OUTPUT_IMPL, o, output_resource_destroy);
+  o->resources.push_back(r);
+  if (version >= WL_OUTPUT_SCALE_SINCE_VERSION) wl_output_send_scale(r, 1);
+  if (version >= WL_OUTPUT_NAME_SINCE_VERSION) {
+    wl_output_send_name(r, o->name.c_str());
+    wl_output_send_description(r, "mock output");
+  }
+  send_mode(o, r);
+}
+
+static Output* plug(const std::string& name, int w, int h, int hz) {
+  auto o = std::make_unique<Output>();
+  o->id = int(outputs.size());
+  o->name = name;
+  o->base_w = o->w = w;
+  o->base_h = o->h = h;
+  o->hz = hz;
+  o->fmt = cfg.fmt;
+  o->global = wl_global_create(display, &wl_output_interface, 4, o.get(), output_bind);
+  outputs.push_back(std::move(o));
+  fprintf(stdout, "[mock] %s: %dx%d@%d\n", name.c_str(), w, h, hz);
+  return outputs.back().get();
+}
+
+// ---------------- Copies ----------------
+static void fail_frame(Frame* F);
+
+static void cancel(Frame* F) {
+  if (F->timer) wl_event_source_remove(F->timer);
+  F->timer = nullptr;
+  if (F->buffer) {
+    wl_list_remove(&F->buffer_gone.link);
+    F->buffer = nullptr;
+  }
+  pending.erase(std::remove(pending.begin(), pending.end(), F), pending.end());
+}
+
+static void fail_frame(Frame* F) {
+  cancel(F);
+  ++stats.failed;
+  zwlr_screencopy_frame_v1_send_failed(F->res);
+}
+
+// Copies of `o` still running are for its old size or format
+static void fail_pending(Output* o) {
+  std::vector<Frame*> doomed;
+  for (Frame* F : pending)
+    if (F->out == o) doomed.push_back(F);
+  for (Frame* F : doomed) fail_frame(F);
+}
+
+static uint32_t pixel(const Fmt* f, uint32_t rgb) {
+  return f->bgr ? (rgb & 0x00ff00) | (rgb & 0xff) << 16 | (rgb >> 16 & 0xff) : rgb;
+}
+
+static const uint32_t PALETTE[] = { 0x803030, 0x308030, 0x303080, 0x807020, 0x603080, 0x207070 };
+
+// Fill the buffer: output colour with a white band. Returns false if the
+// buffer cannot be written (dma-buf that does not mmap); the copy still
+// completes, like a compositor whose GPU copy we cannot see.
+static bool paint(Frame* F, wl_resource* buffer) {
+  uint8_t* data = nullptr;
+  int32_t stride = 0;
+  wl_shm_buffer* shm = wl_shm_buffer_get(buffer);
+  DmaBuffer* dma = nullptr;
+  if (shm) {
+    wl_shm_buffer_begin_access(shm);
+    data = static_cast<uint8_t*>(wl_shm_buffer_get_data(shm));
+    stride = wl_shm_buffer_get_stride(shm);
+  } else {
+    dma = static_cast<DmaBuffer*>(wl_resource_get_user_data(buffer));
+    if (!dma->map) return false;
+    dma_buf_sync sync{DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE};
+    ioctl(dma->fd, DMA_BUF_IOCTL_SYNC, &sync);
+    data = dma->map + dma->offset;
+    stride = int32_t(dma->stride);
+  }
+
+  const Output* o = F->out;
+  const int bh = std::max(1, o->h / 16);
+  const uint32_t bg = pixel(F->fmt, PALETTE[o->id % 6]), fg = pixel(F->fmt, 0xffffff);
+  for (int y = 0; y < F->h; ++y) {
+    const int oy = F->y + y;
+    const uint32_t c = oy >= o->band * bh && oy < (o->band + 1) * bh ? fg : bg;
+    auto* row = reinterpret_cast<uint32_t*>(data + size_t(stride) * y);
+    std::fill(row, row + F->w, c);
+  }
+
+  if (shm) {
+    wl_shm_buffer_end_access(shm);
+  } else {
+    dma_buf_sync sync{DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE};
+    ioctl(dma->fd, DMA_BUF_IOCTL_SYNC, &sync);
+  }
+  return true;
+}
+
+// Damage of a band, clipped to the frame's region
+static void send_band_damage(Frame* F, int band) {
+  if (band < 0) return;
+  const int bh = std::max(1, F->out->h / 16);
+  const int y0 = std::max(band * bh, F->y), y1 = std::min((band + 1) * bh, F->y + F->h);
+  if (y1 > y0) zwlr_screencopy_frame_v1_send_damage(F->res, 0, uint32_t(y0 - F->y), uint32_t(F->w), uint32_t(y1 - y0));
+}
+
+static void change_mode(Output* o) {
+  const bool resize = cfg.resize_every > 0 && o->frames % cfg.resize_every == 0;
+  const bool reformat = cfg.reformat_every > 0 && o->frames % cfg.reformat_every == 0;
+  if (!resize && !reformat) return;
+  if (resize) {
+    const bool full = o->w == o->base_w;
+    o->w = full ? o->base_w / 2 : o->base_w;
+    o->h = full ? o->base_h / 2 : o->base_h;
+    for (wl_resource* r : o->resources) send_mode(o, r);
+  }
+  if (reformat) o->fmt = o->fmt == &FORMATS[0] ? &FORMATS[1] : &FORMATS[0];
+  ++stats.changes;
+  fprintf(stdout, "[mock] %s: now %dx%d %s\n", o->name.c_str(), o->w, o->h, o->fmt->name);
+  fail_pending(o);
+}
+
+static void complete(Frame* F) {
+  F->timer = nullptr;
+  if (F->buffer) wl_list_remove(&F->buffer_gone.link);
+  wl_resource* buffer = F->buffer;
+  F->buffer = nullptr;
+  pending.erase(std::remove(pending.begin(), pending.end(), F), pending.end());
+
+  Output* o = F->out;
+  const bool inject = (cfg.fail_every > 0 && o->copies % cfg.fail_every == 0) ||
+                      (cfg.fail_p > 0 && uniform(1.0) < cfg.fail_p);
+  if (inject || !buffer) {
+    stats.injected += inject;
+    ++stats.failed;
+    zwlr_screencopy_frame_v1_send_failed(F->res);
+    return;
+  }
+
+  if (cfg.damage != Damage::Static) {
+    o->prev_band = o->band;
+    o->band = (o->band + 1) % 16;
+  }
+  if (!paint(F, buffer)) ++stats.unmapped;
+
+  zwlr_screencopy_frame_v1_send_flags(F->res, 0);
+  if (F->with_damage) {
+    if (cfg.damage == Damage::Full) {
+      zwlr_screencopy_frame_v1_send_damage(F->res, 0, 0, uint32_t(F->w), uint32_t(F->h));
+    } else if (cfg.damage == Damage::Band) {
+      send_band_damage(F, o->prev_band);
+      send_band_damage(F, o->band);
+    }
+  }
+  const timespec t = now();
+  const double lat = since_ms(F->issued, t);
+  stats.latency_sum_ms += lat;
+  stats.latency_max_ms = std::max(stats.latency_max_ms, lat);
+  ++stats.ready;
+  ++o->frames;
+  zwlr_screencopy_frame_v1_send_ready(F->res, uint32_t(uint64_t(t.tv_sec) >> 32),
+                                      uint32_t(t.tv_sec & 0xffffffff), uint32_t(t.tv_nsec));
+  change_mode(o);
+}
+
+static int complete_timer(void* data) {
+  auto* F = static_cast<Frame*>(data);
+  wl_event_source_remove(F->timer);
+  complete(F);
+  return 0;
+}
+// The loop frees idle sources once they have run
+static void complete_idle(void* data) { complete(static_cast<Frame*>(data)); }
+
+static void schedule(Frame* F) {
+  double ms = cfg.latency_ms + (cfg.jitter_ms > 0 ? uniform(cfg.jitter_ms) : 0);
+  if (cfg.slow_every > 0 && F->out->copies % cfg.slow_every == 0) ms += cfg.slow_ms;
+  if (cfg.paced) {
+    // Next refresh of the output, counted from startup
+    const double period = 1000.0 / F->out->hz, t = since_ms(start_time, now());
+    ms += std::ceil(t / period) * period - t;
+  }
+  const int delay = int(ms + 0.5);
+  if (delay <= 0) {
+    F->timer = wl_event_loop_add_idle(loop, complete_idle, F);
+  } else {
+    F->timer = wl_event_loop_add_timer(loop, complete_timer, F);
+    wl_event_source_timer_update(F->timer, delay);
+  }
+}
+
+static void buffer_gone(wl_listener* l, void*) {
+  Frame* F = wl_container_of(l, F, buffer_gone);
+  wl_list_remove(&F->buffer_gone.link);
+  F->buffer = nullptr;   // completes as failed
+}
+
+// Size, format and stride a copy needs. False for anything else.
+static bool buffer_fits(Frame* F, wl_resource* buffer) {
+  if (wl_shm_buffer* shm = wl_shm_buffer_get(buffer))
+    return wl_shm_buffer_get_width(shm) == F->w && wl_shm_buffer_get_height(shm) == F->h &&
+           wl_shm_buffer_get_format(shm) == F->fmt->shm &&
+           wl_shm_buffer_get_stride(shm) >= F->w * 4;
+  auto* d = static_cast<DmaBuffer*>(wl_resource_get_user_data(buffer));
+  return d && int(d->w) == F->w && int(d->h) == F->h && d->format == F->fmt->drm &&
+         int(d->stride) >= F->w * 4;
+}
+
+static void frame_copy_common(wl_resource* r, wl_resource* buffer, bool with_damage) {
+  auto* F = static_cast<Frame*>(wl_resource_get_user_data(r));
+  if (F->used) {
+    wl_resource_post_error(r, ZWLR_SCREENCOPY_FRAME_V1_ERROR_ALREADY_USED, "frame already used");
+    return;
+  }
+  F->used = true;
+  if (!F->out->alive) {
+    ++stats.gone;
+    ++stats.failed;
+    zwlr_screencopy_frame_v1_send_failed(r);
+    return;
+  }
+  if (!buffer_fits(F, buffer)) {
+    ++stats.mismatched;
+    if (cfg.strict) {
+      // What wlroots does with a buffer that does not match the offer
+      wl_resource_post_error(r, ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER, "invalid buffer");
+      return;
+    }
+    ++stats.failed;
+    zwlr_screencopy_frame_v1_send_failed(r);
+    return;
+  }
+  ++stats.copies;
+  ++F->out->copies;
+  F->with_damage = with_damage;
+  F->buffer = buffer;
+  F->buffer_gone.notify = buffer_gone;
+  wl_resource_add_destroy_listener(buffer, &F->buffer_gone);
+  F->issued = now();
+  pending.push_back(F);
+  // Nothing ever changes: copy_with_damage waits forever, as on an idle desktop
+  if (with_damage && cfg.damage == Damage::Static) return;
+  schedule(F);
+}
+
+static void frame_copy(wl_client*, wl_resource* r, wl_resource* buffer) {
+  frame_copy_common(r, buffer, false);
+}
+static void frame_copy_with_damage(wl_client*, wl_resource* r, wl_resource* buffer) {
+  frame_copy_common(r, buffer, true);
+}
+static void frame_destroy(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static const struct zwlr_screencopy_frame_v1_interface FRAME_IMPL = {
+  frame_copy, frame_destroy, frame_copy_with_damage
+};
+
+static void frame_resource_destroy(wl_resource* r) {
+  auto* F = static_cast<Frame*>(wl_resource_get_user_data(r));
+  cancel(F);
+  delete F;
+}
+
+static void capture(wl_client* client, wl_resource* mgr, uint32_t id, wl_resource* output,
+                    bool region, int32_t x, int32_t y, int32_t w, int32_t h) {
+  auto* F = new Frame();
+  F->res = wl_resource_create(client, &zwlr_screencopy_frame_v1_interface,
+                              wl_resource_get_version(mgr), id);
+  if (!F->res) {
+    delete F;
+    wl_client_post_no_memory(client);
+    return;
+  }
+  wl_resource_set_implementation(F->res, &FRAME_IMPL, F, frame_resource_destroy);
+  F->out = static_cast<Output*>(wl_resource_get_user_data(output));
+  if (!F->out->alive) {
+    ++stats.gone;
+    ++stats.failed;
+    zwlr_screencopy_frame_v1_send_failed(F->res);
+    return;
+  }
+  const Output* o = F->out;
+  F->x = 0; F->y = 0; F->w = o->w; F->h = o->h;
+  if (region) {
+    // Scale is 1: logical coordinates are pixels
+    F->x = std::clamp(x, 0, o->w);
+    F->y = std::clamp(y, 0, o->h);
+    F->w = std::clamp(x + w, 0, o->w) - F->x;
+    F->h = std::clamp(y + h, 0, o->h) - F->y;
+    if (F->w <= 0 || F->h <= 0) {
+      ++stats.failed;
+      zwlr_screencopy_frame_v1_send_failed(F->res);
+      return;
+    }
+  }
+  F->fmt = o->fmt;
+  zwlr_screencopy_frame_v1_send_buffer(F->res, F->fmt->shm, uint32_t(F->w), uint32_t(F->h),
+                                       uint32_t(F->w * 4));
+  if (wl_resource_get_version(F->res) >= 3) {
+    if (cfg.dmabuf)
+      zwlr_screencopy_frame_v1_send_linux_dmabuf(F->res, F->fmt->drm, uint32_t(F->w), uint32_t(F->h));
+    zwlr_screencopy_frame_v1_send_buffer_done(F->res);
+  }
+}
+
+static void mgr_capture_output(wl_client* c, wl_resource* r, uint32_t id, int32_t, wl_resource* output) {
+  capture(c, r, id, output, false, 0, 0, 0, 0);
+}
+static void mgr_capture_output_region(wl_client* c, wl_resource* r, uint32_t id, int32_t,
+                                      wl_resource* output, int32_t x, int32_t y, int32_t w, int32_t h) {
+  capture(c, r, id, output, true, x, y, w, h);
+}
+static void mgr_destroy(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static const struct zwlr_screencopy_manager_v1_interface MGR_IMPL = {
+  mgr_capture_output, mgr_capture_output_region, mgr_destroy
+};
+
+static void screencopy_bind(wl_client* client, void*, uint32_t version, uint32_t id) {
+  wl_resource* r = wl_resource_create(client, &zwlr_screencopy_manager_v1_interface, int(version), id);
+  if (!r) { wl_client_post_no_memory(client); return; }
+  wl_resource_set_implementation(r, &MGR_IMPL, nullptr, nullptr);
+}
+
+// ---------------- linux-dmabuf ----------------
+static void buffer_destroy(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static const struct wl_buffer_interface BUFFER_IMPL = { buffer_destroy };
+
+static void dma_buffer_free(wl_resource* r) {
+  auto* d = static_cast<DmaBuffer*>(wl_resource_get_user_data(r));
+  if (d->map) munmap(d->map, d->map_len);
+  if (d->fd >= 0) close(d->fd);
+  delete d;
+}
+
+static void params_destroy(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static void params_add(wl_client*, wl_resource* r, int32_t fd, uint32_t plane, uint32_t offset,
+                       uint32_t stride, uint32_t mod_hi, uint32_t mod_lo) {
+  auto* p = static_cast<Params*>(wl_resource_get_user_data(r));
+  if (plane != 0) {
+    close(fd);
+    wl_resource_post_error(r, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_IDX, "single-plane formats only");
+    return;
+  }
+  if (p->fd >= 0) {
+    close(fd);
+    wl_resource_post_error(r, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_SET, "plane 0 already set");
+    return;
+  }
+  p->fd = fd;
+  p->offset = offset;
+  p->stride = stride;
+  p->modifier = uint64_t(mod_hi) << 32 | mod_lo;
+}
+
+// wl_buffer for the params, or null (params left untouched) if unusable
+static wl_resource* make_buffer(wl_client* client, wl_resource* r, uint32_t id, int32_t w,
+                                int32_t h, uint32_t format) {
+  auto* p = static_cast<Params*>(wl_resource_get_user_data(r));
+  if (p->used) {
+    wl_resource_post_error(r, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED, "params already used");
+    return nullptr;
+  }
+  p->used = true;
+  bool known = false;
+  for (const Fmt& f : FORMATS) known |= f.drm == format;
+  if (p->fd < 0 || w <= 0 || h <= 0 || !known || p->stride < uint32_t(w) * 4 ||
+      (p->modifier != DRM_FORMAT_MOD_LINEAR && p->modifier != DRM_FORMAT_MOD_INVALID))
+    return nullptr;
+
+  wl_resource* b = wl_resource_create(client, &wl_buffer_interface, 1, id);
+  if (!b) { wl_client_post_no_memory(client); return nullptr; }
+  auto* d = new DmaBuffer();
+  d->fd = p->fd;
+  p->fd = -1;
+  d->offset = p->offset;
+  d->stride = p->stride;
+  d->w = uint32_t(w);
+  d->h = uint32_t(h);
+  d->format = format;
+  d->map_len = size_t(d->offset) + size_t(d->stride) * d->h;
+  void* m = mmap(nullptr, d->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, d->fd, 0);
+  d->map = m == MAP_FAILED ? nullptr : static_cast<uint8_t*>(m);
+  wl_resource_set_implementation(b, &BUFFER_IMPL, d, dma_buffer_free);
+  return b;
+}
+
+static void params_create(wl_client* client, wl_resource* r, int32_t w, int32_t h, uint32_t format,
+                          uint32_t) {
+  wl_resource* b = make_buffer(client, r, 0, w, h, format);
+  if (b) zwp_linux_buffer_params_v1_send_created(r, b);
+  else   zwp_linux_buffer_params_v1_send_failed(r);
+}
+static void params_create_immed(wl_client* client, wl_resource* r, uint32_t id, int32_t w, int32_t h,
+                                uint32_t format, uint32_t) {
+  if (!make_buffer(client, r, id, w, h, format))
+    wl_resource_post_error(r, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_WL_BUFFER, "unusable dma-buf");
+}
+static const struct zwp_linux_buffer_params_v1_interface PARAMS_IMPL = {
+  params_destroy, params_add, params_create, params_create_immed
+};
+
+static void params_free(wl_resource* r) {
+  auto* p = static_cast<Params*>(wl_resource_get_user_data(r));
+  if (p->fd >= 0) close(p->fd);
+  delete p;
+}
+
+static void feedback_destroy(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static const struct zwp_linux_dmabuf_feedback_v1_interface FEEDBACK_IMPL = { feedback_destroy };
+
+// One tranche on the main device: every format, linear
+static void send_feedback(wl_resource* fb) {
+  struct Entry { uint32_t format, pad; uint64_t modifier; };
+  std::vector<Entry> table;
+  for (const Fmt& f : FORMATS) table.push_back(Entry{f.drm, 0, DRM_FORMAT_MOD_LINEAR});
+  const size_t size = table.size() * sizeof(Entry);
+  int fd = memfd_create("mock-format-table", MFD_CLOEXEC);
+  if (fd < 0 || write(fd, table.data(), size) != ssize_t(size)) {
+    if (fd >= 0) close(fd);
+    wl_resource_post_no_memory(fb);
+    return;
+  }
+  zwp_linux_dmabuf_feedback_v1_send_format_table(fb, fd, uint32_t(size));
+  close(fd);
+
+  wl_array dev;
+  wl_array_init(&dev);
+  memcpy(wl_array_add(&dev, sizeof(dev_t)), &main_dev, sizeof(dev_t));
+  zwp_linux_dmabuf_feedback_v1_send_main_device(fb, &dev);
+  zwp_linux_dmabuf_feedback_v1_send_tranche_target_device(fb, &dev);
+  wl_array_release(&dev);
+
+  wl_array idx;
+  wl_array_init(&idx);
+  for (size_t i = 0; i < table.size(); ++i)
+    *static_cast<uint16_t*>(wl_array_add(&idx, sizeof(uint16_t))) = uint16_t(i);
+  zwp_linux_dmabuf_feedback_v1_send_tranche_formats(fb, &idx);
+  wl_array_release(&idx);
+  zwp_linux_dmabuf_feedback_v1_send_tranche_flags(fb, 0);
+  zwp_linux_dmabuf_feedback_v1_send_tranche_done(fb);
+  zwp_linux_dmabuf_feedback_v1_send_done(fb);
+}
+
+static void dmabuf_destroy(wl_client*, wl_resource* r) { wl_resource_destroy(r); }
+static void dmabuf_create_params(wl_client* client, wl_resource* r, uint32_t id) {
+  wl_resource* p = wl_resource_create(client, &zwp_linux_buffer_params_v1_interface,
+                                      wl_resource_get_version(r), id);
+  if (!p) { wl_client_post_no_memory(client); return; }
+  wl_resource_set_implementation(p, &PARAMS_IMPL, new Params(), params_free);
+}
+static void dmabuf_feedback(wl_client* client, wl_resource* r, uint32_t id) {
+  wl_resource* fb = wl_resource_create(client, &zwp_linux_dmabuf_feedback_v1_interface,
+                                       wl_resource_get_version(r), id);
+  if (!fb) { wl_client_post_no_memory(client); return; }
+  wl_resource_set_implementation(fb, &FEEDBACK_IMPL, nullptr, nullptr);
+  send_feedback(fb);
+}
+static void dmabuf_surface_feedback(wl_client* client, wl_resource* r, uint32_t id, wl_resource*) {
+  dmabuf_feedback(client, r, id);
+}
+static const struct zwp_linux_dmabuf_v1_interface DMABUF_IMPL = {
+  dmabuf_destroy, dmabuf_create_params, dmabuf_feedback, dmabuf_surface_feedback
+};
+
+static void dmabuf_bind(wl_client* client, void*, uint32_t version, uint32_t id) {
+  wl_resource* r = wl_resource_create(client, &zwp_linux_dmabuf_v1_interface, int(version), id);
+  if (!r) { wl_client_post_no_memory(client); return; }
+  wl_resource_set_implementation(r, &DMABUF_IMPL, nullptr, nullptr);
+  if (version >= 4) return;   // formats come with the feedback
+  for (const Fmt& f : FORMATS) {
+    zwp_linux_dmabuf_v1_send_format(r, f.drm);
+    if (version >= ZWP_LINUX_DMABUF_V1_MODIFIER_SINCE_VERSION)
+      zwp_linux_dmabuf_v1_send_modifier(r, f.drm, uint32_t(DRM_FORMAT_MOD_LINEAR >> 32),
+                                        uint32_t(DRM_FORMAT_MOD_LINEAR & 0xffffffff));
+  }
+}
+
+// ---------------- Hotplug ----------------
+static wl_event_source* hotplug_timer = nullptr;
+
+static int hotplug(void*) {
+  ++stats.changes;
+  if (unplugged) {
+    wl_global_destroy(unplugged->global);   // removed from clients a while ago
+    unplugged->global = nullptr;
+    plug(unplugged->name, unplugged->base_w, unplugged->base_h, unplugged->hz);
+    unplugged = nullptr;
+  } else {
+    for (auto it = outputs.rbegin(); it != outputs.rend(); ++it) {
+      Output* o = it->get();
+      if (!o->alive) continue;
+      o->alive = false;
+      wl_global_remove(o->global);
+      fail_pending(o);
+      unplugged = o;
+      fprintf(stdout, "[mock] %s: unplugged\n", o->name.c_str());
+      break;
+    }
+  }
+  wl_event_source_timer_update(hotplug_timer, cfg.hotplug_ms);
+  return 0;
+}
+
+// ---------------- Main ----------------
+static int on_signal(int, void*) {
+  wl_display_terminate(display);
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: mock_compositor [options]\n"
+          "  --output WxH[@Hz]     add an output (repeatable; default 1920x1080@60)\n"
+          "  --socket NAME         socket name (default: first free wayland-N)\n"
+          "  --format F            xrgb8888 | xbgr8888 (default xrgb8888)\n"
+          "  --latency MS[:J]      copy to ready delay, plus 0..J ms of jitter\n"
+          "  --paced               complete copies on the output's refresh ticks\n"
+          "  --slow-every N:MS     every N-th copy of an output takes MS longer\n"
+          "  --damage MODE         band (moving band) | full | static (copy_with_damage never completes)\n"
+          "  --fail P              fail copies with probability P\n"
+          "  --fail-every N        fail every N-th copy of an output\n"
+          "  --resize-every N      toggle an output between its size and half of it every N frames\n"
+          "  --reformat-every N    alternate xrgb8888 / xbgr8888 every N frames\n"
+          "  --hotplug-every MS    unplug the last output, plug it back MS later, repeat\n"
+          "  --no-dmabuf           wl_shm only\n"
+          "  --strict              buffers that do not match the offer are protocol errors\n"
+          "  --main-device PATH    node announced in dma-buf feedback (default /dev/dri/renderD128)\n"
+          "  --seed N              for --fail and jitter\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  struct OutSpec { int w, h, hz; };
+  std::vector<OutSpec> specs;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    auto arg = [&]() -> const char* {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (a == "--output") {
+      OutSpec s{0, 0, 60};
+      if (sscanf(arg(), "%dx%d@%d", &s.w, &s.h, &s.hz) < 2 || s.w <= 0 || s.h <= 0 || s.hz <= 0) usage();
+      specs.push_back(s);
+    } else if (a == "--socket") {
+      cfg.socket = arg();
+    } else if (a == "--format") {
+      const std::string f = arg();
+      cfg.fmt = nullptr;
+      for (const Fmt& x : FORMATS) if (f == x.name) cfg.fmt = &x;
+      if (!cfg.fmt) usage();
+    } else if (a == "--latency") {
+      if (sscanf(arg(), "%lf:%lf", &cfg.latency_ms, &cfg.jitter_ms) < 1) usage();
+    } else if (a == "--paced") {
+      cfg.paced = true;
+    } else if (a == "--slow-every") {
+      if (sscanf(arg(), "%d:%lf", &cfg.slow_every, &cfg.slow_ms) != 2) usage();
+    } else if (a == "--damage") {
+      const std::string d = arg();
+      if (d == "band") cfg.damage = Damage::Band;
+      else if (d == "full") cfg.damage = Damage::Full;
+      else if (d == "static") cfg.damage = Damage::Static;
+      else usage();
+    } else if (a == "--fail") {
+      cfg.fail_p = atof(arg());
+    } else if (a == "--fail-every") {
+      cfg.fail_every = atoi(arg());
+    } else if (a == "--resize-every") {
+      cfg.resize_every = atoi(arg());
+    } else if (a == "--reformat-every") {
+      cfg.reformat_every = atoi(arg());
+    } else if (a == "--hotplug-every") {
+      cfg.hotplug_ms = atoi(arg());
+    } else if (a == "--no-dmabuf") {
+      cfg.dmabuf = false;
+    } else if (a == "--strict") {
+      cfg.strict = true;
+    } else if (a == "--main-device") {
+      cfg.main_device = arg();
+    } else if (a == "--seed") {
+      cfg.seed = unsigned(atol(arg()));
+    } else {
+      usage();
+    }
+  }
+  if (specs.empty()) specs.push_back(OutSpec{1920, 1080, 60});
+  rng.seed(cfg.seed);
+  start_time = now();
+
+  display = wl_display_create();
+  if (!display) { fprintf(stderr, "[mock] wl_display_create failed\n"); return 1; }
+  loop = wl_display_get_event_loop(display);
+  const char* sock = nullptr;
+  if (cfg.socket.empty()) {
+    sock = wl_display_add_socket_auto(display);
+  } else if (wl_display_add_socket(display, cfg.socket.c_str()) == 0) {
+    sock = cfg.socket.c_str();
+  }
+  if (!sock) {
+    fprintf(stderr, "[mock] cannot create a socket (is XDG_RUNTIME_DIR set?)\n");
+    return 1;
+  }
+
+  wl_display_init_shm(display);
+  wl_display_add_shm_format(display, WL_SHM_FORMAT_XBGR8888);
+  for (size_t i = 0; i < specs.size(); ++i)
+    plug("MOCK-" + std::to_string(i + 1), specs[i].w, specs[i].h, specs[i].hz);
+  wl_global_create(display, &zwlr_screencopy_manager_v1_interface, 3, nullptr, screencopy_bind);
+  if (cfg.dmabuf) {
+    struct stat st;
+    if (stat(cfg.main_device.c_str(), &st) == 0) main_dev = st.st_rdev;
+    else fprintf(stderr, "[mock] %s not found; dma-buf clients get device 0\n", cfg.main_device.c_str());
+    wl_global_create(display, &zwp_linux_dmabuf_v1_interface, 4, nullptr, dmabuf_bind);
+  }
+  if (cfg.hotplug_ms > 0) {
+    hotplug_timer = wl_event_loop_add_timer(loop, hotplug, nullptr);
+    wl_event_source_timer_update(hotplug_timer, cfg.hotplug_ms);
+  }
+  wl_event_source* sigint = wl_event_loop_add_signal(loop, SIGINT, on_signal, nullptr);
+  wl_event_source* sigterm = wl_event_loop_add_signal(loop, SIGTERM, on_signal, nullptr);
+
+  fprintf(stdout, "[mock] listening on %s\n", sock);
+  fflush(stdout);
+  wl_display_run(display);
+
+  fprintf(stdout,
+          "[mock] copies %llu, ready %llu, failed %llu (injected %llu, output gone %llu, "
+          "mismatched buffer %llu), unmapped dma-bufs %llu, output changes %llu, "
+          "latency avg %.2f ms max %.2f ms\n",
+          (unsigned long long)stats.copies, (unsigned long long)stats.ready,
+          (unsigned long long)stats.failed, (unsigned long long)stats.injected,
+          (unsigned long long)stats.gone, (unsigned long long)stats.mismatched,
+          (unsigned long long)stats.unmapped, (unsigned long long)stats.changes,
+          stats.ready ? stats.latency_sum_ms / stats.ready : 0.0, stats.latency_max_ms);
+  wl_event_source_remove(sigint);
+  wl_event_source_remove(sigterm);
+  if (hotplug_timer) wl_event_source_remove(hotplug_timer);
+  wl_display_destroy_clients(display);
+  wl_display_destroy(display);
+  return 0;
+}
@@ -0,0 +1,123 @@
+// Extract frames of a frame dump (see include/frame_dump.hpp) as PNG files.
+//
+//   vdump2png <file.vdmp> <outdir> [first [last]]
+//
+// Frames are numbered from 0 and written as <outdir>/frame-NNNNNN.png.
+// Indexed files seek straight to `first`; a file without an index (recording
+// cut short) is scanned from the start.
+#include "frame_dump.hpp"
+#include "png_io.hpp"
+
+#include <zlib.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static uint32_t get32(const uint8_t* p) {
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+static uint64_t get64(const uint8_t* p) { return get32(p) | uint64_t(get32(p + 4)) << 32; }
+
+static bool read_at(FILE* f, uint64_t off, void* buf, size_t len) {
+  return fseeko(f, off_t(off), SEEK_SET) == 0 && std::fread(buf, 1, len, f) == len;
+}
+
+// Frame offsets from the index, or by walking the frame headers
+static std::vector<uint64_t> frame_offsets(FILE* f) {
+  std::vector<uint64_t> offs;
+  uint8_t t[VDUMP_TRAILER_LEN];
+  if (fseeko(f, -off_t(VDUMP_TRAILER_LEN), SEEK_END) == 0 &&
+      std::fread(t, 1, sizeof t, f) == sizeof t && std::memcmp(t + 8, "VEND", 4) == 0) {
+    uint8_t h[8];
+    const uint64_t idx = get64(t);
+    if (read_at(f, idx, h, sizeof h) && std::memcmp(h, "VIDX", 4) == 0) {
+      std::vector<uint8_t> raw(size_t(get32(h + 4)) * 8);
+      if (std::fread(raw.data(), 1, raw.size(), f) == raw.size()) {
+        for (size_t i = 0; i < raw.size(); i += 8) offs.push_back(get64(&raw[i]));
+        return offs;
+      }
+    }
+  }
+  std::fprintf(stderr, "vdump2png: no index, scanning frames\n");
+  uint64_t off = VDUMP_HEADER_LEN;
+  uint8_t h[VDUMP_FRAME_LEN];
+  while (read_at(f, off, h, sizeof h) && std::memcmp(h, "VFRM", 4) == 0) {
+    offs.push_back(off);
+    off += VDUMP_FRAME_LEN + get32(h + 24);
+  }
+  return offs;
+}
+
+static int usage() {
+  std::fprintf(stderr, "usage: vdump2png <file.vdmp> <outdir> [first [last]]\n");
+  return 2;
+}
+
+// Non-negative frame number, or -1
+static long parse_frame(const char* s) {
+  char* end = nullptr;
+  errno = 0;
+  const long v = std::strtol(s, &end, 10);
+  return end == s || *end || errno || v < 0 ? -1 : v;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3 || argc > 5) return usage();
+  const long first = argc > 3 ? parse_frame(argv[3]) : 0;
+  const long last_arg = argc > 4 ? parse_frame(argv[4]) : 0;
+  if (first < 0 || last_arg < 0 || (argc > 4 && last_arg < first)) return usage();
+
+  FILE* f = std::fopen(argv[1], "rb");
+  if (!f) { std::perror(argv[1]); return 1; }
+  uint8_t hdr[VDUMP_HEADER_LEN];
+  if (std::fread(hdr, 1, sizeof hdr, f) != sizeof hdr || std::memcmp(hdr, "VDMP", 4) != 0 ||
+      get32(hdr + 4) != VDUMP_VERSION || get32(hdr + 8) != VDUMP_FORMAT_RGBA) {
+    std::fprintf(stderr, "vdump2png: %s is not a version %u frame dump\n", argv[1], VDUMP_VERSION);
+    return 1;
+  }
+
+  const std::vector<uint64_t> offs = frame_offsets(f);
+  const long last = argc > 4 ? last_arg : long(offs.size()) - 1;
+  std::vector<uint8_t> z, px;
+  int rc = 0, n = 0;
+  for (long i = first; i <= last && i < long(offs.size()); ++i) {
+    uint8_t h[VDUMP_FRAME_LEN];
+    if (!read_at(f, offs[i], h, sizeof h) || std::memcmp(h, "VFRM", 4) != 0) {
+      std::fprintf(stderr, "vdump2png: frame %ld: bad header\n", i);
+      rc = 1;
+      break;
+    }
+    const uint32_t w = get32(h + 4), fh = get32(h + 8);
+    uLongf raw = get32(h + 20);
+    if (raw != uLongf(w) * fh * 4) {
+      std::fprintf(stderr, "vdump2png: frame %ld: size mismatch\n", i);
+      rc = 1;
+      continue;
+    }
+    z.resize(get32(h + 24));
+    px.resize(raw);
+    if (std::fread(z.data(), 1, z.size(), f) != z.size() ||
+        uncompress(px.data(), &raw, z.data(), uLong(z.size())) != Z_OK) {
+      std::fprintf(stderr, "vdump2png: frame %ld: truncated or corrupt\n", i);
+      rc = 1;
+      continue;
+    }
+    char name[32];
+    std::snprintf(name, sizeof name, "/frame-%06ld.png", i);
+    const std::string out = std::string(argv[2]) + name;
+    if (!png_write_rgba(out, px.data(), int(w), int(fh), true)) {
+      std::perror(out.c_str());
+      rc = 1;
+      break;
+    }
+    std::printf("%s  %ux%u  t=%.3f s\n", out.c_str(), w, fh, get64(h + 12) / 1e6);
+    ++n;
+  }
+  std::fclose(f);
+  std::fprintf(stderr, "vdump2png: %d of %zu frames extracted\n", n, offs.size());
+  return rc;
+}